@@ -0,0 +1,387 @@
+#include "allocstats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <new>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+#ifdef OASIS_ALLOC_STATS
+
+namespace {
+
+const size_t SCOPE_SLOTS = 1024;  // power of two, far more than there are trace scopes
+const size_t TYPE_SLOTS = 64;
+const int MAX_DEPTH = 64;
+
+// counters of one scope name, claimed on its first use and never released
+struct ScopeSlot {
+    std::atomic<const char *> name;
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> frees;
+    std::atomic<uint64_t> copies;
+    std::atomic<uint64_t> copyBytes;
+};
+
+struct TypeSlot {
+    std::atomic<const char *> name;
+    std::atomic<uint64_t> copies;
+    std::atomic<uint64_t> bytes;
+};
+
+struct ThreadScopes {
+    ScopeSlot *stack[MAX_DEPTH];
+    int depth;
+};
+
+// all of it constant initialised, the allocator hooks run before any constructor does
+constinit std::atomic<bool> enabled{false};
+constinit ScopeSlot scopes[SCOPE_SLOTS];
+constinit TypeSlot types[TYPE_SLOTS];
+constinit ScopeSlot unscoped;    // outside any scope, startup and Qt's own event handling
+constinit ScopeSlot overflow;    // table full
+#ifdef __GNUC__
+__attribute__((tls_model("initial-exec")))  // no lazy TLS allocation from inside malloc
+#endif
+constinit thread_local ThreadScopes current{};
+
+// open addressing on the literal's address, so a lookup never allocates or locks
+ScopeSlot *findScope(const char *name) {
+    size_t mask = SCOPE_SLOTS - 1;
+    size_t i = (reinterpret_cast<uintptr_t>(name) >> 3) & mask;
+    for (size_t probe = 0; probe < SCOPE_SLOTS; ++probe, i = (i + 1) & mask) {
+        const char *held = scopes[i].name.load(std::memory_order_acquire);
+        if (held == name) return &scopes[i];
+        if (!held) {
+            const char *expected = nullptr;
+            if (scopes[i].name.compare_exchange_strong(expected, name, std::memory_order_acq_rel) || expected == name) {
+                return &scopes[i];
+            }
+        }
+    }
+    return &overflow;
+}
+
+TypeSlot *findType(const char *name) {
+    for (TypeSlot &slot : types) {
+        const char *held = slot.name.load(std::memory_order_acquire);
+        if (held == name) return &slot;
+        if (!held) {
+            const char *expected = nullptr;
+            if (slot.name.compare_exchange_strong(expected, name, std::memory_order_acq_rel) || expected == name) {
+                return &slot;
+            }
+        }
+    }
+    return nullptr;
+}
+
+ScopeSlot *currentScope() {
+    int depth = current.depth;
+    if (depth <= 0) return &unscoped;
+    return current.stack[std::min(depth, MAX_DEPTH) - 1];
+}
+
+void noteAllocation(size_t bytes) {
+    if (!enabled.load(std::memory_order_relaxed)) return;
+    ScopeSlot *slot = currentScope();
+    slot->allocations.fetch_add(1, std::memory_order_relaxed);
+    slot->bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void noteFree(void *p) {
+    if (!p || !enabled.load(std::memory_order_relaxed)) return;
+    currentScope()->frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+#if defined(__GLIBC__)
+// glibc: interpose the C allocator itself, which operator new and Qt's containers both end in.
+// Every entry point that hands out memory free() takes back is replaced, so no free goes uncounted.
+extern "C" {
+void *__libc_malloc(size_t);
+void *__libc_calloc(size_t, size_t);
+void *__libc_realloc(void *, size_t);
+void *__libc_memalign(size_t, size_t);
+void *__libc_valloc(size_t);
+void *__libc_pvalloc(size_t);
+void __libc_free(void *);
+
+void *malloc(size_t bytes) {
+    void *p = __libc_malloc(bytes);
+    if (p) noteAllocation(bytes);
+    return p;
+}
+
+void *calloc(size_t count, size_t size) {
+    size_t bytes;
+    if (__builtin_mul_overflow(count, size, &bytes)) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    void *p = __libc_calloc(count, size);
+    if (p) noteAllocation(bytes);
+    return p;
+}
+
+void *memalign(size_t alignment, size_t bytes) {
+    void *p = __libc_memalign(alignment, bytes);
+    if (p) noteAllocation(bytes);
+    return p;
+}
+
+// aligned operator new ends here
+void *aligned_alloc(size_t alignment, size_t bytes) {
+    if (alignment == 0 || (alignment & (alignment - 1))) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    return memalign(alignment, bytes);
+}
+
+int posix_memalign(void **out, size_t alignment, size_t bytes) {
+    if (alignment % sizeof(void *) || (alignment & (alignment - 1))) return EINVAL;
+    void *p = __libc_memalign(alignment, bytes);
+    if (!p) return ENOMEM;
+    noteAllocation(bytes);
+    *out = p;
+    return 0;
+}
+
+void *valloc(size_t bytes) {
+    void *p = __libc_valloc(bytes);
+    if (p) noteAllocation(bytes);
+    return p;
+}
+
+void *pvalloc(size_t bytes) {
+    void *p = __libc_pvalloc(bytes);
+    if (p) noteAllocation(bytes);
+    return p;
+}
+
+void *realloc(void *old, size_t bytes) {
+    void *p = __libc_realloc(old, bytes);
+    if (old && (p || bytes == 0)) noteFree(old);
+    if (p && bytes) noteAllocation(bytes);
+    return p;
+}
+
+void free(void *p) {
+    noteFree(p);
+    __libc_free(p);
+}
+}
+#else
+// elsewhere count what goes through operator new, Qt's containers go around it
+void *operator new(size_t bytes) {
+    void *p = std::malloc(bytes ? bytes : 1);
+    if (!p) throw std::bad_alloc();
+    noteAllocation(bytes);
+    return p;
+}
+
+void *operator new[](size_t bytes) {
+    return operator new(bytes);
+}
+
+void *operator new(size_t bytes, const std::nothrow_t &) noexcept {
+    void *p = std::malloc(bytes ? bytes : 1);
+    if (p) noteAllocation(bytes);
+    return p;
+}
+
+void *operator new[](size_t bytes, const std::nothrow_t &tag) noexcept {
+    return operator new(bytes, tag);
+}
+
+void operator delete(void *p) noexcept {
+    noteFree(p);
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    operator delete(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    operator delete(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    operator delete(p);
+}
+#endif
+
+bool AllocStats::compiledIn() {
+    return true;
+}
+
+void AllocStats::start() {
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+void AllocStats::stop() {
+    enabled.store(false, std::memory_order_relaxed);
+}
+
+bool AllocStats::isEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+// scopes nest per thread, deeper than MAX_DEPTH is charged to the deepest one kept
+void AllocStats::enter(const char *scope) {
+    ScopeSlot *slot = findScope(scope);
+    slot->calls.fetch_add(1, std::memory_order_relaxed);
+    if (current.depth >= 0 && current.depth < MAX_DEPTH) current.stack[current.depth] = slot;
+    current.depth++;
+}
+
+void AllocStats::leave() {
+    if (current.depth > 0) current.depth--;
+}
+
+void AllocStats::copied(const char *type, size_t bytes) {
+    ScopeSlot *slot = currentScope();
+    slot->copies.fetch_add(1, std::memory_order_relaxed);
+    slot->copyBytes.fetch_add(bytes, std::memory_order_relaxed);
+    if (TypeSlot *t = findType(type)) {
+        t->copies.fetch_add(1, std::memory_order_relaxed);
+        t->bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+}
+
+static AllocRow rowOf(const std::string &name, const ScopeSlot &slot) {
+    return AllocRow{name, slot.calls.load(), slot.allocations.load(), slot.bytes.load(), slot.frees.load(),
+                    slot.copies.load(), slot.copyBytes.load()};
+}
+
+/*
+    Function: rows
+    Purpose: Counts of every scope seen so far, the same name from different translation units
+             merged into one row, sorted by name
+    Return: vector of AllocRow, the unscoped and overflow rows included when they counted anything
+*/
+std::vector<AllocRow> AllocStats::rows() {
+    std::map<std::string, AllocRow> merged;
+    auto add = [&merged](const AllocRow &row) {
+        if (!row.calls && !row.allocations && !row.frees && !row.copies) return;
+        auto found = merged.find(row.scope);
+        if (found == merged.end()) {
+            merged.emplace(row.scope, row);
+            return;
+        }
+        AllocRow &into = found->second;
+        into.calls += row.calls;
+        into.allocations += row.allocations;
+        into.bytes += row.bytes;
+        into.frees += row.frees;
+        into.copies += row.copies;
+        into.copyBytes += row.copyBytes;
+    };
+    for (const ScopeSlot &slot : scopes) {
+        if (const char *name = slot.name.load()) add(rowOf(name, slot));
+    }
+    add(rowOf("(unscoped)", unscoped));
+    add(rowOf("(overflow)", overflow));
+
+    std::vector<AllocRow> out;
+    for (auto &entry : merged) out.push_back(entry.second);
+    return out;
+}
+
+// readable name of a typeid, the mangled one where there is no demangler
+static std::string typeName(const char *mangled) {
+#ifdef __GNUG__
+    int status = 0;
+    char *readable = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+    if (status == 0 && readable) {
+        std::string name(readable);
+        std::free(readable);
+        return name;
+    }
+#endif
+    return mangled;
+}
+
+std::vector<CopyRow> AllocStats::copyRows() {
+    std::vector<CopyRow> out;
+    for (const TypeSlot &slot : types) {
+        if (const char *name = slot.name.load()) out.push_back(CopyRow{typeName(name), slot.copies.load(), slot.bytes.load()});
+    }
+    std::sort(out.begin(), out.end(), [](const CopyRow &a, const CopyRow &b) { return a.type < b.type; });
+    return out;
+}
+
+#else
+
+bool AllocStats::compiledIn() {
+    return false;
+}
+
+void AllocStats::start() {}
+
+void AllocStats::stop() {}
+
+bool AllocStats::isEnabled() {
+    return false;
+}
+
+void AllocStats::enter(const char *) {}
+
+void AllocStats::leave() {}
+
+void AllocStats::copied(const char *, size_t) {}
+
+std::vector<AllocRow> AllocStats::rows() {
+    return {};
+}
+
+std::vector<CopyRow> AllocStats::copyRows() {
+    return {};
+}
+
+#endif
+
+/*
+    Function: report
+    Purpose: Tab separated counts per scope then per copied type, both sorted by name, with
+             per call figures so runs of different lengths still compare
+    Return: string, the report
+*/
+std::string AllocStats::report() {
+    std::string out = "# scopes\nscope\tcalls\tallocs\tbytes\tfrees\tcopies\tcopy_bytes\tallocs_per_call\tbytes_per_call\n";
+    char line[512];
+    for (const AllocRow &row : rows()) {
+        double calls = row.calls ? (double)row.calls : 1;
+        std::snprintf(line, sizeof(line), "%s\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\t%.2f\t%.1f\n", row.scope.c_str(),
+                      (unsigned long long)row.calls, (unsigned long long)row.allocations, (unsigned long long)row.bytes,
+                      (unsigned long long)row.frees, (unsigned long long)row.copies, (unsigned long long)row.copyBytes,
+                      row.allocations / calls, row.bytes / calls);
+        out += line;
+    }
+    out += "# copies\ntype\tcopies\tbytes\n";
+    for (const CopyRow &row : copyRows()) {
+        std::snprintf(line, sizeof(line), "%s\t%llu\t%llu\n", row.type.c_str(), (unsigned long long)row.copies,
+                      (unsigned long long)row.bytes);
+        out += line;
+    }
+    return out;
+}
+
+bool AllocStats::writeReport(const std::string &path) {
+    FILE *file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+    std::string text = report();
+    std::fwrite(text.data(), 1, text.size(), file);
+    return std::fclose(file) == 0;
+}
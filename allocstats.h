@@ -0,0 +1,92 @@
+#ifndef ALLOCSTATS_H
+#define ALLOCSTATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+// what one scope did to the heap, everything it did not hand on to a nested scope
+struct AllocRow {
+    std::string scope;
+    uint64_t calls;
+    uint64_t allocations;
+    uint64_t bytes;
+    uint64_t frees;
+    uint64_t copies;     // deep copies of tracked structs
+    uint64_t copyBytes;
+};
+
+// deep copies of one tracked struct, wherever they happened
+struct CopyRow {
+    std::string type;
+    uint64_t copies;
+    uint64_t bytes;
+};
+
+/*
+    Class: AllocStats
+    Purpose: Opt-in heap and copy accounting, compiled in with CONFIG += alloc_stats. The
+             allocator is interposed and every allocation, its bytes and every free is charged
+             to the innermost trace scope open on the allocating thread, so each Device and
+             MainWindow slot gets its own row. Structs with a CopyCount member also count their
+             copies. Counting starts with start(), the report is sorted and tab separated so
+             two builds can be compared with alloc-diff or plain diff. Without the flag nothing
+             is counted and the scopes compile to nothing.
+ */
+class AllocStats
+{
+public:
+    static bool compiledIn();
+    static void start();
+    static void stop();
+    static bool isEnabled();
+
+    static void enter(const char *scope);
+    static void leave();
+    static void copied(const char *type, size_t bytes);
+
+    static std::vector<AllocRow> rows();
+    static std::vector<CopyRow> copyRows();
+    static std::string report();
+    static bool writeReport(const std::string &path);
+};
+
+// charges the rest of the enclosing scope's allocations to name, which must be a literal
+class AllocScope
+{
+public:
+    explicit AllocScope(const char *name) : open(AllocStats::isEnabled()) {
+        if (open) AllocStats::enter(name);
+    }
+    ~AllocScope() {
+        if (open) AllocStats::leave();
+    }
+
+private:
+    bool open;
+};
+
+// member that counts copies of the struct holding it, empty and free without alloc_stats
+template <class T>
+struct CopyCount {
+    CopyCount() = default;
+#ifdef OASIS_ALLOC_STATS
+    CopyCount(const CopyCount &) { count(); }
+    CopyCount &operator=(const CopyCount &) {
+        count();
+        return *this;
+    }
+    // moves hand the strings over, they are not copies
+    CopyCount(CopyCount &&) = default;
+    CopyCount &operator=(CopyCount &&) = default;
+
+private:
+    static void count() {
+        if (AllocStats::isEnabled()) AllocStats::copied(typeid(T).name(), sizeof(T));
+    }
+#endif
+};
+
+#endif // ALLOCSTATS_H
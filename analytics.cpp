@@ -0,0 +1,333 @@
+#include "analytics.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+static const double MS_PER_DAY = 86400000.0;
+
+// below this many entries per slice a thread costs more than it saves
+static const size_t MIN_SLICE = 1 << 16;
+
+static uint32_t intern(const std::string &name, std::vector<std::string> &names, std::unordered_map<std::string, uint32_t> &ids) {
+    auto found = ids.find(name);
+    if (found != ids.end()) return found->second;
+    uint32_t id = (uint32_t)names.size();
+    names.push_back(name);
+    ids.emplace(name, id);
+    return id;
+}
+
+TherapyHistory::TherapyHistory(int levels) : baseLevels(std::max(levels, 1)), levelCount(baseLevels) {}
+
+uint32_t TherapyHistory::userId(const std::string &name) {
+    return intern(name, userNames, userIds);
+}
+
+uint16_t TherapyHistory::groupId(const std::string &name) {
+    return (uint16_t)intern(name, groupNames, groupIds);
+}
+
+uint16_t TherapyHistory::typeId(const std::string &name) {
+    return (uint16_t)intern(name, typeNames, typeIds);
+}
+
+void TherapyHistory::append(uint32_t user, uint16_t group, uint16_t type, int intensity, bool replay, int64_t atMs) {
+    users.push_back(user);
+    groups.push_back(group);
+    types.push_back(type);
+    intensity = std::min(std::max(intensity, 1), 255);
+    levelCount = std::max(levelCount, intensity);
+    intensities.push_back((uint8_t)intensity);
+    replays.push_back(replay ? 1 : 0);
+    times.push_back(atMs);
+}
+
+void TherapyHistory::append(const std::string &user, const std::string &group, const std::string &type, int intensity, bool replay, int64_t atMs) {
+    this->append(userId(user), groupId(group), typeId(type), intensity, replay, atMs);
+}
+
+void TherapyHistory::reserve(size_t entries) {
+    users.reserve(entries);
+    groups.reserve(entries);
+    types.reserve(entries);
+    intensities.reserve(entries);
+    replays.reserve(entries);
+    times.reserve(entries);
+}
+
+void TherapyHistory::clear() {
+    users.clear();
+    groups.clear();
+    types.clear();
+    intensities.clear();
+    replays.clear();
+    times.clear();
+    userNames.clear();
+    groupNames.clear();
+    typeNames.clear();
+    userIds.clear();
+    groupIds.clear();
+    typeIds.clear();
+    levelCount = baseLevels;
+}
+
+// names are written between tabs, so a tab inside one is written as a space
+static std::string field(std::string name) {
+    std::replace(name.begin(), name.end(), '\t', ' ');
+    return name;
+}
+
+bool TherapyHistory::save(const std::string &path) const {
+    std::ofstream out(path);
+    if (!out) return false;
+    for (size_t i = 0; i < size(); ++i) {
+        out << times[i] << '\t' << field(userNames[users[i]]) << '\t' << field(groupNames[groups[i]]) << '\t'
+            << field(typeNames[types[i]]) << '\t' << (int)intensities[i] << '\t' << (int)replays[i] << '\n';
+    }
+    return (bool)out;
+}
+
+/*
+    Function: load
+    Purpose: Replace the history with the entries saved in a file
+    Inputs:
+        path: string, file written by save
+    Return: false if the file could not be read or a line is malformed
+*/
+bool TherapyHistory::load(const std::string &path) {
+    std::ifstream in(path);
+    if (!in) return false;
+    clear();
+    std::string line;
+    std::vector<std::string> fields;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        fields.clear();
+        std::stringstream columns(line);
+        std::string column;
+        while (std::getline(columns, column, '\t')) fields.push_back(column);
+        if (fields.size() != 6) return false;
+        try {
+            this->append(fields[1], fields[2], fields[3], std::stoi(fields[4]), fields[5] == "1", std::stoll(fields[0]));
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+    Function: scanSlices
+    Purpose: Run body over equal slices of [0, n) on separate threads, each slice filling its
+             own partial result so the threads share nothing until the caller merges them
+    Inputs:
+        n: number of entries
+        threads: slices wanted, 0 for one per core
+        zero: starting value of every partial
+        body: called as body(partial, begin, end)
+    Return: one partial per slice, in slice order
+*/
+template <typename Partial, typename Body>
+static std::vector<Partial> scanSlices(size_t n, unsigned threads, const Partial &zero, Body body) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = (unsigned)std::max<size_t>(1, std::min<size_t>(threads, n / MIN_SLICE));
+    std::vector<Partial> partials(threads, zero);
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+        workers.emplace_back([&partials, &body, n, t, threads]() {
+            body(partials[t], n * t / threads, n * (t + 1) / threads);
+        });
+    }
+    body(partials[0], 0, n / threads);
+    for (std::thread &worker : workers) worker.join();
+    return partials;
+}
+
+/*
+    Function: intensityByType
+    Purpose: Count, mean and histogram of intensity for each session type
+    Inputs:
+        history: TherapyHistory to scan
+        threads: unsigned, 0 for one per core
+    Return: one row per session type that appears, in type id order
+*/
+std::vector<TypeIntensity> intensityByType(const TherapyHistory &history, unsigned threads) {
+    size_t types = history.typeCount();
+    size_t levels = history.levels();
+    std::vector<long long> zero(types * levels, 0);
+    auto partials = scanSlices(history.size(), threads, zero, [&history, levels](std::vector<long long> &counts, size_t begin, size_t end) {
+        const uint16_t *type = history.types.data();
+        const uint8_t *intensity = history.intensities.data();
+        long long *c = counts.data();
+        for (size_t i = begin; i < end; ++i) {
+            c[type[i] * levels + intensity[i] - 1]++;
+        }
+    });
+
+    std::vector<TypeIntensity> rows;
+    for (size_t t = 0; t < types; ++t) {
+        TypeIntensity row = {(uint16_t)t, 0, 0, std::vector<long long>(levels, 0)};
+        long long total = 0;
+        for (size_t level = 0; level < levels; ++level) {
+            for (const auto &partial : partials) row.histogram[level] += partial[t * levels + level];
+            row.count += row.histogram[level];
+            total += row.histogram[level] * (level + 1);
+        }
+        if (row.count == 0) continue;
+        row.meanIntensity = (double)total / row.count;
+        rows.push_back(row);
+    }
+    return rows;
+}
+
+/*
+    Function: mostReplayed
+    Purpose: Programs ordered by how often they were replayed
+    Inputs:
+        history: TherapyHistory to scan
+        top: integer, rows to return
+        threads: unsigned, 0 for one per core
+    Return: up to top programs that were replayed at least once, most replayed first
+*/
+std::vector<ProgramCount> mostReplayed(const TherapyHistory &history, size_t top, unsigned threads) {
+    size_t types = history.typeCount();
+    size_t levels = history.levels();
+    size_t programs = history.groupCount() * types * levels;
+    // replays and records of program p at [2p] and [2p + 1]
+    std::vector<long long> zero(programs * 2, 0);
+    auto partials = scanSlices(history.size(), threads, zero, [&history, types, levels](std::vector<long long> &counts, size_t begin, size_t end) {
+        const uint16_t *group = history.groups.data();
+        const uint16_t *type = history.types.data();
+        const uint8_t *intensity = history.intensities.data();
+        const uint8_t *replay = history.replays.data();
+        long long *c = counts.data();
+        for (size_t i = begin; i < end; ++i) {
+            size_t program = (group[i] * types + type[i]) * levels + intensity[i] - 1;
+            c[program * 2 + (replay[i] ? 0 : 1)]++;
+        }
+    });
+
+    std::vector<ProgramCount> rows;
+    for (size_t p = 0; p < programs; ++p) {
+        ProgramCount row = {(uint16_t)(p / levels / types), (uint16_t)(p / levels % types), (int)(p % levels) + 1, 0, 0};
+        for (const auto &partial : partials) {
+            row.replays += partial[p * 2];
+            row.records += partial[p * 2 + 1];
+        }
+        if (row.replays > 0) rows.push_back(row);
+    }
+    top = std::min(top, rows.size());
+    std::partial_sort(rows.begin(), rows.begin() + top, rows.end(), [](const ProgramCount &a, const ProgramCount &b) {
+        return a.replays != b.replays ? a.replays > b.replays : a.records > b.records;
+    });
+    rows.resize(top);
+    return rows;
+}
+
+// running sums for a least squares line of intensity against days since the first entry
+struct TrendSums {
+    long long n;
+    double t, i, tt, ti;
+    int64_t firstMs, lastMs;
+};
+
+/*
+    Function: userTrends
+    Purpose: Mean intensity of each user and how it moves over time
+    Inputs:
+        history: TherapyHistory to scan
+        threads: unsigned, 0 for one per core
+    Return: one row per user with entries, in user id order
+*/
+std::vector<UserTrend> userTrends(const TherapyHistory &history, unsigned threads) {
+    size_t users = history.userCount();
+    int64_t origin = history.size() ? history.times[0] : 0;
+    TrendSums empty = {0, 0, 0, 0, 0, INT64_MAX, INT64_MIN};
+    std::vector<TrendSums> zero(users, empty);
+    auto partials = scanSlices(history.size(), threads, zero, [&history, origin](std::vector<TrendSums> &sums, size_t begin, size_t end) {
+        const uint32_t *user = history.users.data();
+        const uint8_t *intensity = history.intensities.data();
+        const int64_t *at = history.times.data();
+        for (size_t k = begin; k < end; ++k) {
+            TrendSums &s = sums[user[k]];
+            double t = (at[k] - origin) / MS_PER_DAY;
+            double i = intensity[k];
+            s.n++;
+            s.t += t;
+            s.i += i;
+            s.tt += t * t;
+            s.ti += t * i;
+            s.firstMs = std::min(s.firstMs, at[k]);
+            s.lastMs = std::max(s.lastMs, at[k]);
+        }
+    });
+
+    std::vector<UserTrend> rows;
+    for (size_t u = 0; u < users; ++u) {
+        TrendSums s = empty;
+        for (const auto &partial : partials) {
+            const TrendSums &p = partial[u];
+            s.n += p.n;
+            s.t += p.t;
+            s.i += p.i;
+            s.tt += p.tt;
+            s.ti += p.ti;
+            s.firstMs = std::min(s.firstMs, p.firstMs);
+            s.lastMs = std::max(s.lastMs, p.lastMs);
+        }
+        if (s.n == 0) continue;
+        double spread = s.n * s.tt - s.t * s.t;
+        // a user seen only at one moment has no trend
+        double slope = spread > 1e-12 * s.n * s.n ? (s.n * s.ti - s.t * s.i) / spread : 0;
+        rows.push_back({(uint32_t)u, s.n, s.i / s.n, slope, s.firstMs, s.lastMs});
+    }
+    return rows;
+}
+
+static inline uint32_t nextRandom(uint32_t &state) {
+    uint32_t x = state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state = x;
+    return x;
+}
+
+/*
+    Function: synthesizeHistory
+    Purpose: Fill a history with entries a minute apart from a number of users, each user
+             favouring one type and drifting in intensity so the reports have something to find
+    Inputs:
+        history: TherapyHistory, cleared first
+        entries: integer, entries to add
+        users: integer, distinct users
+        seed: integer, same seed gives the same history
+    Return: void
+*/
+void synthesizeHistory(TherapyHistory &history, size_t entries, size_t users, uint32_t seed) {
+    static const char *groupNames[] = {"20 Min", "45 Min"};
+    static const char *typeNames[] = {"MET", "Sub-Delta", "Delta", "Theta"};
+    history.clear();
+    history.reserve(entries);
+    for (const char *name : groupNames) history.groupId(name);
+    for (const char *name : typeNames) history.typeId(name);
+    users = std::max<size_t>(users, 1);
+    for (size_t u = 0; u < users; ++u) history.userId("user" + std::to_string(u));
+
+    uint32_t state = seed ? seed : 1;
+    const int64_t start = 1700000000000LL;
+    for (size_t k = 0; k < entries; ++k) {
+        uint32_t r = nextRandom(state);
+        uint32_t user = r % users;
+        uint32_t bits = nextRandom(state);
+        uint16_t type = (bits & 3) == 3 ? (bits >> 2) % 4 : user % 4;
+        uint16_t group = (bits >> 4) & 1;
+        // users drift up or down by about one level over the whole history
+        int drift = (int)((k * 2 / std::max<size_t>(entries, 1)) * (user % 2 ? 1 : -1));
+        int intensity = 3 + (int)(user % 3) + drift + (int)((bits >> 5) % 3) - 1;
+        bool replay = ((bits >> 8) % 10) < 3;
+        history.append(user, group, type, intensity, replay, start + (int64_t)k * 60000);
+    }
+}
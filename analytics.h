@@ -0,0 +1,91 @@
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// intensity levels of the standard hardware, a history made for other hardware passes its own
+const int INTENSITY_LEVELS = 8;
+
+/*
+    Class: TherapyHistory
+    Purpose: Every therapy recorded or replayed, stored column by column with names interned
+             to small ids so a scan over millions of entries only reads the columns it needs.
+             Intensities are kept as recorded, the level count grows to the highest one seen.
+ */
+class TherapyHistory {
+public:
+    explicit TherapyHistory(int levels = INTENSITY_LEVELS);
+
+    uint32_t userId(const std::string &);
+    uint16_t groupId(const std::string &);
+    uint16_t typeId(const std::string &);
+    const std::string &userName(uint32_t id) const { return userNames[id]; }
+    const std::string &groupName(uint16_t id) const { return groupNames[id]; }
+    const std::string &typeName(uint16_t id) const { return typeNames[id]; }
+    size_t userCount() const { return userNames.size(); }
+    size_t groupCount() const { return groupNames.size(); }
+    size_t typeCount() const { return typeNames.size(); }
+    int levels() const { return levelCount; }
+
+    void append(uint32_t user, uint16_t group, uint16_t type, int intensity, bool replay, int64_t atMs);
+    void append(const std::string &user, const std::string &group, const std::string &type, int intensity, bool replay, int64_t atMs);
+    void reserve(size_t);
+    void clear();
+    size_t size() const { return intensities.size(); }
+
+    // tab separated, one entry per line: atMs user group type intensity replay
+    bool save(const std::string &path) const;
+    bool load(const std::string &path);
+
+    std::vector<uint32_t> users;
+    std::vector<uint16_t> groups;
+    std::vector<uint16_t> types;
+    std::vector<uint8_t> intensities;
+    std::vector<uint8_t> replays;
+    std::vector<int64_t> times;
+
+private:
+    int baseLevels;     // levels of the hardware, kept across clear
+    int levelCount;     // intensities run 1..levelCount
+    std::vector<std::string> userNames, groupNames, typeNames;
+    std::unordered_map<std::string, uint32_t> userIds, groupIds, typeIds;
+};
+
+struct TypeIntensity {
+    uint16_t type;
+    long long count;
+    double meanIntensity;
+    std::vector<long long> histogram; // entries at intensity 1..levels
+};
+
+// a program is what a replay repeats: group, type and intensity
+struct ProgramCount {
+    uint16_t group;
+    uint16_t type;
+    int intensity;
+    long long replays;
+    long long records;
+};
+
+struct UserTrend {
+    uint32_t user;
+    long long count;
+    double meanIntensity;
+    double slopePerDay;    // least squares change in intensity per day of history
+    int64_t firstMs;
+    int64_t lastMs;
+};
+
+// group-by reports, each splits the history into one slice per thread and merges the partials, 0 threads uses every core
+std::vector<TypeIntensity> intensityByType(const TherapyHistory &, unsigned threads = 0);
+std::vector<ProgramCount> mostReplayed(const TherapyHistory &, size_t top, unsigned threads = 0);
+std::vector<UserTrend> userTrends(const TherapyHistory &, unsigned threads = 0);
+
+// deterministic random history for benchmarks, names follow the device's catalog
+void synthesizeHistory(TherapyHistory &, size_t entries, size_t users, uint32_t seed = 1);
+
+#endif // ANALYTICS_H
@@ -0,0 +1,171 @@
+#include "animator.h"
+#include "tracer.h"
+
+Animation Animation::blink(int periodMs, int steps, int low, int high, QString colour, QString target) {
+    Animation a;
+    a.kind = AnimationKind::Blink;
+    a.periodMs = periodMs;
+    a.steps = steps;
+    a.low = low;
+    a.high = high;
+    a.colour = colour;
+    a.target = target;
+    a.durationMs = 0;
+    return a;
+}
+
+Animation Animation::scroll(int periodMs, int low, int high) {
+    Animation a = blink(periodMs, -1, low, high);
+    a.kind = AnimationKind::Scroll;
+    return a;
+}
+
+Animation Animation::countdown(qint64 durationMs) {
+    Animation a = blink(1000, -1);
+    a.kind = AnimationKind::Countdown;
+    a.durationMs = durationMs;
+    return a;
+}
+
+AnimationClock::AnimationClock(int frameMs, QObject *parent) : QObject(parent), manual(false), manualMs(0) {
+    for (int i = 0; i < ANIMATION_TRACKS; ++i) {
+        tracks[i].active = false;
+        tracks[i].dirty = false;
+        tracks[i].value = 0;
+        tracks[i].startedMs = 0;
+    }
+    this->frameTimer.setInterval(frameMs);
+    this->frameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&frameTimer, SIGNAL(timeout()), this, SLOT(tick()));
+    this->clock.start();
+}
+
+/*
+    Function: start
+    Purpose: Run an animation on a track, replacing whatever the track was running.
+             Its first value is drawn on the next frame.
+    Inputs:
+        track: AnimationTrack, what the animation drives
+        animation: Animation, the effect to run
+    Return: void
+ */
+void AnimationClock::start(AnimationTrack track, const Animation &animation) {
+    Track &t = tracks[(int)track];
+    bool done;
+    t.animation = animation;
+    t.startedMs = now();
+    t.value = valueAt(animation, 0, &done);
+    t.active = true;
+    t.dirty = true;
+    if (!manual && !frameTimer.isActive()) frameTimer.start();
+}
+
+void AnimationClock::stop(AnimationTrack track) {
+    tracks[(int)track].active = false;
+    tracks[(int)track].dirty = false;
+}
+
+void AnimationClock::stopAll() {
+    for (int i = 0; i < ANIMATION_TRACKS; ++i) {
+        stop((AnimationTrack)i);
+    }
+    frameTimer.stop();
+}
+
+bool AnimationClock::isActive(AnimationTrack track) const {
+    return tracks[(int)track].active;
+}
+
+const Animation &AnimationClock::animation(AnimationTrack track) const {
+    return tracks[(int)track].animation;
+}
+
+int AnimationClock::value(AnimationTrack track) const {
+    return tracks[(int)track].value;
+}
+
+qint64 AnimationClock::now() const {
+    return manual ? manualMs : clock.elapsed();
+}
+
+/*
+    Function: setManual
+    Purpose: Switch between the frame timer and a clock that only moves on advance, so an
+             offscreen run can render animations frame by frame as fast as it likes
+    Inputs:
+        on: boolean, true for the manual clock
+    Return: void
+ */
+void AnimationClock::setManual(bool on) {
+    this->manual = on;
+    this->manualMs = clock.elapsed();
+    if (on) frameTimer.stop();
+}
+
+// move the manual clock forward and run the frame for the new time
+void AnimationClock::advance(qint64 ms) {
+    this->manualMs += ms;
+    tick();
+}
+
+// value of an animation some time after it started, done is set once it has run its steps
+int AnimationClock::valueAt(const Animation &a, qint64 elapsedMs, bool *done) const {
+    qint64 step = elapsedMs / a.periodMs;
+    *done = a.steps >= 0 && step >= a.steps;
+
+    switch (a.kind) {
+        case AnimationKind::Blink:
+            return step % 2 == 0 ? 1 : 0;
+        case AnimationKind::Scroll: {
+            // low up to high and back down again
+            int span = a.high - a.low;
+            if (span <= 0) return a.low;
+            int index = step % (2 * span);
+            return index <= span ? a.low + index : a.low + 2 * span - index;
+        }
+        case AnimationKind::Countdown: {
+            qint64 remaining = a.durationMs - elapsedMs;
+            *done = remaining <= 0;
+            return remaining <= 0 ? 0 : (int)(remaining / 1000);
+        }
+    }
+    return 0;
+}
+
+/*
+    Function: tick [Slot]
+    Purpose: Advance every running animation to the current time and emit a single frame
+             for the tracks whose value changed, then report animations that finished
+    Return: void
+ */
+void AnimationClock::tick() {
+    TRACE_INSTANT("timer:animationFrame");
+    qint64 now = this->now();
+    int dirtyMask = 0;
+    int finishedMask = 0;
+    bool anyActive = false;
+
+    for (int i = 0; i < ANIMATION_TRACKS; ++i) {
+        Track &t = tracks[i];
+        if (!t.active) continue;
+
+        bool done;
+        int v = valueAt(t.animation, now - t.startedMs, &done);
+        if (done) {
+            t.active = false;
+            finishedMask |= 1 << i;
+        } else {
+            if (v != t.value) t.dirty = true;
+            t.value = v;
+            anyActive = true;
+        }
+        if (t.dirty) dirtyMask |= 1 << i;
+        t.dirty = false;
+    }
+
+    if (!anyActive) frameTimer.stop();
+    if (dirtyMask) emit frame(dirtyMask);
+    for (int i = 0; i < ANIMATION_TRACKS; ++i) {
+        if (finishedMask & (1 << i)) emit finished((AnimationTrack)i);
+    }
+}
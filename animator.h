@@ -0,0 +1,85 @@
+#ifndef ANIMATOR_H
+#define ANIMATOR_H
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QElapsedTimer>
+
+// what an animation drives, each track runs at most one animation at a time
+enum class AnimationTrack {GraphBlink, GraphScroll, WavelengthBlink, SessionCountdown};
+const int ANIMATION_TRACKS = 4;
+
+enum class AnimationKind {Blink, Scroll, Countdown};
+
+/*
+    Struct: Animation
+    Purpose: Declarative description of an effect, the clock works out its value from the
+             time since it started: Blink gives 1/0 alternating every period, Scroll gives a
+             position bouncing between low and high, Countdown gives whole seconds remaining.
+ */
+struct Animation {
+    AnimationKind kind;
+    int periodMs;
+    int steps;          // periods before finishing, -1 runs until stopped
+    int low;            // Blink: first graph light, Scroll: bottom of the range
+    int high;           // Blink: last graph light, Scroll: top of the range
+    QString colour;
+    QString target;     // Blink: wavelength being blinked
+    qint64 durationMs;  // Countdown: time to count down from
+
+    static Animation blink(int periodMs, int steps, int low = 0, int high = 0, QString colour = "black", QString target = "");
+    static Animation scroll(int periodMs, int low, int high);
+    static Animation countdown(qint64 durationMs);
+};
+
+/*
+    Class: AnimationClock
+    Purpose: Single frame timer per window. Every frame it advances all running animations
+             and emits one frame signal listing the tracks whose value changed, so the window
+             restyles only what moved. The timer only runs while an animation is active.
+ */
+class AnimationClock : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AnimationClock(int frameMs = 16, QObject *parent = nullptr);
+
+    void start(AnimationTrack, const Animation &);
+    void stop(AnimationTrack);
+    void stopAll();
+    bool isActive(AnimationTrack) const;
+    const Animation &animation(AnimationTrack) const;
+    int value(AnimationTrack) const;
+
+    // manual clock for offscreen runs, time only moves when advance is called
+    void setManual(bool);
+    void advance(qint64);
+
+signals:
+    void frame(int); // bit mask of changed tracks, 1 << (int)AnimationTrack
+    void finished(AnimationTrack);
+
+private slots:
+    void tick();
+
+private:
+    struct Track {
+        Animation animation;
+        qint64 startedMs;
+        int value;
+        bool active;
+        bool dirty;
+    };
+    Track tracks[ANIMATION_TRACKS];
+    QTimer frameTimer;
+    QElapsedTimer clock;
+    bool manual;
+    qint64 manualMs;
+
+    qint64 now() const;
+
+    int valueAt(const Animation &, qint64 elapsedMs, bool *done) const;
+};
+
+#endif // ANIMATOR_H
@@ -0,0 +1,86 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+/*
+    Class: Arena
+    Purpose: Allocates objects of one type in blocks that are never moved, so returned
+             pointers stay valid until the arena is cleared or destroyed. Objects are
+             destroyed together, newest first, and their blocks freed in one pass.
+ */
+template <typename T>
+class Arena
+{
+public:
+    explicit Arena(size_t firstBlock = 8) : nextBlock(firstBlock ? firstBlock : 1), used(0), count(0) {}
+
+    ~Arena() {
+        destroyAll();
+        for (size_t b = 0; b < blocks.size(); ++b) ::operator delete(blocks[b].memory);
+    }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    // construct a T in place, the arena owns it
+    template <typename... Args>
+    T *make(Args &&... args) {
+        if (blocks.empty() || used == blocks.back().capacity) grow();
+        T *slot = blocks.back().memory + used;
+        new (slot) T(std::forward<Args>(args)...);
+        ++used;
+        ++count;
+        return slot;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    // destroy every object, the first block is kept for reuse
+    void clear() {
+        destroyAll();
+        if (blocks.size() > 1) {
+            for (size_t b = 1; b < blocks.size(); ++b) ::operator delete(blocks[b].memory);
+            blocks.erase(blocks.begin() + 1, blocks.end());
+        }
+        used = 0;
+        count = 0;
+    }
+
+private:
+    struct Block {
+        T *memory;
+        size_t capacity;
+    };
+
+    std::vector<Block> blocks;
+    size_t nextBlock;   // capacity of the next block, doubles each time
+    size_t used;        // objects in the last block
+    size_t count;
+
+    // run every destructor, newest first, leaving the blocks allocated
+    void destroyAll() {
+        for (size_t b = blocks.size(); b-- > 0;) {
+            T *memory = blocks[b].memory;
+            size_t live = b + 1 == blocks.size() ? used : blocks[b].capacity;
+            for (size_t i = live; i-- > 0;) (memory + i)->~T();
+        }
+        count = 0;
+    }
+
+    void grow() {
+        Block block;
+        block.memory = static_cast<T *>(::operator new(nextBlock * sizeof(T)));
+        block.capacity = nextBlock;
+        blocks.push_back(block);
+        nextBlock *= 2;
+        used = 0;
+    }
+};
+
+#endif // ARENA_H
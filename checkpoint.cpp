@@ -0,0 +1,226 @@
+#include "checkpoint.h"
+
+#include <cstring>
+
+static_assert(sizeof(DeviceCheckpoint) == CHECKPOINT_WORDS * 4, "DeviceCheckpoint must have no padding");
+
+static const char MAGIC[4] = {'O', 'C', 'K', '1'};
+
+// record tags
+static const uint8_t BASE = 'B';
+static const uint8_t DELTA = 'D';
+static const uint8_t THERAPY = 'T';
+static const uint8_t NAME = 'N';
+
+static void put8(std::vector<uint8_t> &out, uint8_t value) {
+    out.push_back(value);
+}
+
+static void put16(std::vector<uint8_t> &out, uint16_t value) {
+    out.push_back(value & 0xff);
+    out.push_back(value >> 8);
+}
+
+static void put32(std::vector<uint8_t> &out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out.push_back((value >> (8 * i)) & 0xff);
+}
+
+static void putString(std::vector<uint8_t> &out, const std::string &text) {
+    uint16_t length = text.size() > 0xffff ? 0xffff : (uint16_t)text.size();
+    put16(out, length);
+    for (uint16_t i = 0; i < length; ++i) put8(out, (uint8_t)text[i]);
+}
+
+CheckpointLog::CheckpointLog(const std::string &path, size_t compactAfter)
+    : path(path), file(nullptr), compactAfter(compactAfter), records(0), haveBase(false) {
+    std::memset(last, 0, sizeof(last));
+}
+
+CheckpointLog::~CheckpointLog() {
+    if (file) std::fclose(file);
+}
+
+long CheckpointLog::bytes() const {
+    return file ? std::ftell(file) : 0;
+}
+
+void CheckpointLog::putTherapy(const CheckpointTherapy &therapy) {
+    put8(buffer, THERAPY);
+    put8(buffer, therapy.group);
+    put8(buffer, therapy.type);
+    put8(buffer, therapy.intensity);
+    putString(buffer, therapy.username);
+}
+
+void CheckpointLog::putName() {
+    put8(buffer, NAME);
+    putString(buffer, name);
+}
+
+// append the buffered records, flushed so a crash right after still finds them
+bool CheckpointLog::flush() {
+    bool ok = file && std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size() && std::fflush(file) == 0;
+    buffer.clear();
+    return ok;
+}
+
+/*
+    Function: rewrite
+    Purpose: Replace the file with one base record, the therapies and the name, written to a
+             temporary file first so a crash never leaves a checkpoint without its base
+    Inputs:
+        words: checkpoint as words
+    Return: false if the file could not be written
+*/
+bool CheckpointLog::rewrite(const uint32_t *words) {
+    if (file) std::fclose(file);
+    file = nullptr;
+    std::string temporary = path + ".tmp";
+    FILE *out = std::fopen(temporary.c_str(), "wb");
+    if (!out) return false;
+
+    buffer.clear();
+    for (char c : MAGIC) put8(buffer, (uint8_t)c);
+    put8(buffer, BASE);
+    put8(buffer, CHECKPOINT_WORDS);
+    for (int i = 0; i < CHECKPOINT_WORDS; ++i) put32(buffer, words[i]);
+    for (const CheckpointTherapy &therapy : therapies) putTherapy(therapy);
+    if (!name.empty()) putName();
+    bool ok = std::fwrite(buffer.data(), 1, buffer.size(), out) == buffer.size();
+    ok = std::fclose(out) == 0 && ok;
+    buffer.clear();
+    if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) return false;
+
+    file = std::fopen(path.c_str(), "ab");
+    std::memcpy(last, words, sizeof(last));
+    haveBase = true;
+    records = 0;
+    return file != nullptr;
+}
+
+/*
+    Function: write
+    Purpose: Record the device as it is now, appending only what changed since the last write
+    Inputs:
+        checkpoint: DeviceCheckpoint of the device
+        newTherapies: therapies recorded since the last write
+        currentName: username typed in so far
+    Return: false if the file could not be written
+*/
+bool CheckpointLog::write(const DeviceCheckpoint &checkpoint, const std::vector<CheckpointTherapy> &newTherapies, const std::string &currentName) {
+    uint32_t words[CHECKPOINT_WORDS];
+    std::memcpy(words, &checkpoint, sizeof(words));
+    therapies.insert(therapies.end(), newTherapies.begin(), newTherapies.end());
+    bool nameChanged = currentName != name;
+    name = currentName;
+
+    if (!haveBase || records >= compactAfter) return rewrite(words);
+
+    size_t deltaAt = buffer.size();
+    put8(buffer, DELTA);
+    put8(buffer, 0);
+    uint8_t changed = 0;
+    for (int i = 0; i < CHECKPOINT_WORDS; ++i) {
+        if (words[i] == last[i]) continue;
+        put8(buffer, (uint8_t)i);
+        put32(buffer, words[i]);
+        changed++;
+    }
+    if (changed == 0) {
+        buffer.resize(deltaAt);
+    } else {
+        buffer[deltaAt + 1] = changed;
+        records++;
+    }
+    for (const CheckpointTherapy &therapy : newTherapies) putTherapy(therapy);
+    if (nameChanged) putName();
+    records += newTherapies.size() + (nameChanged ? 1 : 0);
+
+    std::memcpy(last, words, sizeof(last));
+    return buffer.empty() || flush();
+}
+
+/*
+    Function: read
+    Purpose: Replay a checkpoint file up to its last complete record
+    Inputs:
+        path: checkpoint file
+        checkpoint: DeviceCheckpoint pointer, filled in
+        therapies: vector pointer, filled with the recorded therapies
+        name: string pointer, filled with the username
+    Return: false if the file is missing or has no base record of this layout
+*/
+bool CheckpointLog::read(const std::string &path, DeviceCheckpoint *checkpoint, std::vector<CheckpointTherapy> *therapies, std::string *name) {
+    FILE *in = std::fopen(path.c_str(), "rb");
+    if (!in) return false;
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), in)) > 0) data.insert(data.end(), chunk, chunk + n);
+    std::fclose(in);
+    if (data.size() < sizeof MAGIC || std::memcmp(data.data(), MAGIC, sizeof MAGIC) != 0) return false;
+
+    uint32_t words[CHECKPOINT_WORDS];
+    bool haveBase = false;
+    therapies->clear();
+    name->clear();
+
+    size_t at = sizeof MAGIC;
+    auto left = [&data, &at](size_t need) { return data.size() - at >= need; };
+    auto get16 = [&data, &at]() { uint16_t v = data[at] | (data[at + 1] << 8); at += 2; return v; };
+    auto get32 = [&data, &at]() {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) v |= (uint32_t)data[at + i] << (8 * i);
+        at += 4;
+        return v;
+    };
+    auto getString = [&data, &at, &left, &get16](std::string *out) {
+        if (!left(2)) return false;
+        size_t start = at;
+        uint16_t length = get16();
+        if (!left(length)) { at = start; return false; }
+        out->assign(data.begin() + at, data.begin() + at + length);
+        at += length;
+        return true;
+    };
+
+    while (left(1)) {
+        uint8_t tag = data[at++];
+        if (tag == BASE) {
+            if (!left(1) || data[at] != CHECKPOINT_WORDS) return false;
+            if (!left(1 + 4 * CHECKPOINT_WORDS)) break;
+            at++;
+            for (int i = 0; i < CHECKPOINT_WORDS; ++i) words[i] = get32();
+            haveBase = true;
+        } else if (tag == DELTA && haveBase) {
+            if (!left(1) || !left(1 + 5 * (size_t)data[at])) break;
+            uint8_t count = data[at++];
+            uint32_t next[CHECKPOINT_WORDS];
+            std::memcpy(next, words, sizeof(next));
+            bool valid = true;
+            for (int i = 0; i < count; ++i) {
+                uint8_t index = data[at++];
+                uint32_t value = get32();
+                if (index >= CHECKPOINT_WORDS) valid = false;
+                else next[index] = value;
+            }
+            if (!valid) break;
+            std::memcpy(words, next, sizeof(words));
+        } else if (tag == THERAPY) {
+            if (!left(3)) break;
+            CheckpointTherapy therapy;
+            therapy.group = data[at++];
+            therapy.type = data[at++];
+            therapy.intensity = data[at++];
+            if (!getString(&therapy.username)) break;
+            therapies->push_back(therapy);
+        } else if (tag == NAME) {
+            if (!getString(name)) break;
+        } else {
+            break;
+        }
+    }
+    if (!haveBase) return false;
+    std::memcpy(checkpoint, words, sizeof(words));
+    return true;
+}
@@ -0,0 +1,88 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// flags word of a checkpoint
+const int32_t CHECKPOINT_DISCONNECTED = 1;
+const int32_t CHECKPOINT_SAFE_VOLTAGE = 2;
+const int32_t CHECKPOINT_TOGGLE_RECORD = 4;
+const int32_t CHECKPOINT_LOW_TRIGGERED = 8;
+const int32_t CHECKPOINT_CRITICAL_TRIGGERED = 16;
+
+/*
+    Struct: DeviceCheckpoint
+    Purpose: What a device needs to carry on after a restart. Timer deadlines are wall clock
+             times so they hold across the restart and stay put while a timer runs, 0 means
+             the timer was not running. The layout has no padding, it is written as
+             32 bit words and a delta only carries the words that changed.
+ */
+struct DeviceCheckpoint {
+    int64_t sessionDeadlineMs;
+    int64_t testConnectionDeadlineMs;
+    int64_t safeVoltageDeadlineMs;
+    int64_t voltageDeadlineMs;
+    double batteryLevel;
+    int32_t state;
+    int32_t connectionStatus;
+    int32_t intensity;
+    int32_t selectedSessionGroup;
+    int32_t selectedSessionType;
+    int32_t selectedUserSession;
+    int32_t selectedRecordedTherapy;
+    int32_t remainingSessionMs;  // paused session time left, -1 for none
+    int32_t flags;
+    int32_t therapyCount;        // recorded therapies after the presets
+};
+
+const int CHECKPOINT_WORDS = sizeof(DeviceCheckpoint) / 4;
+
+// a recorded therapy, by catalog index
+struct CheckpointTherapy {
+    uint8_t group;
+    uint8_t type;
+    uint8_t intensity;
+    std::string username;
+};
+
+/*
+    Class: CheckpointLog
+    Purpose: Append only checkpoint file. Opening it writes a full base record, every write
+             after that appends a delta of the changed words plus any new therapies and name,
+             usually a few bytes. After compactAfter records the file is rewritten as one base.
+             A record cut short by a crash is ignored on read.
+ */
+class CheckpointLog {
+public:
+    explicit CheckpointLog(const std::string &path, size_t compactAfter = 256);
+    ~CheckpointLog();
+    CheckpointLog(const CheckpointLog &) = delete;
+    CheckpointLog &operator=(const CheckpointLog &) = delete;
+
+    bool write(const DeviceCheckpoint &, const std::vector<CheckpointTherapy> &newTherapies, const std::string &name);
+    size_t therapiesWritten() const { return therapies.size(); }
+    long bytes() const;
+
+    static bool read(const std::string &path, DeviceCheckpoint *, std::vector<CheckpointTherapy> *, std::string *name);
+
+private:
+    std::string path;
+    FILE *file;
+    size_t compactAfter;
+    size_t records;
+    bool haveBase;
+    uint32_t last[CHECKPOINT_WORDS];
+    std::vector<CheckpointTherapy> therapies;
+    std::string name;
+    std::vector<uint8_t> buffer;
+
+    bool rewrite(const uint32_t *words);
+    void putTherapy(const CheckpointTherapy &);
+    void putName();
+    bool flush();
+};
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,67 @@
+#ifndef CONTROLPROTOCOL_H
+#define CONTROLPROTOCOL_H
+
+#include <cstdint>
+
+/*
+    Local control protocol, shared by the server and any external harness.
+
+    Every message is a frame: u16 opcode, u16 payload length, u32 request id, payload.
+    All integers are little endian. A client can send any number of frames without
+    waiting, the server answers in order and batches all replies produced by one read
+    into a single write. Replies carry the request's opcode with REPLY_BIT set and the
+    same request id. Notifications use NOTIFY_BIT opcodes and request id 0. A reply whose
+    payload would not fit the u16 length, such as a very long therapy list, is sent as OpError.
+ */
+const int FRAME_HEADER_SIZE = 8;
+const int MAX_PAYLOAD_SIZE = 0xFFFF;
+const uint16_t REPLY_BIT = 0x8000;
+const uint16_t NOTIFY_BIT = 0x4000;
+const uint16_t NO_REPLY_BIT = 0x2000; // set on a request to skip its acknowledgement
+
+enum ControlOpcode : uint16_t {
+    // inputs, acknowledged with an empty reply
+    OpPowerPress = 0x01,
+    OpPowerRelease = 0x02,
+    OpIntensityUp = 0x03,
+    OpIntensityDown = 0x04,
+    OpStartSession = 0x05,
+    OpSetBattery = 0x06,        // i32 percent
+    OpResetBattery = 0x07,
+    OpSetConnection = 0x08,     // i32 0 No, 1 Okay, 2 Excellent
+    OpUsername = 0x09,          // utf8 bytes
+    OpRecord = 0x0A,
+    OpReplay = 0x0B,
+
+    // getters, reply payload noted
+    OpGetState = 0x20,          // i32 State
+    OpGetBattery = 0x21,        // f64 percent
+    OpGetConnection = 0x22,     // i32 ConnectionStatus
+    OpGetIntensity = 0x23,      // i32
+    OpGetWavelength = 0x24,     // i32 WaveIcon
+    OpGetRemainingTime = 0x25,  // i32 ms
+    OpGetSelection = 0x26,      // i32 group, type, user session, recorded therapy
+    OpGetFlags = 0x27,          // u32 bits: toggleRecord, disconnected, returningToSafeVoltage, runBatteryAnimation
+    OpGetUsername = 0x28,       // utf8 bytes
+    OpGetSnapshot = 0x29,       // snapshot record, see ControlServer::appendSnapshot
+    OpGetTherapies = 0x2A,      // u32 count, then per therapy: i32 intensity, u16 len + utf8 for user, group, type
+
+    // session control
+    OpSubscribe = 0x40,         // u32 mask of NotifyMask bits, replaces the previous mask
+    OpPing = 0x41,
+
+    // notifications
+    OpDeviceUpdated = NOTIFY_BIT | 0x01,  // snapshot record
+    OpConnectionTest = NOTIFY_BIT | 0x02, // u8 bool
+    OpSafeVoltage = NOTIFY_BIT | 0x03,    // u8 bool
+
+    OpError = 0x7F                        // reply payload: u16 offending opcode, unknown or too long a reply
+};
+
+enum NotifyMask : uint32_t {
+    NotifyDeviceUpdated = 1,
+    NotifyConnectionTest = 2,
+    NotifySafeVoltage = 4
+};
+
+#endif // CONTROLPROTOCOL_H
@@ -0,0 +1,262 @@
+#include "controlserver.h"
+
+#include <QtEndian>
+#include <cstring>
+
+template <typename T>
+static void appendLE(QByteArray &out, T value) {
+    char bytes[sizeof(T)];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, sizeof(T));
+}
+
+static void appendF64(QByteArray &out, double value) {
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    appendLE<quint64>(out, bits);
+}
+
+// a string longer than the u16 length also overflows its frame, which appendFrame refuses
+static void appendString(QByteArray &out, const QString &value) {
+    QByteArray utf8 = value.toUtf8();
+    appendLE<quint16>(out, (quint16)utf8.size());
+    out.append(utf8);
+}
+
+ControlServer::ControlServer(Device *d, QObject *parent) : QObject(parent), device(d), server(this) {
+    connect(&server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+    connect(d, SIGNAL(deviceUpdated()), this, SLOT(deviceUpdated()));
+    connect(d, SIGNAL(connectionTest(bool)), this, SLOT(connectionTest(bool)));
+    connect(d, SIGNAL(safeVoltage(bool)), this, SLOT(safeVoltage(bool)));
+}
+
+ControlServer::~ControlServer() {
+    server.close();
+}
+
+/*
+    Function: listen
+    Purpose: Start accepting harness connections, replacing a stale socket from a previous run
+    Inputs:
+        name: QString, socket name (placed in the temp directory) or absolute path
+    Return: bool, false if the socket could not be created
+*/
+bool ControlServer::listen(QString name) {
+    QLocalServer::removeServer(name);
+    if (!server.listen(name)) {
+        qDebug() << "Control server failed to listen on" << name << ":" << server.errorString();
+        return false;
+    }
+    qDebug() << "Control server listening on" << server.fullServerName();
+    return true;
+}
+
+QString ControlServer::serverPath() const {
+    return server.fullServerName();
+}
+
+void ControlServer::newConnection() {
+    while (QLocalSocket *socket = server.nextPendingConnection()) {
+        Client client;
+        client.subscriptions = 0;
+        client.inBatch = false;
+        clients.insert(socket, client);
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readClient()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(clientDisconnected()));
+    }
+}
+
+void ControlServer::clientDisconnected() {
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    clients.remove(socket);
+    socket->deleteLater();
+}
+
+/*
+    Function: readClient [Slot]
+    Purpose: Handle every complete frame the client has sent so far as one batch.
+             Replies and any notifications raised while handling them are written together.
+    Return: void
+*/
+void ControlServer::readClient() {
+    QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+    auto it = clients.find(socket);
+    if (it == clients.end()) return;
+    Client &client = it.value();
+
+    client.inbox.append(socket->readAll());
+    client.inBatch = true;
+
+    const char *data = client.inbox.constData();
+    int offset = 0;
+    while (client.inbox.size() - offset >= FRAME_HEADER_SIZE) {
+        quint16 opcode = qFromLittleEndian<quint16>(data + offset);
+        quint16 length = qFromLittleEndian<quint16>(data + offset + 2);
+        quint32 id = qFromLittleEndian<quint32>(data + offset + 4);
+        if (client.inbox.size() - offset < FRAME_HEADER_SIZE + length) break; // rest arrives later
+
+        handleFrame(client, opcode, id, data + offset + FRAME_HEADER_SIZE, length);
+        offset += FRAME_HEADER_SIZE + length;
+    }
+    client.inbox.remove(0, offset);
+
+    client.inBatch = false;
+    flush(socket, client);
+}
+
+/*
+    Function: handleFrame
+    Purpose: Apply one request to the device and queue its reply
+    Inputs:
+        client: Client, connection the request came from
+        opcode: request opcode, may carry NO_REPLY_BIT
+        id: request id echoed in the reply
+        payload / length: request payload
+    Return: void
+*/
+void ControlServer::handleFrame(Client &client, quint16 opcode, quint32 id, const char *payload, int length) {
+    bool reply = !(opcode & NO_REPLY_BIT);
+    quint16 op = opcode & (quint16)~NO_REPLY_BIT;
+    QByteArray out;
+
+    // argument of the requests that take one integer
+    qint32 arg = length >= 4 ? qFromLittleEndian<qint32>(payload) : 0;
+
+    // inputs go through the device's queue, anything that reads it sees the inputs sent before
+    if (op >= OpGetState) device->DrainInputs();
+    const DeviceCore &core = device->core();
+
+    switch (op) {
+        case OpPowerPress: device->post(DeviceInput::PowerPress); break;
+        case OpPowerRelease: device->post(DeviceInput::PowerRelease); break;
+        case OpIntensityUp: device->post(DeviceInput::IntensityUp); break;
+        case OpIntensityDown: device->post(DeviceInput::IntensityDown); break;
+        case OpStartSession: device->post(DeviceInput::StartSession); break;
+        case OpSetBattery: device->post(DeviceInput::SetBattery, arg); break;
+        case OpResetBattery: device->post(DeviceInput::ResetBattery); break;
+        case OpSetConnection: device->post(DeviceInput::SetConnection, arg); break;
+        case OpUsername: device->post(DeviceInput::Username, 0, QString::fromUtf8(payload, length)); break;
+        case OpRecord: device->post(DeviceInput::Record); break;
+        case OpReplay: device->post(DeviceInput::Replay); break;
+
+        case OpGetState: appendLE<qint32>(out, core.getState()); break;
+        case OpGetBattery: appendF64(out, core.getBatteryLevel()); break;
+        case OpGetConnection: appendLE<qint32>(out, core.getConnectionStatus()); break;
+        case OpGetIntensity: appendLE<qint32>(out, core.getIntensity()); break;
+        case OpGetWavelength: appendLE<qint32>(out, core.snapshot().wavelength); break;
+        case OpGetRemainingTime: appendLE<qint32>(out, core.getRemainingSessionTime()); break;
+        case OpGetSelection:
+            appendLE<qint32>(out, core.getSelectedSessionGroup());
+            appendLE<qint32>(out, core.getSelectedSessionType());
+            appendLE<qint32>(out, core.getSelectedUserSession());
+            appendLE<qint32>(out, core.getSelectedRecordedTherapy());
+            break;
+        case OpGetFlags:
+            appendLE<quint32>(out, (core.getToggleRecord() ? 1 : 0) | (core.getDisconnected() ? 2 : 0) |
+                                   (core.getReturningToSafeVoltage() ? 4 : 0) | (core.getRunBatteryAnimation() ? 8 : 0));
+            break;
+        case OpGetUsername: out.append(device->getInputtedName().toUtf8()); break;
+        case OpGetSnapshot: appendSnapshot(out); break;
+        case OpGetTherapies: {
+            const std::vector<Therapy *> &therapies = core.getRecordedTherapies();
+            appendLE<quint32>(out, therapies.size());
+            for (Therapy *t : therapies) {
+                appendLE<qint32>(out, t->intensity);
+                appendString(out, QString::fromStdString(t->username));
+                appendString(out, QString::fromStdString(t->group.name));
+                appendString(out, QString::fromStdString(t->type.name));
+            }
+            break;
+        }
+
+        case OpSubscribe: client.subscriptions = (quint32)arg; break;
+        case OpPing: break;
+
+        default:
+            appendLE<quint16>(out, op);
+            appendFrame(client.outbox, OpError | REPLY_BIT, id, out);
+            return;
+    }
+
+    if (reply) {
+        appendFrame(client.outbox, op | REPLY_BIT, id, out);
+    }
+}
+
+/*
+    Function: appendFrame
+    Purpose: Queue one frame, or an OpError reply naming the opcode when the payload is longer
+             than the header's u16 length can describe
+    Return: void
+*/
+void ControlServer::appendFrame(QByteArray &out, quint16 opcode, quint32 id, const QByteArray &payload) {
+    if (payload.size() > MAX_PAYLOAD_SIZE) {
+        QByteArray error;
+        appendLE<quint16>(error, opcode & (quint16)~REPLY_BIT);
+        appendFrame(out, OpError | REPLY_BIT, id, error);
+        return;
+    }
+    appendLE<quint16>(out, opcode);
+    appendLE<quint16>(out, (quint16)payload.size());
+    appendLE<quint32>(out, id);
+    out.append(payload);
+}
+
+/*
+    Function: appendSnapshot
+    Purpose: Encode the device snapshot as a fixed 48 byte record:
+             i32 state, batteryState, connectionStatus, wavelength, f64 batteryLevel,
+             i32 intensity, remainingSessionTime, group, type, userSession, recordedTherapy,
+             u32 flags (toggleRecord, disconnected, returningToSafeVoltage)
+    Return: void
+*/
+void ControlServer::appendSnapshot(QByteArray &out) {
+    DeviceSnapshot s = device->core().snapshot();
+    appendLE<qint32>(out, s.state);
+    appendLE<qint32>(out, s.batteryState);
+    appendLE<qint32>(out, s.connectionStatus);
+    appendLE<qint32>(out, s.wavelength);
+    appendF64(out, s.batteryLevel);
+    appendLE<qint32>(out, s.intensity);
+    appendLE<qint32>(out, s.remainingSessionTime);
+    appendLE<qint32>(out, s.selectedSessionGroup);
+    appendLE<qint32>(out, s.selectedSessionType);
+    appendLE<qint32>(out, s.selectedUserSession);
+    appendLE<qint32>(out, s.selectedRecordedTherapy);
+    appendLE<quint32>(out, (s.toggleRecord ? 1 : 0) | (s.disconnected ? 2 : 0) | (s.returningToSafeVoltage ? 4 : 0));
+}
+
+// queue a notification for every subscribed client, sent now unless a batch is being handled
+void ControlServer::notify(quint32 mask, quint16 opcode, const QByteArray &payload) {
+    for (auto it = clients.begin(); it != clients.end(); ++it) {
+        Client &client = it.value();
+        if (!(client.subscriptions & mask)) continue;
+        appendFrame(client.outbox, opcode, 0, payload);
+        if (!client.inBatch) flush(it.key(), client);
+    }
+}
+
+void ControlServer::flush(QLocalSocket *socket, Client &client) {
+    if (client.outbox.isEmpty()) return;
+    socket->write(client.outbox);
+    client.outbox.clear();
+}
+
+void ControlServer::deviceUpdated() {
+    // skip encoding the snapshot when nobody is listening
+    bool wanted = false;
+    for (const Client &client : clients) wanted = wanted || (client.subscriptions & NotifyDeviceUpdated);
+    if (!wanted) return;
+
+    QByteArray payload;
+    appendSnapshot(payload);
+    notify(NotifyDeviceUpdated, OpDeviceUpdated, payload);
+}
+
+void ControlServer::connectionTest(bool isStart) {
+    notify(NotifyConnectionTest, OpConnectionTest, QByteArray(1, isStart ? 1 : 0));
+}
+
+void ControlServer::safeVoltage(bool isStart) {
+    notify(NotifySafeVoltage, OpSafeVoltage, QByteArray(1, isStart ? 1 : 0));
+}
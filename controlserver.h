@@ -0,0 +1,57 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+#include "device.h"
+#include "controlprotocol.h"
+
+/*
+    Class: ControlServer
+    Purpose: Unix domain socket server that lets external harnesses press the device's
+             inputs, read its state and subscribe to its signals using the binary frames
+             described in controlprotocol.h
+ */
+class ControlServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ControlServer(Device *, QObject *parent = nullptr);
+    ~ControlServer();
+
+    Q_INVOKABLE bool listen(QString);
+    QString serverPath() const;
+
+private:
+    struct Client {
+        QByteArray inbox;
+        QByteArray outbox;
+        quint32 subscriptions;
+        bool inBatch;
+    };
+
+    Device *device;
+    QLocalServer server;
+    QHash<QLocalSocket *, Client> clients;
+
+    void handleFrame(Client &, quint16, quint32, const char *, int);
+    void appendFrame(QByteArray &, quint16, quint32, const QByteArray & = QByteArray());
+    void appendSnapshot(QByteArray &);
+    void notify(quint32, quint16, const QByteArray &);
+    void flush(QLocalSocket *, Client &);
+
+private slots:
+    void newConnection();
+    void readClient();
+    void clientDisconnected();
+    void deviceUpdated();
+    void connectionTest(bool);
+    void safeVoltage(bool);
+};
+
+#endif // CONTROLSERVER_H
@@ -0,0 +1,145 @@
+#include "dashboard.h"
+
+#include <QPainter>
+#include <QtMath>
+
+// colours indices
+enum DashColour {CellOff, CellIdle, CellSession, CellPaused, CellTesting, CellSoftOff,
+                 Empty, BatteryHigh, BatteryLow, BatteryCritical, Intensity, Wave,
+                 ConnNo, ConnOkay, ConnExcellent, DashColourCount};
+
+DashboardWidget::DashboardWidget(QVector<Device *> d, QWidget *parent) : QWidget(parent),
+                                                                         devices(d),
+                                                                         snapshots(d.size()),
+                                                                         framesThisSecond(0),
+                                                                         buckets(DashColourCount) {
+    colours = {QColor(30, 30, 30), QColor(40, 60, 90), QColor(30, 90, 40), QColor(110, 80, 20),
+               QColor(70, 40, 100), QColor(60, 90, 90), QColor(10, 10, 10), QColor("green"),
+               QColor("yellow"), QColor("red"), QColor(120, 255, 120), QColor(255, 90, 90),
+               QColor("red"), QColor("yellow"), QColor("green")};
+
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumSize(640, 480);
+    setWindowTitle("Oasis Pro Fleet");
+
+    this->frameTimer.setInterval(16);
+    this->frameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&frameTimer, SIGNAL(timeout()), this, SLOT(nextFrame()));
+    this->frameTimer.start();
+    this->fpsClock.start();
+}
+
+DashboardWidget::~DashboardWidget() {
+    for (Device *device : devices)
+        delete device;
+}
+
+// columns that keep the cells closest to the window's aspect ratio
+int DashboardWidget::columnCount() const {
+    int n = devices.size() > 0 ? devices.size() : 1;
+    int columns = qCeil(qSqrt(n * (double)width() / height()));
+    return columns > 0 ? columns : 1;
+}
+
+void DashboardWidget::addRect(int colour, const QRect &rect) {
+    buckets[colour].append(rect);
+}
+
+/*
+    Function: nextFrame [Slot]
+    Purpose: Snapshot every device and schedule one repaint, also tracks the frame rate
+    Return: void
+ */
+void DashboardWidget::nextFrame() {
+    for (int i = 0; i < devices.size(); ++i) {
+        snapshots[i] = devices[i]->core().readSnapshot();
+    }
+    update();
+
+    ++framesThisSecond;
+    if (fpsClock.elapsed() >= 1000) {
+        setWindowTitle(QString("Oasis Pro Fleet - %1 devices - %2 fps").arg(devices.size()).arg(framesThisSecond));
+        framesThisSecond = 0;
+        fpsClock.restart();
+    }
+}
+
+/*
+    Function: paintEvent
+    Purpose: Draw one cell per device: state background, battery bar, intensity bar with a segment per level,
+             wavelength marks and connection dot. Battery numbers only fit on larger cells.
+    Return: void
+ */
+void DashboardWidget::paintEvent(QPaintEvent *) {
+    QPainter painter(this);
+    painter.fillRect(rect(), colours[Empty]);
+
+    int columns = columnCount();
+    int rows = (snapshots.size() + columns - 1) / columns;
+    int cellW = width() / columns;
+    int cellH = rows > 0 ? height() / rows : height();
+    if (cellW < 4 || cellH < 4) return;
+
+    for (QVector<QRect> &bucket : buckets) bucket.clear();
+
+    const int pad = cellW > 12 ? 1 : 0;
+    for (int i = 0; i < snapshots.size(); ++i) {
+        const DeviceSnapshot &s = snapshots[i];
+        int x = (i % columns) * cellW + pad;
+        int y = (i / columns) * cellH + pad;
+        int w = cellW - 2 * pad;
+        int h = cellH - 2 * pad;
+
+        int background = s.state == State::Off ? CellOff
+                       : s.state == State::InSession ? CellSession
+                       : s.state == State::Paused ? CellPaused
+                       : s.state == State::TestingConnection ? CellTesting
+                       : s.state == State::SoftOff ? CellSoftOff : CellIdle;
+        addRect(background, QRect(x, y, w, h));
+        if (s.state == State::Off) continue;
+
+        // battery across the top quarter
+        int barH = h / 4 > 1 ? h / 4 : 1;
+        int batteryColour = s.batteryState == BatteryState::Critical ? BatteryCritical
+                          : s.batteryState == BatteryState::Low ? BatteryLow : BatteryHigh;
+        addRect(batteryColour, QRect(x, y, (int)(w * s.batteryLevel / 100), barH));
+
+        // intensity as a segment per level up the right side
+        int levels = s.maxIntensity > 0 ? s.maxIntensity : 1;
+        int segH = (h - barH) / levels;
+        int segW = w / 4 > 1 ? w / 4 : 1;
+        for (int light = 0; light < levels && segH > 0; ++light) {
+            QRect seg(x + w - segW, y + h - (light + 1) * segH, segW, segH > 2 ? segH - 1 : segH);
+            addRect(light < s.intensity ? Intensity : Empty, seg);
+        }
+
+        // wavelength marks and connection dot along the bottom left
+        int mark = h / 6 > 1 ? h / 6 : 1;
+        if (s.wavelength == WaveSmall || s.wavelength == WaveBoth)
+            addRect(Wave, QRect(x + 1, y + h - 2 * mark - 1, mark, mark));
+        if (s.wavelength == WaveBig || s.wavelength == WaveBoth)
+            addRect(Wave, QRect(x + mark + 2, y + h - 2 * mark - 1, 2 * mark, 2 * mark));
+        int conn = s.connectionStatus == ConnectionStatus::No ? ConnNo
+                 : s.connectionStatus == ConnectionStatus::Okay ? ConnOkay : ConnExcellent;
+        addRect(conn, QRect(x + 1, y + barH + 1, mark, mark));
+    }
+
+    painter.setPen(Qt::NoPen);
+    for (int c = 0; c < buckets.size(); ++c) {
+        if (buckets[c].isEmpty()) continue;
+        painter.setBrush(colours[c]);
+        painter.drawRects(buckets[c].constData(), buckets[c].size());
+    }
+
+    // text is the expensive part, only draw it when there is room to read it
+    if (cellW >= 60 && cellH >= 40) {
+        painter.setPen(Qt::white);
+        for (int i = 0; i < snapshots.size(); ++i) {
+            if (snapshots[i].state == State::Off) continue;
+            int x = (i % columns) * cellW;
+            int y = (i / columns) * cellH;
+            painter.drawText(QRect(x, y + cellH / 4, cellW - cellW / 4, cellH / 2), Qt::AlignCenter,
+                             QString::number((int)snapshots[i].batteryLevel));
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef DASHBOARD_H
+#define DASHBOARD_H
+
+#include <QWidget>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QColor>
+
+#include "device.h"
+
+/*
+    Class: DashboardWidget
+    Purpose: Shows a whole fleet of devices in one painted grid. Once per frame every device
+             is copied into a snapshot and the grid is drawn from the snapshots alone,
+             with all cells of a colour filled in one batched call.
+ */
+class DashboardWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit DashboardWidget(QVector<Device *>, QWidget *parent = nullptr);
+    ~DashboardWidget();
+
+protected:
+    void paintEvent(QPaintEvent *) override;
+
+private:
+    QVector<Device *> devices;
+    QVector<DeviceSnapshot> snapshots;
+    QTimer frameTimer;
+    QElapsedTimer fpsClock;
+    int framesThisSecond;
+
+    // rectangles waiting to be filled, one bucket per colour
+    QVector<QColor> colours;
+    QVector<QVector<QRect>> buckets;
+
+    int columnCount() const;
+    void addRect(int, const QRect &);
+
+private slots:
+    void nextFrame();
+};
+
+#endif // DASHBOARD_H
@@ -1,34 +1,60 @@
 #ifndef DEFS_H
 #define DEFS_H
 
-#include <QString>
-#include <QVector>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "allocstats.h"
 
 struct SessionGroup {
-    QString name;
+    std::string name;
     int durationMins;
-    SessionGroup(QString n, int d) : name(n), durationMins(d) {}
+    [[no_unique_address]] CopyCount<SessionGroup> copyCount;  // counted with alloc_stats, empty otherwise
+    SessionGroup(std::string n, int d) : name(n), durationMins(d) {}
 };
 
 struct SessionType {
-    QString name;
-    QString wavelength;
-    SessionType(QString n, QString w) : name(n), wavelength(w) {}
+    std::string name;
+    std::string wavelength;
+    double frequency; // stimulation frequency in Hz
+    double bandLow;   // band the delivered signal must peak in, Hz
+    double bandHigh;
+    [[no_unique_address]] CopyCount<SessionType> copyCount;
+    SessionType(std::string n, std::string w, double f = 0, double lo = 0, double hi = 0) : name(n), wavelength(w), frequency(f), bandLow(lo), bandHigh(hi) {}
 };
 
 struct Therapy {
     SessionGroup group;
     SessionType type;
     int intensity;
-    QString username;
-    Therapy(SessionGroup g, SessionType t, int i, QString u) : group(g), type(t), intensity(i), username(u) {}
+    std::string username;
+    [[no_unique_address]] CopyCount<Therapy> copyCount;
+    Therapy(SessionGroup g, SessionType t, int i, std::string u) : group(g), type(t), intensity(i), username(u) {}
+    // line shown in the treatment history
+    std::string summary() const { return username + " | " + group.name + " | " + type.name + " | " + std::to_string(intensity); }
 };
 
-struct UserDesignedSession {
-    QString name;
+// one typed step of a user designed session, intensities of -1 follow the device's intensity
+struct SessionSegment {
+    SessionType *type;
     int durationMins;
-    QVector<SessionType*> types;
-    UserDesignedSession(QString n, int d, QVector<SessionType*> t) : name(n), durationMins(d), types(t){}
+    int intensityFrom; // ramped across the segment
+    int intensityTo;
+    SessionSegment(SessionType *t = nullptr, int d = 0, int from = -1, int to = -1) : type(t), durationMins(d), intensityFrom(from), intensityTo(to) {}
+};
+
+struct UserDesignedSession {
+    std::string name;
+    int durationMins;                  // total of the segments
+    std::vector<SessionType*> types;   // distinct types in program order, for the display
+    std::vector<SessionSegment> segments;
+    UserDesignedSession(std::string n, std::vector<SessionSegment> s) : name(n), durationMins(0), segments(s) {
+        for (const SessionSegment &segment : segments) {
+            durationMins += segment.durationMins;
+            if (std::find(types.begin(), types.end(), segment.type) == types.end()) types.push_back(segment.type);
+        }
+    }
 };
 
 #endif // DEFS_H
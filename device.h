@@ -3,114 +3,48 @@
 
 #include <QObject>
 #include <QString>
-#include <QAbstractButton>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QDebug>
 #include <QVector>
-#include <QListWidgetItem>
+#include <QStringList>
 
-#include "defs.h"
+#include <array>
 
-enum State {Off, ChoosingSession, ChoosingRecordedTherapy, InSession, Paused, TestingConnection, SoftOff};
-enum BatteryState {High, Low, Critical};
-enum ConnectionStatus {No=3, Okay=2, Excellent=1}; // ints used in battery drain
+#include "devicecore.h"
 
-class Device : public QObject
+/*
+    Class: Device
+    Purpose: Runs a DeviceCore on Qt: its timers are QTimers on the device's thread, its clock
+             a QElapsedTimer, and what it reports becomes the signals the window listens to.
+             The state machine, battery and therapies all live in the core.
+ */
+class Device : public QObject, private DeviceHost
 {
     Q_OBJECT
 public:
     explicit Device(QObject *parent = nullptr);
-    ~Device();
 
-    // getters
-    State getState() const;
-    double getBatteryLevel() const;
-    ConnectionStatus getConnectionStatus() const;
-    int getIntensity() const;
-    QString getActiveWavelength() const;
-    bool getRunBatteryAnimation() const;
-    int getSelectedSessionGroup() const;
-    int getSelectedSessionType() const;
-    int getSelectedUserSession() const;
-    bool getToggleRecord() const;
-    QString getInputtedName() const;
-    // pseudo-getters
-    int getRemainingSessionTime();
-    BatteryState getBatteryState();
-
-    QVector<Therapy *> getRecordedTherapies() const;
-    QVector<SessionType*> getUserSessionTypes() const;
-
-    int getSelectedRecordedTherapy() const;
-
-    bool getDisconnected() const;
-
-
-    bool getReturningToSafeVoltage() const;
-
-private:
-    State state;
-    bool toggleRecord;
-
-    QTimer softOffTimer;
-
-    QTimer sessionTimer;
-    int remainingSessionTime; // time left after pause, ms
+    DeviceCore &core();
+    const DeviceCore &core() const;
 
-    QTimer powerButtonTimer;
+    // queue an input from any thread, it is applied with the rest of its batch on the device thread
+    bool post(DeviceInput, int = 0, QString = QString());
 
-    QTimer testConnectionTimer;
-    QTimer safeVoltageTimer;
-    QTimer voltageTimer;
-
-    QTimer batteryLevelTimer;
-    double batteryLevel;
-    bool lowBatteryTriggered;
-    bool criticalBatteryTriggered;
-    bool runBatteryAnimation;
-    bool disconnected;
-    bool returningToSafeVoltage;
-
-    QString activeWavelength;
-    int intensity;
-    ConnectionStatus connectionStatus;
-
-    // this is peter guessing at how this will work
-    // highlighted / currently selected
-    int selectedSessionGroup; // (time) 0, 1, 2
-    int selectedSessionType; // (frequency) 0, 1, 2, 3
-    int selectedUserSession;
-
-    // stored data of the groups and sessions we have, set up in ctor
-    QVector<SessionGroup*> sessionGroups;
-    QVector<SessionType*> sessionTypes;
-    QVector<UserDesignedSession*> userDesignedSessions;
-
-    // Data Structure for recorded therapies saved by user
-    int selectedRecordedTherapy;
-    QVector<Therapy*> recordedTherapies;
-    QString inputtedName; // Holds the text value in the username textbox
-
-    void powerOn();
-    void powerOff();
-    void stopAllTimers();
-    void softOff();
-    void pauseSession();
-    void resumeSession();
-    void enterTestMode();
-    void configureDevice();
-    void startSession();
-    void recordTherapy(QString);
-    void adjustIntensity(int);
-    void adjustSelectedRecordedTherapy(int);
-    void replayTherapy(QListWidgetItem*);
-    void userSessionWaveLength();
+    // the parts of the core's interface that take or give strings
+    QString getActiveWavelength() const;
+    QString getInputtedName() const;
+    QStringList getTherapySummaries() const;
+    bool renderSessionWaveform(QString, int = DEFAULT_SAMPLE_RATE) const;
+    bool loadHistory(QString);
+    Q_INVOKABLE bool saveHistory(QString) const;
+    bool restoreCheckpoint(QString);
+    bool enableCheckpoints(QString);
 
 public slots:
     void PowerButtonPressed();
     void PowerButtonReleased();
-    void CesReduction();
-    void INTArrowButtonClicked(QAbstractButton*);
+    void IntensityArrowClicked(int);
     void StartSessionButtonClicked();
     void SetBattery(int);
     void ResetBattery();
@@ -118,18 +52,32 @@ public slots:
     void UsernameInputted(QString);
     void RecordButtonClicked();
     void ReplayButtonClicked();
-
-private slots:
-    void SessionComplete(); // for session timer
-    void PowerButtonHeld(); // for powerbutton timer
-    void DepleteBattery(); // for battery timer
-    void confirmConnection();
-    void returnToSafeVoltage();
+    void DrainInputs();
 
 signals:
     void deviceUpdated();
+    void therapiesChanged(QStringList);
     void connectionTest(bool);
     void safeVoltage(bool);
+
+private:
+    // declared before the core, which reads them while it is constructed
+    QElapsedTimer deviceClock;
+    std::array<QTimer *, CORE_TIMERS> timers;
+    DeviceCore deviceCore;
+
+    void startTimer(CoreTimer, int ms) override;
+    void stopTimer(CoreTimer) override;
+    bool timerActive(CoreTimer) const override;
+    int remainingTime(CoreTimer) const override;
+    long long elapsedUs() const override;
+    int64_t wallClockMs() const override;
+    void wake() override;
+    void updated() override;
+    void therapiesRecorded() override;
+    void connectionTesting(bool) override;
+    void safeVoltageReturn(bool) override;
+    void log(const std::string &) override;
 };
 
 #endif // DEVICE_H
@@ -0,0 +1,1598 @@
+#include "devicecore.h"
+
+#include <algorithm>
+#include <iterator>
+
+// the ticks that keep going until stopped, everything else fires once
+bool coreTimerRepeats(CoreTimer timer) {
+    return timer == BatteryTimer || timer == ImpedanceTimer || timer == TelemetryTimer;
+}
+
+const char *coreTimerName(CoreTimer timer) {
+    switch (timer) {
+        case PowerButtonTimer: return "timer:powerButton";
+        case SessionTimer: return "timer:session";
+        case SegmentTimer: return "timer:segment";
+        case TestConnectionTimer: return "timer:testConnection";
+        case SafeVoltageTimer: return "timer:safeVoltage";
+        case RampTimer: return "timer:ramp";
+        case BatteryTimer: return "timer:battery";
+        case ImpedanceTimer: return "timer:impedance";
+        case TelemetryTimer: return "timer:telemetry";
+        case CORE_TIMERS: break;
+    }
+    return "timer:?";
+}
+
+// the lifecycle of a hardware revision, with the default ramps until setRamp changes them
+template <class Hardware>
+static LifecycleConfig hardwareLifecycle() {
+    LifecycleConfig config = defaultLifecycleConfig();
+    config.minIntensity = Hardware::Intensity::MIN;
+    config.maxIntensity = Hardware::Intensity::MAX;
+    config.testConnectionMs = Hardware::Connection::TEST_MS;
+    config.safeVoltageDelayMs = Hardware::Connection::SAFE_VOLTAGE_DELAY;
+    return config;
+}
+
+template <class Hardware>
+BasicDeviceCore<Hardware>::BasicDeviceCore(DeviceHost *h) : host(h),
+                                                            state(State::Off),
+                                                            toggleRecord(false),
+                                                            remainingSessionTime(-1),
+                                                            activeSegment(-1),
+                                                            ramps(hardwareLifecycle<Hardware>()),
+                                                            lifecycle(ramps),
+                                                            batteryLevel(50),
+                                                            lowBatteryTriggered(false),
+                                                            criticalBatteryTriggered(false),
+                                                            runBatteryAnimation(false),
+                                                            batteryAnimations(0),
+                                                            disconnected(false),
+                                                            activeWavelength("none"),
+                                                            connectionStatus(ConnectionStatus::Excellent),
+                                                            impedanceModel(nullptr),
+                                                            inputs(1024),
+                                                            drainPending(false),
+                                                            telemetry(nullptr),
+                                                            telemetrySeries(0),
+                                                            shared(nullptr),
+                                                            sharedSlot(-1),
+                                                            sessionsStarted(0),
+                                                            safeVoltageReturns(0),
+                                                            checkpoints(nullptr),
+                                                            selectedSessionGroup(0),
+                                                            selectedSessionType(0),
+                                                            selectedUserSession(0),
+                                                            selectedRecordedTherapy(0),
+                                                            history(Intensity::MAX) {
+    configureDevice();
+    this->presetTherapies = recordedTherapies.size();
+    PublishSnapshot();
+}
+
+// catalog and therapy objects are released by their arenas
+template <class Hardware>
+BasicDeviceCore<Hardware>::~BasicDeviceCore() {
+    delete impedanceModel;
+    delete checkpoints;
+}
+
+/*
+    Function: onTimer
+    Purpose: Run what one of the host's timers was started for
+    Inputs:
+        timer: CoreTimer that went off
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::onTimer(CoreTimer timer) {
+    TRACE_INSTANT(coreTimerName(timer));
+    switch (timer) {
+        case PowerButtonTimer: PowerButtonHeld(); break;
+        case SessionTimer: SessionComplete(); break;
+        case SegmentTimer: SegmentChanged(); break;
+        case TestConnectionTimer: confirmConnection(); break;
+        case SafeVoltageTimer: returnToSafeVoltage(); break;
+        case RampTimer: RampStep(); break;
+        case BatteryTimer: DepleteBattery(); break;
+        case ImpedanceTimer: SampleImpedance(); break;
+        case TelemetryTimer: SampleTelemetry(); break;
+        case CORE_TIMERS: break;
+    }
+}
+
+// the host's monotonic clock in ms, what the energy ledger runs on
+template <class Hardware>
+long long BasicDeviceCore<Hardware>::clockMs() const {
+    return host->elapsedUs() / 1000;
+}
+
+// every change the display hears about can change how fast the battery drains
+template <class Hardware>
+void BasicDeviceCore<Hardware>::changed() {
+    UpdateEnergyRate();
+    PublishSnapshot();
+    host->updated();
+}
+
+// Initialize session groups/types and create preset user-designed sessions and therapies
+template <class Hardware>
+void BasicDeviceCore<Hardware>::configureDevice() {
+    for (const CatalogGroup &group : Catalog::groups) {
+        sessionGroups.push_back(groupArena.make(group.name, group.durationMins));
+    }
+    for (const CatalogType &type : Catalog::types) {
+        sessionTypes.push_back(typeArena.make(type.name, type.wavelength, type.frequency, type.bandLow, type.bandHigh));
+    }
+
+    // preset user designed sessions, each made of its segments in catalog order
+    for (int session = 0; session < (int)std::size(Catalog::userSessions); ++session) {
+        std::vector<SessionSegment> program;
+        for (const CatalogSegment &segment : Catalog::segments) {
+            if (segment.session != session) continue;
+            program.push_back(SessionSegment(sessionTypes.at(segment.type), segment.durationMins, segment.intensityFrom,
+                                             segment.intensityTo));
+        }
+        userDesignedSessions.push_back(userSessionArena.make(Catalog::userSessions[session], program));
+    }
+
+    // preset recorded therapies
+    for (const CatalogTherapy &therapy : Catalog::therapies) {
+        recordedTherapies.push_back(therapyArena.make(*sessionGroups.at(therapy.group), *sessionTypes.at(therapy.type),
+                                                      therapy.intensity, therapy.username));
+    }
+}
+
+template <class Hardware>
+State BasicDeviceCore<Hardware>::getState() const {
+    return state;
+}
+
+template <class Hardware>
+double BasicDeviceCore<Hardware>::getBatteryLevel() const {
+    return batteryLevel;
+}
+
+template <class Hardware>
+ConnectionStatus BasicDeviceCore<Hardware>::getConnectionStatus() const {
+    return connectionStatus;
+}
+
+template <class Hardware>
+int BasicDeviceCore<Hardware>::getIntensity() const {
+    return lifecycle.level();
+}
+
+template <class Hardware>
+const std::string &BasicDeviceCore<Hardware>::getActiveWavelength() const {
+    return activeWavelength;
+}
+
+template <class Hardware>
+BatteryState BasicDeviceCore<Hardware>::getBatteryState() const {
+    if (this->batteryLevel <= Battery::CRITICAL_PERCENT) {
+        return BatteryState::Critical;
+    } else if (this->batteryLevel <= Battery::LOW_PERCENT) {
+        return BatteryState::Low;
+    }
+    return BatteryState::High;
+}
+
+template <class Hardware>
+int BasicDeviceCore<Hardware>::getRemainingSessionTime() const {
+    return this->state == State::Paused ? remainingSessionTime : host->remainingTime(SessionTimer);
+}
+
+/*
+    Function: snapshot
+    Purpose: Copy the display state of the device into a plain struct, for views that
+             draw many devices per frame and can't afford a getter call per field
+    Return: DeviceSnapshot
+*/
+template <class Hardware>
+DeviceSnapshot BasicDeviceCore<Hardware>::snapshot() const {
+    DeviceSnapshot s;
+    s.state = state;
+    s.batteryState = getBatteryState();
+    s.connectionStatus = connectionStatus;
+    s.wavelength = activeWavelength == "small" ? WaveSmall : activeWavelength == "big" ? WaveBig
+                 : activeWavelength == "both" ? WaveBoth : WaveNone;
+    s.batteryLevel = batteryLevel;
+    s.intensity = lifecycle.level();
+    s.maxIntensity = Intensity::MAX;
+    s.remainingSessionTime = getRemainingSessionTime();
+    s.selectedSessionGroup = selectedSessionGroup;
+    s.selectedSessionType = selectedSessionType;
+    s.selectedUserSession = selectedUserSession;
+    s.selectedRecordedTherapy = selectedRecordedTherapy;
+    s.therapyCount = recordedTherapies.size();
+    s.batteryAnimations = batteryAnimations;
+    s.disconnected = disconnected;
+    s.returningToSafeVoltage = getReturningToSafeVoltage();
+    s.toggleRecord = toggleRecord;
+    s.version = published.version();
+    return s;
+}
+
+// the snapshot as of the last change, never blocks the core's thread
+template <class Hardware>
+DeviceSnapshot BasicDeviceCore<Hardware>::readSnapshot() const {
+    return published.load();
+}
+
+/*
+    Function: PublishSnapshot
+    Purpose: Publish the current state for readers on other threads, runs on every change
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::PublishSnapshot() {
+    DeviceSnapshot s = snapshot();
+    s.version++;
+    published.store(s);
+    if (shared) publishShared(s);
+    if (checkpoints) writeCheckpoint();
+}
+
+/*
+    Function: setSharedState
+    Purpose: Publish this device into a shared memory table from now on, starting with how it
+             is now
+    Inputs:
+        table: SharedStateTable, outlives the device, nullptr stops publishing
+        slot: slot claimed for this device, a negative slot (table full) stops publishing
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::setSharedState(SharedStateTable *table, int32_t slot) {
+    this->shared = slot >= 0 ? table : nullptr;
+    this->sharedSlot = slot;
+    if (shared) publishShared(published.load());
+}
+
+// the snapshot in the shared layout, stamped with the wall clock
+template <class Hardware>
+void BasicDeviceCore<Hardware>::publishShared(const DeviceSnapshot &s) {
+    SharedDeviceState out;
+    out.state = s.state;
+    out.batteryState = s.batteryState;
+    out.connectionStatus = s.connectionStatus;
+    out.wavelength = s.wavelength;
+    out.batteryLevel = s.batteryLevel;
+    out.intensity = s.intensity;
+    out.remainingSessionTime = s.remainingSessionTime;
+    out.selectedSessionGroup = s.selectedSessionGroup;
+    out.selectedSessionType = s.selectedSessionType;
+    out.selectedUserSession = s.selectedUserSession;
+    out.therapyCount = s.therapyCount;
+    out.batteryAnimations = s.batteryAnimations;
+    out.flags = (s.toggleRecord ? SHARED_TOGGLE_RECORD : 0) | (s.disconnected ? SHARED_DISCONNECTED : 0)
+              | (s.returningToSafeVoltage ? SHARED_SAFE_VOLTAGE : 0);
+    out.version = s.version;
+    out.sessionsStarted = sessionsStarted;
+    out.safeVoltageReturns = safeVoltageReturns;
+    out.maxIntensity = s.maxIntensity;
+    out.publishedMs = host->wallClockMs();
+    shared->publish(sharedSlot, out);
+}
+
+/*
+    Function: checkpoint
+    Purpose: Copy what a restart needs into a DeviceCheckpoint, running timers become wall
+             clock deadlines
+    Return: DeviceCheckpoint
+*/
+template <class Hardware>
+DeviceCheckpoint BasicDeviceCore<Hardware>::checkpoint() const {
+    int64_t now = host->wallClockMs();
+    auto deadline = [this, now](CoreTimer timer) -> int64_t {
+        int left = host->remainingTime(timer);
+        return host->timerActive(timer) ? now + (left > 0 ? left : 0) : 0;
+    };
+    DeviceCheckpoint c;
+    c.sessionDeadlineMs = state == State::InSession ? deadline(SessionTimer) : 0;
+    c.testConnectionDeadlineMs = deadline(TestConnectionTimer);
+    c.safeVoltageDeadlineMs = deadline(SafeVoltageTimer);
+    c.voltageDeadlineMs = lifecycle.rampUse() == SafeVoltageRamp ? now + lifecycle.rampLeftUs(host->elapsedUs()) / 1000 : 0;
+    c.batteryLevel = batteryLevel;
+    c.state = state;
+    c.connectionStatus = connectionStatus;
+    c.intensity = lifecycle.level();
+    c.selectedSessionGroup = selectedSessionGroup;
+    c.selectedSessionType = selectedSessionType;
+    c.selectedUserSession = selectedUserSession;
+    c.selectedRecordedTherapy = selectedRecordedTherapy;
+    c.remainingSessionMs = state == State::Paused ? remainingSessionTime : -1;
+    c.flags = (disconnected ? CHECKPOINT_DISCONNECTED : 0) | (getReturningToSafeVoltage() ? CHECKPOINT_SAFE_VOLTAGE : 0)
+            | (toggleRecord ? CHECKPOINT_TOGGLE_RECORD : 0) | (lowBatteryTriggered ? CHECKPOINT_LOW_TRIGGERED : 0)
+            | (criticalBatteryTriggered ? CHECKPOINT_CRITICAL_TRIGGERED : 0);
+    c.therapyCount = recordedTherapies.size() - presetTherapies;
+    return c;
+}
+
+// append this moment to the checkpoint file, with any therapies it has not seen yet
+template <class Hardware>
+void BasicDeviceCore<Hardware>::writeCheckpoint() {
+    TRACE_SCOPE("DeviceCore::writeCheckpoint");
+    std::vector<CheckpointTherapy> added;
+    for (int i = presetTherapies + (int)checkpoints->therapiesWritten(); i < (int)recordedTherapies.size(); ++i) {
+        const Therapy *t = recordedTherapies.at(i);
+        CheckpointTherapy therapy;
+        therapy.group = 0;
+        therapy.type = 0;
+        for (int g = 0; g < (int)sessionGroups.size(); ++g) {
+            if (sessionGroups.at(g)->name == t->group.name) therapy.group = g;
+        }
+        for (int k = 0; k < (int)sessionTypes.size(); ++k) {
+            if (sessionTypes.at(k)->name == t->type.name) therapy.type = k;
+        }
+        therapy.intensity = t->intensity;
+        therapy.username = t->username;
+        added.push_back(therapy);
+    }
+    if (!checkpoints->write(checkpoint(), added, inputtedName)) {
+        host->log("Could not write checkpoint");
+    }
+}
+
+/*
+    Function: enableCheckpoints
+    Purpose: Start a fresh checkpoint file with the device as it is now, every publish after
+             this appends what changed
+    Inputs:
+        path: string, checkpoint file
+    Return: false if the file could not be written
+*/
+template <class Hardware>
+bool BasicDeviceCore<Hardware>::enableCheckpoints(const std::string &path) {
+    delete checkpoints;
+    checkpoints = new CheckpointLog(path);
+    std::vector<CheckpointTherapy> none;
+    if (!checkpoints->write(checkpoint(), none, inputtedName)) {
+        delete checkpoints;
+        checkpoints = nullptr;
+        return false;
+    }
+    writeCheckpoint();  // therapies recorded before this
+    return true;
+}
+
+/*
+    Function: restoreCheckpoint
+    Purpose: Put the device back the way a checkpoint left it. A running session carries on
+             until its original deadline, a paused one keeps its time left, and the connection
+             test and safe voltage timers are re-armed with what was left of them.
+    Inputs:
+        path: string, checkpoint file
+    Return: false if there was no usable checkpoint, the device is left as constructed
+*/
+template <class Hardware>
+bool BasicDeviceCore<Hardware>::restoreCheckpoint(const std::string &path) {
+    TRACE_SCOPE("DeviceCore::restoreCheckpoint");
+    DeviceCheckpoint c;
+    std::vector<CheckpointTherapy> therapies;
+    std::string name;
+    if (!CheckpointLog::read(path, &c, &therapies, &name)) return false;
+    if (c.state < State::Off || c.state > State::SoftOff) return false;
+    auto inRange = [](int value, int size) { return value >= 0 && value < size; };
+    if (!inRange(c.selectedSessionGroup, sessionGroups.size()) || !inRange(c.selectedSessionType, sessionTypes.size())
+        || !inRange(c.selectedUserSession, userDesignedSessions.size())) {
+        return false;
+    }
+
+    for (const CheckpointTherapy &t : therapies) {
+        if (!inRange(t.group, sessionGroups.size()) || !inRange(t.type, sessionTypes.size())) continue;
+        recordedTherapies.push_back(therapyArena.make(*sessionGroups[t.group], *sessionTypes[t.type], t.intensity, t.username));
+    }
+    this->state = (State)c.state;
+    this->batteryLevel = c.batteryLevel;
+    this->connectionStatus = c.connectionStatus == ConnectionStatus::No ? ConnectionStatus::No
+                           : c.connectionStatus == ConnectionStatus::Okay ? ConnectionStatus::Okay : ConnectionStatus::Excellent;
+    lifecycle.setLevel(c.intensity);
+    this->selectedSessionGroup = c.selectedSessionGroup;
+    this->selectedSessionType = c.selectedSessionType;
+    this->selectedUserSession = c.selectedUserSession;
+    this->selectedRecordedTherapy = inRange(c.selectedRecordedTherapy, recordedTherapies.size()) ? c.selectedRecordedTherapy : 0;
+    this->disconnected = c.flags & CHECKPOINT_DISCONNECTED;
+    this->toggleRecord = c.flags & CHECKPOINT_TOGGLE_RECORD;
+    this->lowBatteryTriggered = c.flags & CHECKPOINT_LOW_TRIGGERED;
+    this->criticalBatteryTriggered = c.flags & CHECKPOINT_CRITICAL_TRIGGERED;
+    this->inputtedName = name;
+    this->energyLedger.setSessionUser(name);
+
+    int64_t now = host->wallClockMs();
+    auto left = [now](int64_t deadline) { return (int)(deadline > now ? deadline - now : 0); };
+
+    if (state == State::Off) {
+        this->activeWavelength = "none";
+    } else {
+        host->startTimer(BatteryTimer, BATTERY_TICK_MS);
+        if (impedanceModel) host->startTimer(ImpedanceTimer, IMPEDANCE_TICK_MS);
+        if (selectedSessionGroup == Catalog::USER_GROUP) {
+            userSessionWaveLength();
+        } else {
+            this->activeWavelength = sessionTypes[selectedSessionType]->wavelength;
+        }
+    }
+
+    if (state == State::InSession || state == State::Paused || state == State::SoftOff) {
+        this->sessionProgram = compileSession(SIM_MS_PER_MINUTE);
+        if (state == State::InSession) {
+            host->startTimer(SessionTimer, c.sessionDeadlineMs ? left(c.sessionDeadlineMs) : 0);
+        } else {
+            this->remainingSessionTime = c.remainingSessionMs;
+        }
+        if (state != State::SoftOff) {
+            applySegment();
+            // the ramp level was checkpointed, manual changes included
+            lifecycle.restore(state == State::InSession ? LifecyclePhase::InSession : LifecyclePhase::Paused, c.intensity);
+        }
+        if (state == State::InSession) scheduleSegment();
+        if (state == State::SoftOff) {
+            lifecycle.softOff(host->elapsedUs());
+            scheduleRamp();
+        }
+        energyLedger.beginSession(clockMs(), sessionGroups[selectedSessionGroup]->name,
+                                  selectedSessionGroup == Catalog::USER_GROUP ? userDesignedSessions[selectedUserSession]->name
+                                                            : sessionTypes[selectedSessionType]->name);
+    }
+    if (state == State::TestingConnection) lifecycle.testConnection();
+    if (c.testConnectionDeadlineMs) host->startTimer(TestConnectionTimer, left(c.testConnectionDeadlineMs));
+    if (c.safeVoltageDeadlineMs) host->startTimer(SafeVoltageTimer, left(c.safeVoltageDeadlineMs));
+    if (c.flags & CHECKPOINT_SAFE_VOLTAGE) {
+        returnToSafeVoltage();
+        if (c.voltageDeadlineMs && lifecycle.rampUse() == SafeVoltageRamp) {
+            const LifecycleConfig &config = ramps.config();
+            this->restoredRamp = Ramp(lifecycleRamp(SafeVoltageRamp, config.rampShapes[SafeVoltageRamp], lifecycle.level(), 0,
+                                                    left(c.voltageDeadlineMs)));
+            lifecycle.runRamp(SafeVoltageRamp, restoredRamp, host->elapsedUs());
+            scheduleRamp();
+        }
+    }
+
+    UpdateEnergyRate();
+    PublishSnapshot();
+    return true;
+}
+
+template <class Hardware>
+const std::vector<Therapy *> &BasicDeviceCore<Hardware>::getRecordedTherapies() const {
+    return recordedTherapies;
+}
+
+template <class Hardware>
+std::vector<std::string> BasicDeviceCore<Hardware>::getTherapySummaries() const {
+    std::vector<std::string> lines;
+    for (const Therapy *t : recordedTherapies) lines.push_back(t->summary());
+    return lines;
+}
+
+template <class Hardware>
+int BasicDeviceCore<Hardware>::getSelectedRecordedTherapy() const {
+    return selectedRecordedTherapy;
+}
+
+template <class Hardware>
+bool BasicDeviceCore<Hardware>::getDisconnected() const {
+    return disconnected;
+}
+
+template <class Hardware>
+bool BasicDeviceCore<Hardware>::getReturningToSafeVoltage() const
+{
+    return lifecycle.phase() == LifecyclePhase::SafeVoltage;
+}
+
+// where the session is in its lifecycle, Done outside a session
+template <class Hardware>
+LifecyclePhase BasicDeviceCore<Hardware>::getLifecyclePhase() const {
+    return lifecycle.phase();
+}
+
+// every finished session followed by the one running now, if any
+template <class Hardware>
+std::vector<SessionEnergy> BasicDeviceCore<Hardware>::getSessionEnergy() const {
+    std::vector<SessionEnergy> result = energyLedger.sessions();
+    if (energyLedger.inSession())
+        result.push_back(energyLedger.current(clockMs()));
+    return result;
+}
+
+// battery percent used by all sessions of a recorded therapy's group, type and user
+template <class Hardware>
+double BasicDeviceCore<Hardware>::getTherapyEnergy(int index) const {
+    const Therapy *therapy = recordedTherapies.at(index);
+    return energyLedger.totalFor(therapy->group.name, therapy->type.name,
+                                 therapy->username, clockMs());
+}
+
+template <class Hardware>
+const TherapyHistory &BasicDeviceCore<Hardware>::getHistory() const {
+    return history;
+}
+
+// replace the history with one saved earlier, call before the device thread starts
+template <class Hardware>
+bool BasicDeviceCore<Hardware>::loadHistory(const std::string &path) {
+    return history.load(path);
+}
+
+template <class Hardware>
+bool BasicDeviceCore<Hardware>::saveHistory(const std::string &path) const {
+    return history.save(path);
+}
+
+// add a therapy to the history, replay is true when it was started from the treatment history
+template <class Hardware>
+void BasicDeviceCore<Hardware>::logHistory(const Therapy *therapy, bool replay) {
+    history.append(therapy->username, therapy->group.name, therapy->type.name,
+                   therapy->intensity, replay, host->wallClockMs());
+}
+
+/*
+    Function: setImpedanceModel
+    Purpose: Drive the connection status from a simulated pair of electrodes instead of the slider
+    Inputs:
+        params: ElectrodeParams, contact process and noise for both electrodes
+        seed: unsigned integer, random seed for the model
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::setImpedanceModel(const ElectrodeParams &params, uint32_t seed) {
+    setImpedanceModel(params, params, seed);
+}
+
+// the same with each electrode's own contact process and noise
+template <class Hardware>
+void BasicDeviceCore<Hardware>::setImpedanceModel(const ElectrodeParams &left, const ElectrodeParams &right, uint32_t seed) {
+    delete impedanceModel;
+    impedanceModel = new ImpedanceField(1, left, right, seed);
+    if (this->state != State::Off) {
+        host->startTimer(ImpedanceTimer, IMPEDANCE_TICK_MS);
+    }
+}
+
+// change one electrode of the running model, say a worn pad, keeping its current contact
+template <class Hardware>
+bool BasicDeviceCore<Hardware>::setElectrodeParams(Electrode side, const ElectrodeParams &params) {
+    if (!impedanceModel) return false;
+    impedanceModel->setElectrodeParams(side, params);
+    return true;
+}
+
+// loop impedance in ohms, or -1 when the slider is in control
+template <class Hardware>
+double BasicDeviceCore<Hardware>::getLoopImpedance() const {
+    return impedanceModel ? impedanceModel->getLoopImpedance(0) : -1;
+}
+
+template <class Hardware>
+int BasicDeviceCore<Hardware>::getSelectedUserSession() const {
+    return selectedUserSession;
+}
+
+template <class Hardware>
+bool BasicDeviceCore<Hardware>::getRunBatteryAnimation() const {
+    return runBatteryAnimation;
+}
+
+template <class Hardware>
+int BasicDeviceCore<Hardware>::getSelectedSessionGroup() const {
+    return selectedSessionGroup;
+}
+
+template <class Hardware>
+int BasicDeviceCore<Hardware>::getSelectedSessionType() const {
+    return selectedSessionType;
+}
+
+template <class Hardware>
+bool BasicDeviceCore<Hardware>::getToggleRecord() const {
+    return toggleRecord;
+}
+
+template <class Hardware>
+const std::string &BasicDeviceCore<Hardware>::getInputtedName() const {
+    return inputtedName;
+}
+
+template <class Hardware>
+const std::vector<SessionType*> &BasicDeviceCore<Hardware>::getUserSessionTypes() const {
+    return userDesignedSessions.at(selectedUserSession)->types;
+}
+
+// the catalog never changes after configureDevice, so this is safe from any thread
+template <class Hardware>
+const std::vector<SessionType*> &BasicDeviceCore<Hardware>::getUserSessionTypes(int userSession) const {
+    return userDesignedSessions.at(userSession)->types;
+}
+
+// session type that drives the output, a user designed session uses its current segment or its first type
+template <class Hardware>
+SessionType *BasicDeviceCore<Hardware>::getActiveSessionType() const {
+    bool running = state == State::InSession || state == State::Paused;
+    if (running && activeSegment >= 0 && activeSegment < (int)sessionProgram.size()) {
+        return sessionTypes.at(sessionProgram.segment(activeSegment).typeIndex);
+    }
+    if (selectedSessionGroup == Catalog::USER_GROUP) {
+        return userDesignedSessions.at(selectedUserSession)->types.at(0);
+    }
+    return sessionTypes.at(selectedSessionType);
+}
+
+// position of a catalog type, -1 if it is not one of ours
+template <class Hardware>
+int BasicDeviceCore<Hardware>::typeIndex(const SessionType *type) const {
+    auto found = std::find(sessionTypes.begin(), sessionTypes.end(), type);
+    return found == sessionTypes.end() ? -1 : (int)(found - sessionTypes.begin());
+}
+
+/*
+    Function: compileSession
+    Purpose: Lay the selected session out as a timeline. A preset session is one segment of
+             its type, a user designed session has one segment per step of its program.
+    Inputs:
+        msPerMinute: integer, length of a session minute on the timeline
+    Return: SessionTimeline of the selected session
+*/
+template <class Hardware>
+SessionTimeline BasicDeviceCore<Hardware>::compileSession(int msPerMinute) const {
+    std::vector<ProgramStep> steps;
+    if (selectedSessionGroup == Catalog::USER_GROUP) {
+        for (const SessionSegment &segment : userDesignedSessions.at(selectedUserSession)->segments) {
+            ProgramStep step = {typeIndex(segment.type), segment.type->frequency,
+                                (long long)segment.durationMins * msPerMinute, segment.intensityFrom, segment.intensityTo};
+            steps.push_back(step);
+        }
+    } else {
+        SessionType *type = sessionTypes.at(selectedSessionType);
+        ProgramStep step = {selectedSessionType, type->frequency,
+                            (long long)sessionGroups.at(selectedSessionGroup)->durationMins * msPerMinute, FOLLOW_INTENSITY, FOLLOW_INTENSITY};
+        steps.push_back(step);
+    }
+    return SessionTimeline(steps);
+}
+
+/*
+    Function: renderSessionWaveform
+    Purpose: Write the output current of the selected session at the current intensity to a WAV file.
+             Uses real minutes for the duration, unlike the sped up session timer.
+    Inputs:
+        path: string, output file
+        sampleRate: integer, samples per second per channel
+    Return: bool, false if the file could not be written
+*/
+template <class Hardware>
+bool BasicDeviceCore<Hardware>::renderSessionWaveform(const std::string &path, int sampleRate) const {
+    WaveformSynth synth(sampleRate);
+    return synth.renderToFile(path, compileSession(REAL_MS_PER_MINUTE), lifecycle.level());
+}
+
+// fold the report of one segment into the report of the whole session
+static void mergeReport(SpectralReport &total, const SpectralReport &part, bool first, long long &longestMs, long long partMs) {
+    if (first || partMs > longestMs) {
+        total.dominantHz = part.dominantHz;
+        longestMs = partMs;
+    }
+    total.bandMatched = (first || total.bandMatched) && part.bandMatched;
+    total.blocks += part.blocks;
+    total.matchedBlocks += part.matchedBlocks;
+    total.totalChargeUc += part.totalChargeUc;
+    total.totalEnergyUj += part.totalEnergyUj;
+    total.minutes.insert(total.minutes.end(), part.minutes.begin(), part.minutes.end());
+}
+
+/*
+    Function: analyzeSessionWaveform
+    Purpose: Synthesize the selected session at the current intensity and stream it through
+             the spectral analyzer to check the delivered band and dose without writing a file.
+             Each segment is checked against the band of its own type, dominantHz is the
+             longest segment's and bandMatched needs every segment to match.
+    Inputs:
+        sampleRate: integer, samples per second per channel
+    Return: SpectralReport for the whole session
+*/
+template <class Hardware>
+SpectralReport BasicDeviceCore<Hardware>::analyzeSessionWaveform(int sampleRate) const {
+    SessionTimeline program = compileSession(REAL_MS_PER_MINUTE);
+    WaveformSynth synth(sampleRate);
+
+    SpectralReport report = SpectralReport();
+    long long longestMs = 0;
+    const long long chunkFrames = 65536;
+    std::vector<float> chunk(2 * chunkFrames);
+    for (size_t i = 0; i < program.size(); ++i) {
+        const TimelineSegment &segment = program.segment(i);
+        SessionType *type = sessionTypes.at(segment.typeIndex);
+        SpectralAnalyzer analyzer(sampleRate, type->bandLow, type->bandHigh);
+
+        long long first = segment.startMs * sampleRate / 1000;
+        long long last = segment.endMs * sampleRate / 1000;
+        for (long long done = first; done < last; done += chunkFrames) {
+            long long n = last - done < chunkFrames ? last - done : chunkFrames;
+            synth.synthesize(program, done, lifecycle.level(), chunk.data(), n);
+            analyzer.feed(chunk.data(), n);
+        }
+        mergeReport(report, analyzer.finish(), i == 0, longestMs, segment.endMs - segment.startMs);
+    }
+    return report;
+}
+
+// names of the states for trace events
+static const char *stateName(State state) {
+    switch (state) {
+        case State::Off: return "state:Off";
+        case State::ChoosingSession: return "state:ChoosingSession";
+        case State::ChoosingRecordedTherapy: return "state:ChoosingRecordedTherapy";
+        case State::InSession: return "state:InSession";
+        case State::Paused: return "state:Paused";
+        case State::TestingConnection: return "state:TestingConnection";
+        case State::SoftOff: return "state:SoftOff";
+    }
+    return "state:?";
+}
+
+// every state transition goes through here so it can be traced
+template <class Hardware>
+void BasicDeviceCore<Hardware>::setState(State newState) {
+    if (this->state != newState) {
+        TRACE_INSTANT(stateName(newState));
+    }
+    this->state = newState;
+}
+
+//Power on the device
+template <class Hardware>
+void BasicDeviceCore<Hardware>::powerOn() {
+    host->log("Powering on");
+    setState(State::ChoosingSession);
+    host->startTimer(BatteryTimer, BATTERY_TICK_MS);
+    if (impedanceModel) host->startTimer(ImpedanceTimer, IMPEDANCE_TICK_MS);
+    this->activeWavelength = sessionTypes[selectedSessionType]->wavelength;
+    changed();
+}
+
+//Power off the device
+//Reset state and timer variables
+template <class Hardware>
+void BasicDeviceCore<Hardware>::powerOff() {
+    host->log("Powering off");
+    // settle the battery and close the session up to this moment
+    this->batteryLevel -= energyLedger.take(clockMs());
+    if (this->batteryLevel < 0) this->batteryLevel = 0;
+    energyLedger.setSessionUser(inputtedName);
+    energyLedger.endSession(clockMs());
+    setState(State::Off);
+
+    stopAllTimers();
+
+    //Reset state variables
+    lifecycle.end();
+    this->lowBatteryTriggered = false;
+    this->criticalBatteryTriggered = false;
+    this->selectedSessionGroup = 0;
+    this->selectedSessionType = 0;
+    this->selectedUserSession = 0;
+    this->selectedRecordedTherapy = 0;
+    this->inputtedName = "";
+    this->activeWavelength = "none";
+    this->remainingSessionTime = -1;
+    this->toggleRecord = false;
+    changed();
+}
+
+//Stops all device timers
+template <class Hardware>
+void BasicDeviceCore<Hardware>::stopAllTimers() {
+    host->stopTimer(BatteryTimer);
+    host->stopTimer(SessionTimer);
+    host->stopTimer(SegmentTimer);
+    host->stopTimer(PowerButtonTimer);
+    host->stopTimer(TestConnectionTimer);
+    host->stopTimer(SafeVoltageTimer);
+    host->stopTimer(ImpedanceTimer);
+    host->stopTimer(RampTimer);
+}
+
+//Slowly power off the device
+template <class Hardware>
+void BasicDeviceCore<Hardware>::softOff() {
+    host->log("Soft Off initiated");
+    host->stopTimer(SessionTimer);
+    host->stopTimer(SegmentTimer);
+    setState(State::SoftOff);
+    UpdateEnergyRate();
+    lifecycle.softOff(host->elapsedUs());
+    scheduleRamp();
+}
+
+/*
+    Function: setRamp
+    Purpose: Choose how the intensity ramps at a session start, soft off or return to safe
+             voltage, used from the next time that ramp starts
+    Inputs:
+        use: RampUse to configure
+        shape: RampShape, linear, exponential or stepwise
+        ms: integer, length of the ramp, per level for the soft off
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::setRamp(RampUse use, RampShape shape, int ms) {
+    ramps.configure(use, shape, ms);
+}
+
+template <class Hardware>
+const Ramp &BasicDeviceCore<Hardware>::getRamp() const {
+    return lifecycle.ramp();
+}
+
+// the bounds, delays and ramps the device's lifecycle runs with, a session flow models it with them
+template <class Hardware>
+const LifecycleConfig &BasicDeviceCore<Hardware>::lifecycleConfig() const {
+    return ramps.config();
+}
+
+// arm the ramp timer for the ramp's next whole level change or its end, rounded up to the ms
+template <class Hardware>
+void BasicDeviceCore<Hardware>::scheduleRamp() {
+    int64_t wait = lifecycle.rampWaitMs(host->elapsedUs());
+    if (wait >= 0) {
+        host->startTimer(RampTimer, (int)wait);
+    } else {
+        host->stopTimer(RampTimer);
+    }
+}
+
+// the lifecycle's last transition may have ended its ramp, the timer goes with it
+template <class Hardware>
+void BasicDeviceCore<Hardware>::syncRampTimer() {
+    if (lifecycle.rampUse() == NoRamp) host->stopTimer(RampTimer);
+}
+
+/*
+    Function: RampStep [Timer]
+    Purpose: The running ramp reached its next whole level or its end. A soft off ends with the
+             device off and a return to safe voltage with the output off.
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::RampStep() {
+    TRACE_SCOPE("DeviceCore::RampStep");
+    RampUse finished = lifecycle.stepRamp(host->elapsedUs());
+    if (finished == SoftOffRamp) {
+        powerOff();
+        return;
+    }
+    if (finished == SafeVoltageRamp) host->safeVoltageReturn(false);
+    scheduleRamp();
+    changed();
+}
+
+// INPUTS
+// person presses mouse
+template <class Hardware>
+void BasicDeviceCore<Hardware>::PowerButtonPressed() {
+    TRACE_SCOPE("DeviceCore::PowerButtonPressed");
+    // timer starts
+    host->startTimer(PowerButtonTimer, POWER_HOLD_MS);
+    host->log("power pressed");
+}
+
+// if they let it go before 1s, timer stops (i.e. clicked not held)
+template <class Hardware>
+void BasicDeviceCore<Hardware>::PowerButtonReleased() {
+    TRACE_SCOPE("DeviceCore::PowerButtonReleased");
+    host->log("power released");
+    if (host->remainingTime(PowerButtonTimer) <= 0) {
+        return;
+    }
+    host->stopTimer(PowerButtonTimer);
+
+    if (this->state == State::InSession) {
+        softOff();
+    } else if (this->state == State::ChoosingSession) {
+        this->selectedSessionGroup = (this->selectedSessionGroup + 1) % sessionGroups.size();
+
+        //Determine wavelength
+        if (selectedSessionGroup == Catalog::USER_GROUP) {
+            userSessionWaveLength();
+        } else {
+            this->activeWavelength = sessionTypes[this->selectedSessionType]->wavelength;
+        }
+
+        host->log("UPDATED SESSION Group: " + sessionGroups[this->selectedSessionGroup]->name);
+    }
+    changed();
+}
+
+// else they didnt let it go within 1s, this happens
+template <class Hardware>
+void BasicDeviceCore<Hardware>::PowerButtonHeld() {
+    TRACE_SCOPE("DeviceCore::PowerButtonHeld");
+    if (this->state == State::Off && this->batteryLevel > 0) {
+        this->powerOn();
+    } else {
+        this->powerOff();
+    }
+    host->log("power held");
+}
+
+/*
+    Function: post
+    Purpose: Queue an input for the device, safe from any thread. The first input of a batch
+             wakes the host to drain them once, later ones ride along with it.
+    Inputs:
+        input: DeviceInput
+        value: integer argument of SetBattery and SetConnection
+        text: string argument of Username
+    Return: false if the queue is full and the input was dropped
+*/
+template <class Hardware>
+bool BasicDeviceCore<Hardware>::post(DeviceInput input, int value, const std::string &text) {
+    DeviceInputEvent event = {input, value, text};
+    if (!inputs.push(std::move(event))) {
+        host->log("Input queue full, input dropped");
+        return false;
+    }
+    if (!drainPending.exchange(true, std::memory_order_acq_rel)) {
+        host->wake();
+    }
+    return true;
+}
+
+/*
+    Function: drainInputs
+    Purpose: Apply every queued input in the order it was posted, on the core's thread
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::drainInputs() {
+    TRACE_SCOPE("DeviceCore::drainInputs");
+    // cleared first, an input posted while draining either gets drained here or schedules the next batch
+    drainPending.store(false, std::memory_order_release);
+    DeviceInputEvent event;
+    while (inputs.pop(event)) {
+        applyInput(event);
+    }
+}
+
+// one queued input, applied the way its direct call would be
+template <class Hardware>
+void BasicDeviceCore<Hardware>::applyInput(const DeviceInputEvent &event) {
+    switch (event.input) {
+        case DeviceInput::PowerPress: PowerButtonPressed(); break;
+        case DeviceInput::PowerRelease: PowerButtonReleased(); break;
+        case DeviceInput::IntensityUp: IntensityArrowClicked(1); break;
+        case DeviceInput::IntensityDown: IntensityArrowClicked(-1); break;
+        case DeviceInput::StartSession: StartSessionButtonClicked(); break;
+        case DeviceInput::SetBattery: SetBattery(event.value); break;
+        case DeviceInput::ResetBattery: ResetBattery(); break;
+        case DeviceInput::SetConnection: SetConnectionStatus(event.value); break;
+        case DeviceInput::Username: UsernameInputted(event.text); break;
+        case DeviceInput::Record: RecordButtonClicked(); break;
+        case DeviceInput::Replay: ReplayButtonClicked(); break;
+    }
+}
+
+/*
+ * Function: IntensityArrowClicked [INPUT]
+ * Purpose: Depending on the state of the device, Intensity gets updated or selected recorded therapy gets updated
+ *          or selected session type gets updated, depended on the state.
+ * Input: int direction, 1 for the up arrow and -1 for the down arrow
+ * Return: N/A
+ */
+template <class Hardware>
+void BasicDeviceCore<Hardware>::IntensityArrowClicked(int direction) {
+    TRACE_SCOPE("DeviceCore::IntensityArrowClicked");
+    if (this->state == State::InSession) {
+        adjustIntensity(direction);
+    } else if (this->state == State::ChoosingRecordedTherapy) {
+        // the QListWidget indexes 0 at the top, so clicking down needs to increase index
+        adjustSelectedRecordedTherapy(-direction);
+        this->activeWavelength = recordedTherapies[this->selectedRecordedTherapy]->type.wavelength;
+    } else if (this->state == State::ChoosingSession) {
+        if (direction > 0) { //Up Button
+            if (selectedSessionGroup != Catalog::USER_GROUP) {
+                //Change selected session Type
+                this->selectedSessionType = (this->selectedSessionType + 1) % sessionTypes.size();
+                host->log("UPDATED SESSION TYPE: " + sessionTypes[this->selectedSessionType]->name);
+            } else { // User designed Session Group is selected
+                // Change selected user session
+                this->selectedUserSession = (this->selectedUserSession + 1) % userDesignedSessions.size();
+                host->log("User session: " + std::to_string(selectedUserSession));
+            }
+        } else if (direction < 0) { //Down Button
+            if (selectedSessionGroup != Catalog::USER_GROUP) {
+                //Change selected session Type
+                this->selectedSessionType = (this->selectedSessionType == 0) ? sessionTypes.size() - 1 : this->selectedSessionType - 1;
+                host->log("UPDATED SESSION TYPE: " + sessionTypes[this->selectedSessionType]->name);
+            } else { // User designed Session Group
+                // Change selected user session
+                this->selectedUserSession = (this->selectedUserSession == 0) ? userDesignedSessions.size() - 1 : this->selectedUserSession - 1;
+                host->log("User session: " + std::to_string(selectedUserSession));
+            }
+        }
+
+        //Determine Wavelength
+        if (selectedSessionGroup == Catalog::USER_GROUP) {
+            userSessionWaveLength();
+        } else {
+            this->activeWavelength = sessionTypes[this->selectedSessionType]->wavelength;
+        }
+    }
+    changed();
+}
+
+//Modify the device intensity by the parameter's value, a level picked during the start ramp sticks
+template <class Hardware>
+void BasicDeviceCore<Hardware>::adjustIntensity(int change) {
+    bool moved = lifecycle.arrow(change);
+    syncRampTimer();
+    if (moved) {
+        changed();
+        host->log("intensity: " + std::to_string(lifecycle.level()));
+    }
+}
+
+/*
+    Function: adjustSelectedRecordedTherapy
+    Purpose: Adjust the currently selected recorded therapy from the treatment history list
+    Inputs:
+        change: integer (usually 1 or -1) moving the selected therapy up or down the list
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::adjustSelectedRecordedTherapy(int change) {
+    int newSelection = this->selectedRecordedTherapy + change;
+
+    if (newSelection > -1 && newSelection < (int)this->recordedTherapies.size()) {
+        this->selectedRecordedTherapy = newSelection;
+        changed();
+    }
+}
+
+//Event handler for when the start sesssion button is clicked
+template <class Hardware>
+void BasicDeviceCore<Hardware>::StartSessionButtonClicked() {
+    TRACE_SCOPE("DeviceCore::StartSessionButtonClicked");
+    // if we are starting a session from a saved therapy
+    if (this->state == State::ChoosingRecordedTherapy) {
+        auto chosenTherapy = this->recordedTherapies[this->selectedRecordedTherapy];
+        for (int i = 0; i < (int)sessionGroups.size(); ++i) {
+            if (chosenTherapy->group.name == sessionGroups[i]->name) {
+                this->selectedSessionGroup = i;
+                host->log("Setting session group to " + sessionGroups[i]->name);
+                break;
+            }
+        }
+        for (int i = 0; i < (int)sessionTypes.size(); ++i) {
+            if (chosenTherapy->type.name == sessionTypes[i]->name) {
+                this->selectedSessionType = i;
+                host->log("Setting session type to " + sessionTypes[i]->name);
+                break;
+            }
+        }
+        lifecycle.setLevel(chosenTherapy->intensity);
+        this->logHistory(chosenTherapy, true);
+    }
+    enterTestMode();
+}
+
+/*
+    Function: ResetBattery [Input]
+    Purpose: Set the battery to 100% quickly
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::ResetBattery() {
+    TRACE_SCOPE("DeviceCore::ResetBattery");
+    this->SetBattery(100);
+}
+
+/*
+    Function: SetBattery [Input]
+    Purpose: Set the battery to a specified percentage and resume the session if one is ongoing
+    Inputs:
+        batteryLevel: integer the new battery percentage
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::SetBattery(int batteryLevel) {
+    TRACE_SCOPE("DeviceCore::SetBattery");
+    if (batteryLevel < 0 || batteryLevel > 100)
+        return;
+    host->log("Battery set to " + std::to_string(batteryLevel));
+
+    this->energyLedger.take(clockMs());  // drain before now no longer applies
+    this->batteryLevel = 1.0 * batteryLevel;
+    // when battery is set, we'll replay low battery animations as needed
+    this->lowBatteryTriggered = false;
+    this->criticalBatteryTriggered = false;
+
+    this->DepleteBattery();
+    if (this->state == State::Paused && !this->disconnected) {
+        this->resumeSession();
+    }
+    changed();
+}
+
+//handler to update state of device when connection strength slider value changes
+template <class Hardware>
+void BasicDeviceCore<Hardware>::SetConnectionStatus(int status) {
+    TRACE_SCOPE("DeviceCore::SetConnectionStatus");
+    auto prevStatus = this->connectionStatus;
+    this->connectionStatus = status == 0 ? ConnectionStatus::No : status == 1 ? ConnectionStatus::Okay
+                                                                              : ConnectionStatus::Excellent;
+    if (this->connectionStatus == ConnectionStatus::No)
+        disconnected = true;
+
+    if (state == State::TestingConnection && host->remainingTime(TestConnectionTimer) <= 0 && prevStatus == ConnectionStatus::No) {  // connect during test mode
+        this->confirmConnection();
+    } else if (state == State::InSession && connectionStatus == ConnectionStatus::No) {  // disconnect during session
+        this->pauseSession();
+        if (!host->timerActive(SafeVoltageTimer)) host->startTimer(SafeVoltageTimer, ramps.config().safeVoltageDelayMs);// after a few seconds, make graph scroll for 20 seconds
+    } else if (state == State::Paused && connectionStatus != ConnectionStatus::No && disconnected) {  // reconnect
+        disconnected = false;
+        this->resumeSession();
+    }
+    changed();
+}
+
+//handler to start returning device to safe voltage level when disconnected during a session
+template <class Hardware>
+void BasicDeviceCore<Hardware>::returnToSafeVoltage() {
+    TRACE_SCOPE("DeviceCore::returnToSafeVoltage");
+    // a delay left running by an earlier disconnect must not take over a soft off's ramp
+    if (this->disconnected && this->state == State::Paused && lifecycle.returnToSafeVoltage(host->elapsedUs())) {
+        this->safeVoltageReturns++;
+        host->safeVoltageReturn(true);
+        scheduleRamp();
+        changed();
+    }
+}
+
+/*
+    Function: SampleImpedance [Timer]
+    Purpose: Advance the electrode model and apply its connection grade as if the slider had moved
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::SampleImpedance() {
+    TRACE_SCOPE("DeviceCore::SampleImpedance");
+    impedanceModel->setInSession(0, this->state == State::InSession);
+    impedanceModel->step(IMPEDANCE_TICK_MS / 1000.0);
+
+    int grade = impedanceModel->getGrade(0);
+    int currentGrade = connectionStatus == ConnectionStatus::No ? 0 : connectionStatus == ConnectionStatus::Okay ? 1 : 2;
+    if (grade != currentGrade) {
+        SetConnectionStatus(grade);
+    } else {
+        UpdateEnergyRate();  // impedance moved within the same grade
+    }
+}
+
+/*
+    Function: setTelemetry
+    Purpose: Record this device into a series of a telemetry store, sampled once a second from
+             now on whatever the state, powered off included
+    Inputs:
+        store: TelemetryStore, outlives the device, nullptr stops recording
+        series: id from the store's addSeries
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::setTelemetry(TelemetryStore *store, uint32_t series) {
+    this->telemetry = store;
+    this->telemetrySeries = series;
+    if (store) {
+        SampleTelemetry();
+        host->startTimer(TelemetryTimer, TELEMETRY_TICK_MS);
+    } else {
+        host->stopTimer(TelemetryTimer);
+    }
+}
+
+template <class Hardware>
+TelemetryStore *BasicDeviceCore<Hardware>::getTelemetry() const {
+    return telemetry;
+}
+
+template <class Hardware>
+uint32_t BasicDeviceCore<Hardware>::getTelemetrySeries() const {
+    return telemetrySeries;
+}
+
+/*
+    Function: SampleTelemetry [Timer]
+    Purpose: Record the device as it is now. The battery includes what the ledger used since
+             the last battery tick, so it falls smoothly instead of every 2 s.
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::SampleTelemetry() {
+    TRACE_SCOPE("DeviceCore::SampleTelemetry");
+    TelemetrySample sample;
+    sample.timeMs = host->wallClockMs();
+    sample.battery = std::max(0.0, batteryLevel - energyLedger.pending(clockMs()));
+    sample.state = (uint8_t)state;
+    sample.intensity = (uint8_t)lifecycle.level();
+    sample.connection = (uint8_t)connectionStatus;
+    telemetry->record(telemetrySeries, sample);
+}
+
+/*
+    Function: drainRate
+    Purpose: Battery used per millisecond in the current state, the battery model's amounts per
+             tick spread over the tick
+    Return: double, battery percent per ms
+*/
+template <class Hardware>
+double BasicDeviceCore<Hardware>::drainRate() const {
+    if (this->state == State::Off) {
+        return 0;
+    } else if (this->state == State::InSession) {
+        return (Battery::SESSION_PER_TICK + Battery::PER_INTENSITY * lifecycle.level()
+                + Battery::PER_CONTACT * this->contactDrainFactor()) / Battery::TICK_MS;
+    } else if (this->state == State::Paused) {
+        return Battery::PAUSED_PER_TICK / Battery::TICK_MS;
+    }
+    return Battery::IDLE_PER_TICK / Battery::TICK_MS;
+}
+
+/*
+    Function: UpdateEnergyRate
+    Purpose: Close the ledger's running interval at the old rate and continue at the rate of
+             the current state. Runs on every change and the few that the host is not told about.
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::UpdateEnergyRate() {
+    TRACE_SCOPE("DeviceCore::UpdateEnergyRate");
+    energyLedger.setRate(clockMs(), drainRate());
+    TRACE_COUNTER("battery", batteryLevel);
+    TRACE_COUNTER("intensity", lifecycle.level());
+}
+
+// battery drain from pushing current through the electrodes, as the connection model grades it
+template <class Hardware>
+double BasicDeviceCore<Hardware>::contactDrainFactor() const {
+    if (!impedanceModel) {
+        return Connection::statusFactor(this->connectionStatus);
+    }
+    return Connection::impedanceFactor(impedanceModel->getLoopImpedance(0));
+}
+
+//Session timer timeout
+//Initiate soft off
+template <class Hardware>
+void BasicDeviceCore<Hardware>::SessionComplete() {
+    TRACE_SCOPE("DeviceCore::SessionComplete");
+    softOff();
+}
+
+/*
+    Function: pauseSession
+    Purpose: Pauses a session by putting by recording
+             how much time is left and putting the device in the Paused state
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::pauseSession() {
+    if(this->state == State::Paused){
+        return;
+    }
+    // only works for singlshot (?)
+    host->log("pausing session.");
+    this->remainingSessionTime = host->remainingTime(SessionTimer);
+    host->log("This much time left: " + std::to_string(this->remainingSessionTime));
+    host->stopTimer(SessionTimer);
+    host->stopTimer(SegmentTimer);
+    lifecycle.pause();
+    syncRampTimer();
+    host->log("Timer stopped");
+    setState(State::Paused);
+    changed();
+}
+
+/*
+    Function: resumeSession
+    Purpose: Resume a paused session if there is one to resume.
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::resumeSession() {
+    if (this->getBatteryState() == BatteryState::Critical) {
+        return;  // session can not be resumed with low battery
+    }
+    // if there is a session to resume
+    if (remainingSessionTime > -1) {
+        // reconnected, the output stays where the return to safe voltage had brought it
+        if (getReturningToSafeVoltage()) host->safeVoltageReturn(false);
+        lifecycle.resume();
+        syncRampTimer();
+        host->startTimer(SessionTimer, remainingSessionTime);
+        setState(State::InSession);
+        scheduleSegment();
+    }
+    // otherwise
+    else {
+        setState(State::ChoosingSession);
+    }
+    changed();
+}
+
+/*
+    Function: DepleteBattery [Timer]
+    Purpose: Depletes the battery by what the energy ledger integrated since the last call.
+             State, intensity, connection status all play a role in the ledger's rate.
+             Generally runs using the batteryLevelTimer to check the battery thresholds.
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::DepleteBattery() {
+    TRACE_SCOPE("DeviceCore::DepleteBattery");
+    int prevWholeLevel = (int)this->batteryLevel;  // this core's level before the drain
+
+    if(this->state == State::Off){
+        return;
+    }
+    this->batteryLevel -= energyLedger.take(clockMs());
+
+    BatteryState currentBatteryState = this->getBatteryState();
+
+    // no battery, device powers off
+    if (this->batteryLevel <= 0) {
+        this->batteryLevel = 0;
+        this->powerOff();
+    }
+    // battery is critical
+    else if (currentBatteryState == BatteryState::Critical && !criticalBatteryTriggered) {
+        this->criticalBatteryTriggered = true;
+        this->runBatteryAnimation = true;
+        this->batteryAnimations++;
+        this->pauseSession();
+        this->runBatteryAnimation = false;
+    }
+    // battery is low
+    else if (currentBatteryState == BatteryState::Low && !lowBatteryTriggered) {
+        this->lowBatteryTriggered = true;
+        this->runBatteryAnimation = true;
+        this->batteryAnimations++;
+        changed();
+        this->runBatteryAnimation = false;
+    }
+
+    // otherwise only update the display when at least 1% is lost
+    else if (prevWholeLevel - (int)this->batteryLevel >= 1) {
+        changed();
+    }
+}
+
+// start a session
+template <class Hardware>
+void BasicDeviceCore<Hardware>::startSession() {
+    // session can not be started with low battery or invalid values
+    if (this->getBatteryState() == BatteryState::Critical || this->selectedSessionGroup < 0 || this->selectedSessionType < 0) {
+        return;
+    }
+
+    // the session timer runs the whole program, the segment timer its steps
+    this->sessionProgram = compileSession(SIM_MS_PER_MINUTE);
+    host->startTimer(SessionTimer, (int)this->sessionProgram.duration());
+
+    this->sessionsStarted++;
+    setState(State::InSession);
+    applySegment();
+    scheduleSegment();
+    lifecycle.start(host->elapsedUs());
+    scheduleRamp();
+    energyLedger.beginSession(clockMs(), sessionGroups[selectedSessionGroup]->name,
+                              selectedSessionGroup == Catalog::USER_GROUP ? userDesignedSessions[selectedUserSession]->name
+                                                        : sessionTypes[selectedSessionType]->name);
+    changed();
+}
+
+// performs connection test at the start of each session
+template <class Hardware>
+void BasicDeviceCore<Hardware>::enterTestMode() {
+    host->log("testing connection...");
+    setState(State::TestingConnection);
+    lifecycle.testConnection();
+    changed();
+    host->connectionTesting(true);
+    host->startTimer(TestConnectionTimer, ramps.config().testConnectionMs);  // let the display show connection status for 5 seconds and then start session if there is a connection
+}
+
+// start session if there is a connection
+template <class Hardware>
+void BasicDeviceCore<Hardware>::confirmConnection() {
+    TRACE_SCOPE("DeviceCore::confirmConnection");
+    if (this->state != State::TestingConnection) {
+        return;
+    }
+
+    // with an electrode model the test result comes from a fresh impedance sample
+    if (impedanceModel) {
+        impedanceModel->step(IMPEDANCE_TICK_MS / 1000.0);
+        int grade = impedanceModel->getGrade(0);
+        this->connectionStatus = grade == 0 ? ConnectionStatus::No : grade == 1 ? ConnectionStatus::Okay
+                                                                               : ConnectionStatus::Excellent;
+    }
+
+    if (connectionStatus != ConnectionStatus::No) {
+        disconnected = false;
+        host->connectionTesting(false);
+        host->log("connection confirmed, starting session...");
+        startSession();
+    } else {
+        host->log("No connection. Waiting for connection to start session...");
+    }
+}
+
+/*
+ * Function: UsernameInputted [INPUT]
+ * Purpose: Input for when the username textbox is edited with new text.
+ *          Enables/Disables the "Record Therapy" button on the gui based off text in the textbox.
+ * Input: string username represents the text the user is inputting in the username textbox.
+ * Return: N/A
+ */
+template <class Hardware>
+void BasicDeviceCore<Hardware>::UsernameInputted(const std::string &username) {
+    TRACE_SCOPE("DeviceCore::UsernameInputted");
+    this->inputtedName = username;
+    this->energyLedger.setSessionUser(username);
+
+    // Allow recording of therapy session when username textbox is not empty
+    if (username.length() == 0) {
+        // Textbox is empty so DISABLE the record therapy button
+        this->toggleRecord = false;
+    } else {
+        // Textbox is NOT empty so ENABLE the record therapy button
+        this->toggleRecord = true;
+    }
+    changed();
+}
+
+/*
+ * Function: RecordButtonClicked [INPUT]
+ * Purpose: Input for when the "Record Therapy" button is clicked on the UI.
+ *          The device will record the username inputted, the session group, the sesion type, and the current intensity.
+ * Input: N/A
+ * Return: N/A
+ */
+template <class Hardware>
+void BasicDeviceCore<Hardware>::RecordButtonClicked() {
+    TRACE_SCOPE("DeviceCore::RecordButtonClicked");
+    std::string username = this->getInputtedName();
+    host->log("Record Therapy button clicked... Recording current therapy with username: " + username);
+
+    // Device records session group, type, intensity with current username
+    this->recordTherapy(username);
+}
+
+/*
+ * Function: ReplayButtonClicked [INPUT]
+ * Purpose: Input for when the "Replay Therapy" button is clicked on the UI.
+ *          The device switches to the "ChoosingSavedTherapy" state.
+ * Input: N/A
+ * Return: N/A
+ */
+template <class Hardware>
+void BasicDeviceCore<Hardware>::ReplayButtonClicked() {
+    TRACE_SCOPE("DeviceCore::ReplayButtonClicked");
+    host->log("Replay Therapy button clicked... setting state");
+    setState(State::ChoosingRecordedTherapy);
+    changed();
+}
+
+/*
+ * Function: recordTherapy
+ * Purpose: Function for creating a recorded therapy and adding to
+ * Input: string username represents the username of the user whos therapy session we are currently recording
+ * Return: N/A
+ */
+template <class Hardware>
+void BasicDeviceCore<Hardware>::recordTherapy(const std::string &username) {
+    host->log("In recordTherapy()...");
+
+    auto sessionGroup = this->sessionGroups[this->getSelectedSessionGroup()];
+    auto sessionType = this->sessionTypes[this->getSelectedSessionType()];
+
+    bool flag = true;
+    for (size_t i = 0; i < recordedTherapies.size(); ++i) {
+        if (recordedTherapies[i]->username == username && recordedTherapies[i]->group.name == sessionGroup->name && recordedTherapies[i]->type.name == sessionType->name && recordedTherapies[i]->intensity == this->getIntensity()) {
+            host->log("THE SAME");
+            flag = false;
+            break;
+        }
+    }
+    Therapy recorded(*sessionGroup, *sessionType, this->getIntensity(), username);
+    this->logHistory(&recorded, false);
+    if (flag == true) {
+        auto new_therapy = therapyArena.make(*sessionGroup, *sessionType, this->getIntensity(), username);
+        host->log("New Therapy: " + new_therapy->summary());
+        recordedTherapies.push_back(new_therapy);
+
+        host->therapiesRecorded();
+    }
+    changed();
+}
+
+// time into the running session on the session timer's clock
+template <class Hardware>
+long long BasicDeviceCore<Hardware>::sessionElapsed() const {
+    return sessionProgram.duration() - getRemainingSessionTime();
+}
+
+/*
+    Function: applySegment
+    Purpose: Show the wavelength of the segment the session is in and move the intensity
+             along the segment's ramp, if it has one
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::applySegment() {
+    long long elapsed = sessionElapsed();
+    int index = sessionProgram.indexAt(elapsed);
+    if (index < 0) {
+        return;
+    }
+    this->activeSegment = index;
+    this->activeWavelength = sessionTypes.at(sessionProgram.segment(index).typeIndex)->wavelength;
+    lifecycle.applyProgram(sessionProgram, elapsed);
+    syncRampTimer();
+}
+
+// arm the segment timer for the next segment or ramp step of the running session
+template <class Hardware>
+void BasicDeviceCore<Hardware>::scheduleSegment() {
+    long long elapsed = sessionElapsed();
+    long long next = sessionProgram.nextChangeMs(elapsed);
+    if (next < sessionProgram.duration()) {
+        host->startTimer(SegmentTimer, (int)(next - elapsed));
+    } else {
+        host->stopTimer(SegmentTimer);
+    }
+}
+
+/*
+    Function: SegmentChanged [Timer]
+    Purpose: The session moved into its next segment or ramp step
+    Return: void
+*/
+template <class Hardware>
+void BasicDeviceCore<Hardware>::SegmentChanged() {
+    TRACE_SCOPE("DeviceCore::SegmentChanged");
+    applySegment();
+    scheduleSegment();
+    changed();
+}
+
+//Determine the wave length for a user session
+template <class Hardware>
+void BasicDeviceCore<Hardware>::userSessionWaveLength() {
+    // determine active wavelength
+    bool isSmall = false;
+    bool isBig = false;
+
+    for (SessionType *type : userDesignedSessions.at(selectedUserSession)->types) {
+        if (type->wavelength == "small") {
+            isSmall = true;
+        } else if (type->wavelength == "big") {
+            isBig = true;
+        }
+    }
+
+    if (isSmall && isBig) {
+        this->activeWavelength = "both";
+    } else if (isSmall) {
+        this->activeWavelength = "small";
+    } else if (isBig) {
+        this->activeWavelength = "big";
+    }
+}
+
+// the revisions this tree builds, a new one needs its line here
+template class BasicDeviceCore<StandardHardware>;
+template class BasicDeviceCore<RevisionBHardware>;
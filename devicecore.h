@@ -0,0 +1,331 @@
+#ifndef DEVICECORE_H
+#define DEVICECORE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "defs.h"
+#include "devicepolicies.h"
+#include "waveform.h"
+#include "spectrum.h"
+#include "impedance.h"
+#include "energyledger.h"
+#include "tracer.h"
+#include "seqlock.h"
+#include "arena.h"
+#include "timeline.h"
+#include "analytics.h"
+#include "checkpoint.h"
+#include "inputqueue.h"
+#include "ramp.h"
+#include "sessionlifecycle.h"
+#include "sharedstate.h"
+#include "telemetry.h"
+
+enum State {Off, ChoosingSession, ChoosingRecordedTherapy, InSession, Paused, TestingConnection, SoftOff};
+enum BatteryState {High, Low, Critical};
+enum ConnectionStatus {No=3, Okay=2, Excellent=1}; // ints used in battery drain
+enum WaveIcon {WaveNone, WaveSmall, WaveBig, WaveBoth};
+
+// the timers a device runs on its host, the battery, impedance and telemetry ticks repeat
+enum CoreTimer {PowerButtonTimer, SessionTimer, SegmentTimer, TestConnectionTimer, SafeVoltageTimer, RampTimer,
+                BatteryTimer, ImpedanceTimer, TelemetryTimer, CORE_TIMERS};
+
+// a session minute lasts this long on the session timer, real minutes are used for output
+const int SIM_MS_PER_MINUTE = 1000;
+const int REAL_MS_PER_MINUTE = 60000;
+
+const int POWER_HOLD_MS = 1000;        // power button held this long powers on or off
+const int BATTERY_TICK_MS = 2000;
+const int IMPEDANCE_TICK_MS = 250;
+const int TELEMETRY_TICK_MS = 1000;
+
+bool coreTimerRepeats(CoreTimer);
+const char *coreTimerName(CoreTimer);  // for trace events
+
+// plain copy of everything the displays read from a device, taken in one go per frame
+struct DeviceSnapshot {
+    State state;
+    BatteryState batteryState;
+    ConnectionStatus connectionStatus;
+    WaveIcon wavelength;
+    double batteryLevel;
+    int intensity;
+    int maxIntensity;       // the hardware's top level, views scale the intensity by it
+    int remainingSessionTime;
+    int selectedSessionGroup;
+    int selectedSessionType;
+    int selectedUserSession;
+    int selectedRecordedTherapy;
+    int therapyCount;
+    int batteryAnimations;  // bumped each time a battery warning should be animated
+    bool disconnected;
+    bool returningToSafeVoltage;
+    bool toggleRecord;
+    unsigned int version;   // publication count, a new value means something changed
+};
+
+/*
+    Class: DeviceHost
+    Purpose: What a DeviceCore needs from whatever runs it: timers, a clock and somewhere to
+             send its notifications. The Qt app runs it on QTimers, a simulation on SimHost.
+             Every call comes from the thread the core runs on, except wake.
+ */
+class DeviceHost
+{
+public:
+    virtual ~DeviceHost() {}
+
+    // timer semantics follow QTimer: start restarts, remainingTime is -1 when stopped
+    virtual void startTimer(CoreTimer, int ms) = 0;
+    virtual void stopTimer(CoreTimer) = 0;
+    virtual bool timerActive(CoreTimer) const = 0;
+    virtual int remainingTime(CoreTimer) const = 0;
+
+    virtual long long elapsedUs() const = 0;  // monotonic, since the host started
+    virtual int64_t wallClockMs() const = 0;  // ms since the epoch
+
+    virtual void wake() = 0;  // inputs were posted, call drainInputs on the core's thread soon
+    virtual void updated() = 0;
+    virtual void therapiesRecorded() = 0;
+    virtual void connectionTesting(bool) = 0;
+    virtual void safeVoltageReturn(bool) = 0;
+    virtual void log(const std::string &) {}
+};
+
+/*
+    Class: BasicDeviceCore
+    Purpose: The device without any UI toolkit: its state machine, battery model, session
+             catalog and recorded therapies. Time only reaches it through its host's timers
+             and clock, and it tells its host about every change, so the same core runs in the
+             app, in headless tools and in simulation workers. Hardware is a DevicePolicies
+             bundle fixing the battery, connection, intensity range and catalog at compile time,
+             the member functions are defined in devicecore.cpp and built for each revision
+             there.
+ */
+template <class Hardware>
+class BasicDeviceCore
+{
+public:
+    using Battery = typename Hardware::Battery;
+    using Connection = typename Hardware::Connection;
+    using Intensity = typename Hardware::Intensity;
+    using Catalog = typename Hardware::Catalog;
+
+    explicit BasicDeviceCore(DeviceHost *);
+    ~BasicDeviceCore();
+    BasicDeviceCore(const BasicDeviceCore &) = delete;
+    BasicDeviceCore &operator=(const BasicDeviceCore &) = delete;
+
+    // one of the host's timers went off
+    void onTimer(CoreTimer);
+
+    // queue an input from any thread, it is applied with the rest of its batch in drainInputs
+    bool post(DeviceInput, int = 0, const std::string & = std::string());
+    void drainInputs();
+
+    // inputs, applied at once on the core's thread
+    void PowerButtonPressed();
+    void PowerButtonReleased();
+    void IntensityArrowClicked(int);
+    void StartSessionButtonClicked();
+    void SetBattery(int);
+    void ResetBattery();
+    void SetConnectionStatus(int);
+    void UsernameInputted(const std::string &);
+    void RecordButtonClicked();
+    void ReplayButtonClicked();
+
+    // getters
+    State getState() const;
+    double getBatteryLevel() const;
+    ConnectionStatus getConnectionStatus() const;
+    int getIntensity() const;
+    const std::string &getActiveWavelength() const;
+    bool getRunBatteryAnimation() const;
+    int getSelectedSessionGroup() const;
+    int getSelectedSessionType() const;
+    int getSelectedUserSession() const;
+    bool getToggleRecord() const;
+    const std::string &getInputtedName() const;
+    // pseudo-getters
+    int getRemainingSessionTime() const;
+    BatteryState getBatteryState() const;
+    DeviceSnapshot snapshot() const;
+    DeviceSnapshot readSnapshot() const; // safe from any thread
+
+    const std::vector<Therapy *> &getRecordedTherapies() const;
+    std::vector<std::string> getTherapySummaries() const;
+    const std::vector<SessionType*> &getUserSessionTypes() const;
+    const std::vector<SessionType*> &getUserSessionTypes(int) const;
+    SessionType *getActiveSessionType() const;
+    SessionTimeline compileSession(int = SIM_MS_PER_MINUTE) const;
+
+    bool renderSessionWaveform(const std::string &, int = DEFAULT_SAMPLE_RATE) const;
+    SpectralReport analyzeSessionWaveform(int = DEFAULT_SAMPLE_RATE) const;
+
+    int getSelectedRecordedTherapy() const;
+    bool getDisconnected() const;
+    bool getReturningToSafeVoltage() const;
+    LifecyclePhase getLifecyclePhase() const;
+
+    std::vector<SessionEnergy> getSessionEnergy() const;
+    double getTherapyEnergy(int) const;
+
+    // every recorded and replayed therapy, for the analytics reports
+    const TherapyHistory &getHistory() const;
+    bool loadHistory(const std::string &);
+    bool saveHistory(const std::string &) const;
+
+    // resume from a checkpoint file, then keep it up to date, both before the core starts running
+    bool restoreCheckpoint(const std::string &);
+    bool enableCheckpoints(const std::string &);
+
+    // shape and time of a ramp, soft off time is per level, a session start of 0 ms starts at full intensity
+    void setRamp(RampUse, RampShape, int);
+    const Ramp &getRamp() const;
+    const LifecycleConfig &lifecycleConfig() const;
+
+    // sample battery, intensity, state and connection into a series of a shared store once a second
+    void setTelemetry(TelemetryStore *, uint32_t);
+    TelemetryStore *getTelemetry() const;
+    uint32_t getTelemetrySeries() const;
+
+    void setImpedanceModel(const ElectrodeParams &, uint32_t = 1);
+    void setImpedanceModel(const ElectrodeParams &left, const ElectrodeParams &right, uint32_t = 1);
+    bool setElectrodeParams(Electrode, const ElectrodeParams &);  // false without an electrode model
+    double getLoopImpedance() const;
+
+    // also publish every change into a slot of a shared memory table for other processes
+    void setSharedState(SharedStateTable *, int32_t);
+
+private:
+    DeviceHost *host;
+
+    State state;
+    bool toggleRecord;
+
+    int remainingSessionTime; // time left after pause, ms
+
+    // the running session as a timeline, the segment timer fires at its next segment or ramp step
+    SessionTimeline sessionProgram;
+    int activeSegment;
+
+    // the session's phase, intensity and ramp, the ramp timer fires only when its whole level next changes
+    RampTable ramps;
+    SessionLifecycle lifecycle;
+    Ramp restoredRamp;  // what was left of a safe voltage ramp before a restart
+
+    double batteryLevel;
+    bool lowBatteryTriggered;
+    bool criticalBatteryTriggered;
+    bool runBatteryAnimation;
+    int batteryAnimations;
+    bool disconnected;
+
+    std::string activeWavelength;
+    ConnectionStatus connectionStatus;
+
+    // optional electrode model, when set it drives the connection status instead of the slider
+    ImpedanceField *impedanceModel;
+
+    // latest snapshot, written on the core's thread and read lock free by the UI
+    SeqLock<DeviceSnapshot> published;
+
+    // inputs from the window, the control socket and scripts, drained on the core's thread
+    MpscQueue<DeviceInputEvent> inputs;
+    std::atomic<bool> drainPending;
+    void applyInput(const DeviceInputEvent &);
+
+    // optional telemetry, owned by whoever set it
+    TelemetryStore *telemetry;
+    uint32_t telemetrySeries;
+
+    // optional shared memory slot, written on every publish, with the counters only it shows
+    SharedStateTable *shared;
+    int32_t sharedSlot;
+    uint32_t sessionsStarted;
+    uint32_t safeVoltageReturns;
+    void publishShared(const DeviceSnapshot &);
+
+    // optional checkpoint file, appended to on every publish
+    CheckpointLog *checkpoints;
+    int presetTherapies;
+
+    // exact battery accounting, the rate changes with every state/intensity/connection change
+    EnergyLedger energyLedger;
+
+    // this is peter guessing at how this will work
+    // highlighted / currently selected
+    int selectedSessionGroup; // (time) 0, 1, 2
+    int selectedSessionType; // (frequency) 0, 1, 2, 3
+    int selectedUserSession;
+
+    // the catalog and therapies live in these arenas and are released with the device
+    Arena<SessionGroup> groupArena;
+    Arena<SessionType> typeArena;
+    Arena<UserDesignedSession> userSessionArena;
+    Arena<Therapy> therapyArena;
+
+    // stored data of the groups and sessions we have, set up in ctor
+    std::vector<SessionGroup*> sessionGroups;
+    std::vector<SessionType*> sessionTypes;
+    std::vector<UserDesignedSession*> userDesignedSessions;
+
+    // Data Structure for recorded therapies saved by user
+    int selectedRecordedTherapy;
+    std::vector<Therapy*> recordedTherapies;
+    std::string inputtedName; // Holds the text value in the username textbox
+    TherapyHistory history;
+
+    long long clockMs() const;
+    void changed();
+    void setState(State);
+    void powerOn();
+    void powerOff();
+    void stopAllTimers();
+    void softOff();
+    void scheduleRamp();
+    void syncRampTimer();
+    void pauseSession();
+    void resumeSession();
+    void enterTestMode();
+    void configureDevice();
+    void startSession();
+    void recordTherapy(const std::string &);
+    void logHistory(const Therapy *, bool);
+    DeviceCheckpoint checkpoint() const;
+    void writeCheckpoint();
+    void adjustIntensity(int);
+    void adjustSelectedRecordedTherapy(int);
+    void userSessionWaveLength();
+    long long sessionElapsed() const;
+    void applySegment();
+    void scheduleSegment();
+    double contactDrainFactor() const;
+    double drainRate() const;
+    int typeIndex(const SessionType *) const;
+
+    // timer handlers
+    void SessionComplete();
+    void SegmentChanged();
+    void RampStep();
+    void PowerButtonHeld();
+    void DepleteBattery();
+    void confirmConnection();
+    void returnToSafeVoltage();
+    void SampleImpedance();
+    void SampleTelemetry();
+    void UpdateEnergyRate();
+    void PublishSnapshot();
+};
+
+extern template class BasicDeviceCore<StandardHardware>;
+extern template class BasicDeviceCore<RevisionBHardware>;
+
+// the device as it shipped
+using DeviceCore = BasicDeviceCore<StandardHardware>;
+
+#endif // DEVICECORE_H
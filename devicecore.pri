@@ -0,0 +1,63 @@
+# The device core and the engine modules it runs on, standard C++ only. The app includes this
+# for its sources, devicecore.pro builds the same files as a library without Qt.
+
+# session flows are C++20 coroutines, gcc 10 still needs them switched on
+CONFIG += c++2a
+*-g++*: QMAKE_CXXFLAGS += -fcoroutines
+
+# the signal and fleet models rely on loop vectorization, which gcc only does at -O3
+*-g++*|*-clang*: QMAKE_CXXFLAGS_RELEASE -= -O2
+*-g++*|*-clang*: QMAKE_CXXFLAGS_RELEASE += -O3
+
+# CONFIG += no_trace compiles the trace points out entirely
+no_trace: DEFINES += OASIS_NO_TRACE
+
+# CONFIG += alloc_stats counts heap allocations and struct copies per trace scope, see allocstats.h
+alloc_stats: DEFINES += OASIS_ALLOC_STATS
+
+INCLUDEPATH += $$PWD
+
+# shm_open lives in librt on older glibc
+linux: LIBS += -lrt
+
+SOURCES += \
+    $$PWD/allocstats.cpp \
+    $$PWD/analytics.cpp \
+    $$PWD/checkpoint.cpp \
+    $$PWD/devicecore.cpp \
+    $$PWD/energyledger.cpp \
+    $$PWD/impedance.cpp \
+    $$PWD/ramp.cpp \
+    $$PWD/sessionflow.cpp \
+    $$PWD/sessionlifecycle.cpp \
+    $$PWD/sharedstate.cpp \
+    $$PWD/simhost.cpp \
+    $$PWD/spectrum.cpp \
+    $$PWD/telemetry.cpp \
+    $$PWD/timeline.cpp \
+    $$PWD/tracer.cpp \
+    $$PWD/waveform.cpp
+
+HEADERS += \
+    $$PWD/allocstats.h \
+    $$PWD/analytics.h \
+    $$PWD/arena.h \
+    $$PWD/checkpoint.h \
+    $$PWD/defs.h \
+    $$PWD/devicecore.h \
+    $$PWD/devicepolicies.h \
+    $$PWD/energyledger.h \
+    $$PWD/impedance.h \
+    $$PWD/inputqueue.h \
+    $$PWD/lifecycle.h \
+    $$PWD/ramp.h \
+    $$PWD/seqlock.h \
+    $$PWD/sessionflow.h \
+    $$PWD/sessionlifecycle.h \
+    $$PWD/sharedstate.h \
+    $$PWD/simhost.h \
+    $$PWD/spectrum.h \
+    $$PWD/telemetry.h \
+    $$PWD/timeline.h \
+    $$PWD/tracer.h \
+    $$PWD/waveform.h
@@ -0,0 +1,8 @@
+# The device core as a static library with no Qt at all, for simulation workers and any other
+# host that brings its own timers, see DeviceHost in devicecore.h and SimHost for an example.
+TEMPLATE = lib
+CONFIG += staticlib
+CONFIG -= qt
+TARGET = devicecore
+
+include(devicecore.pri)
@@ -0,0 +1,134 @@
+#ifndef DEVICEPOLICIES_H
+#define DEVICEPOLICIES_H
+
+#include <cstddef>
+
+#include "impedance.h"
+#include "lifecycle.h"
+
+/*
+    Compile time models of one hardware revision, picked with the Hardware argument of
+    BasicDeviceCore. Everything here is constexpr or inline so the core folds it on the hot path
+    instead of branching on a runtime configuration. A policy only describes numbers, the
+    core decides what to do with them.
+ */
+
+// battery percent used per BatteryTick in each state, and where the warnings start
+struct StandardBattery {
+    static constexpr double LOW_PERCENT = 25;
+    static constexpr double CRITICAL_PERCENT = 12;
+    static constexpr double TICK_MS = 2000;
+    static constexpr double IDLE_PER_TICK = 0.1;
+    static constexpr double PAUSED_PER_TICK = 0.05;
+    static constexpr double SESSION_PER_TICK = 0.2;  // plus the two below
+    static constexpr double PER_INTENSITY = 0.1;
+    static constexpr double PER_CONTACT = 0.01;      // times the contact factor
+};
+
+// a board with twice the cells, warned a little later
+struct LongLifeBattery {
+    static constexpr double LOW_PERCENT = 20;
+    static constexpr double CRITICAL_PERCENT = 10;
+    static constexpr double TICK_MS = 2000;
+    static constexpr double IDLE_PER_TICK = 0.05;
+    static constexpr double PAUSED_PER_TICK = 0.025;
+    static constexpr double SESSION_PER_TICK = 0.1;
+    static constexpr double PER_INTENSITY = 0.05;
+    static constexpr double PER_CONTACT = 0.005;
+};
+
+// how contact quality costs battery, 1 (good contact) to 3 (none), and the connection timings
+struct StandardConnection {
+    static constexpr double MIN_FACTOR = 1;
+    static constexpr double MAX_FACTOR = 3;
+    static constexpr int TEST_MS = TEST_CONNECTION_MS;
+    static constexpr int SAFE_VOLTAGE_DELAY = SAFE_VOLTAGE_DELAY_MS;
+
+    // the slider's grade, as ConnectionStatus: Excellent = 1, Okay = 2, No = 3
+    static constexpr double statusFactor(int status) { return status; }
+
+    // a measured loop impedance, in units of the excellent grade's limit
+    static double impedanceFactor(double ohms) {
+        double factor = ohms / EXCELLENT_BELOW_OHMS;
+        return factor < MIN_FACTOR ? MIN_FACTOR : factor > MAX_FACTOR ? MAX_FACTOR : factor;
+    }
+};
+
+// levels the intensity arrows, session programs and ramps can reach
+struct StandardIntensity {
+    static constexpr int MIN = 1;
+    static constexpr int MAX = 8;
+};
+
+struct WideIntensity {
+    static constexpr int MIN = 1;
+    static constexpr int MAX = 10;
+};
+
+// plain descriptions of a catalog, turned into arena objects when the core is built
+struct CatalogGroup {
+    const char *name;
+    int durationMins;
+};
+
+struct CatalogType {
+    const char *name;
+    const char *wavelength;
+    double frequency;
+    double bandLow;
+    double bandHigh;
+};
+
+// a step of the preset user designed session numbered session
+struct CatalogSegment {
+    int session;
+    int type;
+    int durationMins;
+    int intensityFrom;
+    int intensityTo;
+};
+
+struct CatalogTherapy {
+    int group;
+    int type;
+    int intensity;
+    const char *username;
+};
+
+// the groups, types and presets the device shipped with
+struct StandardCatalog {
+    static constexpr int USER_GROUP = 2;  // the group whose sessions are user designed
+    static constexpr CatalogGroup groups[] = {{"20 Min", 20}, {"45 Min", 45}, {"User Designed", 0}};
+    static constexpr CatalogType types[] = {
+        {"MET", "small", 100, 50, 150},
+        {"Sub-Delta", "big", 0.5, 0.1, 1},
+        {"Delta", "small", 2.5, 1, 4},
+        {"Theta", "small", 6, 4, 8},
+    };
+    static constexpr const char *userSessions[] = {"Test1", "Test2", "Ramp"};
+    static constexpr CatalogSegment segments[] = {
+        {0, 0, 20, -1, -1},
+        {1, 1, 5, -1, -1},
+        {1, 2, 5, -1, -1},
+        {2, 1, 8, 2, 5},  // ramp up while in Sub-Delta, then hold in Delta
+        {2, 2, 4, -1, -1},
+    };
+    static constexpr CatalogTherapy therapies[] = {{0, 0, 2, "User1"}, {1, 1, 5, "User2"}, {0, 3, 8, "User3"}};
+};
+
+// one hardware revision, the policies the core is built with
+template <class BatteryModel, class ConnectionModel, class IntensityRange, class SessionCatalog>
+struct DevicePolicies {
+    using Battery = BatteryModel;
+    using Connection = ConnectionModel;
+    using Intensity = IntensityRange;
+    using Catalog = SessionCatalog;
+};
+
+// the device as it shipped, what the app, the dashboard and the tools run
+using StandardHardware = DevicePolicies<StandardBattery, StandardConnection, StandardIntensity, StandardCatalog>;
+
+// the longer life board with two more intensity levels, for fleet studies with device-sim
+using RevisionBHardware = DevicePolicies<LongLifeBattery, StandardConnection, WideIntensity, StandardCatalog>;
+
+#endif // DEVICEPOLICIES_H
@@ -0,0 +1,169 @@
+#include "displayframe.h"
+
+DisplayFrame::DisplayFrame() : batteryNumber(0),
+                               batterySlider(0),
+                               connectionSlider(2),
+                               therapyTime(0),
+                               smallWaveStyle("color: black;"),
+                               bigWaveStyle("color: black;"),
+                               leftStyle("color: black;"),
+                               rightStyle("color: black;"),
+                               checkEnabled(false),
+                               intUpEnabled(false),
+                               intDownEnabled(false),
+                               usernameEnabled(false),
+                               recordEnabled(false),
+                               replayEnabled(false),
+                               historyCount(0),
+                               historyRow(-1) {
+    setGraphLights(*this, 0, 0);
+}
+
+// light graph lights start to end in a colour, the rest black
+void setGraphLights(DisplayFrame &frame, int start, int end, QString colour) {
+    for (int i = 1; i <= GRAPH_LIGHTS; ++i) {
+        frame.graphStyles[i - 1] = "background-color: " + (i >= start && i <= end ? colour : QString("black")) + ";";
+    }
+}
+
+// light graph light showing an intensity, the hardware's levels spread over the lights
+int intensityLight(int intensity, int maxIntensity) {
+    if (maxIntensity <= 0 || maxIntensity == GRAPH_LIGHTS) return intensity;
+    return (intensity * GRAPH_LIGHTS + maxIntensity - 1) / maxIntensity;
+}
+
+// colour the CES wavelength icons for "small", "big", "both" or "none"
+void setWaveStyles(DisplayFrame &frame, QString wavelength, QString colour) {
+    bool small = wavelength == "small" || wavelength == "both";
+    bool big = wavelength == "big" || wavelength == "both";
+    frame.smallWaveStyle = "color: " + (small ? colour : QString("black")) + ";";
+    frame.bigWaveStyle = "color: " + (big ? colour : QString("black")) + ";";
+}
+
+// name used by setWaveStyles for a published wavelength icon
+QString waveName(WaveIcon icon) {
+    switch (icon) {
+        case WaveSmall: return "small";
+        case WaveBig: return "big";
+        case WaveBoth: return "both";
+        default: return "none";
+    }
+}
+
+/*
+    Function: composeFrame
+    Purpose: Work out what the window should show for a device snapshot. Pure, it reads only
+             its arguments, so the same snapshot always gives the same frame.
+    Inputs:
+        s: DeviceSnapshot to show
+        previous: DisplayFrame on screen, kept where a state leaves a widget alone
+        in: DisplayInputs, window state the frame depends on
+        effects: DisplayEffects pointer, filled with the animations to start or stop
+    Return: DisplayFrame to apply
+*/
+DisplayFrame composeFrame(const DeviceSnapshot &s, const DisplayFrame &previous, const DisplayInputs &in, DisplayEffects *effects) {
+    DisplayFrame f = previous;
+    effects->stopAll = false;
+    effects->graphBlink = 0;
+    effects->blinkLow = 0;
+    effects->blinkHigh = 0;
+    effects->countdown = 0;
+    effects->countdownMs = 0;
+    effects->clearUsername = false;
+
+    // starting a graph blink lights its range now, the animation toggles it from there
+    bool graphBusy = in.graphBlinking;
+    auto graph = [&f, effects, &graphBusy](int start, int end, QString colour, bool blink) {
+        setGraphLights(f, start, end, colour);
+        effects->graphBlink = blink ? 1 : -1;
+        effects->blinkLow = start;
+        effects->blinkHigh = end;
+        effects->blinkColour = colour;
+        graphBusy = blink;
+    };
+
+    f.batteryNumber = (int)s.batteryLevel;
+    f.batterySlider = (int)s.batteryLevel;
+    if (in.batteryWarning && s.batteryState == BatteryState::Low) {
+        graph(1, 2, "yellow", true);
+    } else if (in.batteryWarning && s.batteryState == BatteryState::Critical) {
+        graph(1, 1, "red", true);
+    }
+    f.replayEnabled = s.state == State::ChoosingSession && s.therapyCount > 0;
+
+    if (s.state == State::Off) {
+        effects->stopAll = true;
+        effects->graphBlink = 0;
+        effects->clearUsername = true;
+        f.powerStyle = "";
+        f.therapyTime = 0;
+        f.historyCount = 0;
+        setGraphLights(f, 0, 0);
+        setWaveStyles(f, "none");
+        f.checkEnabled = f.intUpEnabled = f.intDownEnabled = false;
+        f.usernameEnabled = f.recordEnabled = false;
+        for (QString &style : f.groupStyles) style = "";
+        for (QString &style : f.typeStyles) style = "";
+        f.leftStyle = f.rightStyle = "color: black;";
+        return f;
+    }
+
+    if (s.state == State::TestingConnection) {
+        if (s.connectionStatus == ConnectionStatus::No) {
+            graph(7, 8, "red", true);
+        } else if (s.connectionStatus == ConnectionStatus::Okay) {
+            graph(4, 6, "yellow", false);
+        } else {
+            graph(1, 3, "green", false);
+        }
+    } else if (s.state == State::InSession) {
+        f.therapyTime = s.remainingSessionTime > 0 ? s.remainingSessionTime / 1000 : 0;
+        effects->countdown = s.remainingSessionTime > 0 ? 1 : -1;
+        effects->countdownMs = s.remainingSessionTime;
+        // if the graph is animating then don't overwrite with intensity
+        int light = intensityLight(s.intensity, s.maxIntensity);
+        if (!graphBusy) graph(light, light, "green", false);
+    } else if (s.state == State::SoftOff) {
+        int light = intensityLight(s.intensity, s.maxIntensity);
+        graph(light, light, "green", false);
+    } else if (s.state == State::ChoosingSession) {
+        if (!graphBusy) {
+            int light = s.selectedSessionGroup == 2 ? s.selectedUserSession + 1 : 0;
+            graph(light, light, "green", false);
+        }
+    } else if (s.state == State::ChoosingRecordedTherapy) {
+        f.historyRow = s.selectedRecordedTherapy;
+    } else if (s.state == State::Paused) {
+        effects->countdown = -1;
+        f.therapyTime = s.remainingSessionTime > 0 ? s.remainingSessionTime / 1000 : 0;
+        if (s.disconnected && !s.returningToSafeVoltage) graph(7, 8, "red", true);
+    }
+
+    setWaveStyles(f, waveName(s.wavelength), "red");
+
+    // keep the slider in step when the electrode model changes the connection
+    f.connectionSlider = s.connectionStatus == ConnectionStatus::No ? 0 : s.connectionStatus == ConnectionStatus::Okay ? 1 : 2;
+
+    bool buttons = s.state != State::Paused;
+    f.checkEnabled = s.state == State::ChoosingSession || s.state == State::ChoosingRecordedTherapy;
+    f.intUpEnabled = buttons;
+    f.intDownEnabled = buttons;
+    f.usernameEnabled = s.state == State::InSession && s.selectedSessionGroup != 2;
+    // Record Button only available when there is valid text in the username input box and when device is in a session
+    f.recordEnabled = s.state == State::InSession && s.toggleRecord;
+
+    QString channels = s.connectionStatus != ConnectionStatus::No ? "color: green;" : "color: black;";
+    f.leftStyle = channels;
+    f.rightStyle = channels;
+    f.powerStyle = "border: 5px solid green;";
+    f.historyCount = in.historyCount;
+
+    for (int i = 0; i < GROUP_ICONS; ++i) {
+        f.groupStyles[i] = i == s.selectedSessionGroup ? "background-color: green;" : "";
+    }
+    for (int i = 0; i < TYPE_ICONS; ++i) {
+        bool lit = s.selectedSessionGroup == 2 ? (in.userTypeMask >> i) & 1 : i == s.selectedSessionType;
+        f.typeStyles[i] = lit ? "background-color: green;" : "";
+    }
+    return f;
+}
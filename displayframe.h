@@ -0,0 +1,68 @@
+#ifndef DISPLAYFRAME_H
+#define DISPLAYFRAME_H
+
+#include <QString>
+
+#include "device.h"
+
+const int GRAPH_LIGHTS = 8;
+const int GROUP_ICONS = 3;
+const int TYPE_ICONS = 4;
+
+/*
+    Struct: DisplayFrame
+    Purpose: Everything the window shows, as plain values. MainWindow compares a new frame
+             with the one on screen and only touches the widgets whose values changed.
+ */
+struct DisplayFrame {
+    QString powerStyle;
+    int batteryNumber;
+    int batterySlider;
+    int connectionSlider;
+    int therapyTime;                  // seconds on the session clock
+    QString graphStyles[GRAPH_LIGHTS];
+    QString smallWaveStyle;
+    QString bigWaveStyle;
+    QString leftStyle;
+    QString rightStyle;
+    QString groupStyles[GROUP_ICONS];
+    QString typeStyles[TYPE_ICONS];
+    bool checkEnabled;
+    bool intUpEnabled;
+    bool intDownEnabled;
+    bool usernameEnabled;
+    bool recordEnabled;
+    bool replayEnabled;
+    int historyCount;                 // treatment history rows shown
+    int historyRow;                   // selected treatment history row
+
+    DisplayFrame();
+};
+
+// window state a frame depends on besides the device snapshot
+struct DisplayInputs {
+    bool batteryWarning;   // a new low/critical warning is in this snapshot
+    bool graphBlinking;    // a graph blink owns the graph lights
+    int userTypeMask;      // type icons of the selected user designed session, bit per icon
+    int historyCount;      // recorded therapies known to the window
+};
+
+// what the animations should do alongside a frame, 1 start, -1 stop, 0 leave as is
+struct DisplayEffects {
+    bool stopAll;
+    int graphBlink;
+    int blinkLow;
+    int blinkHigh;
+    QString blinkColour;
+    int countdown;
+    int countdownMs;
+    bool clearUsername;
+};
+
+DisplayFrame composeFrame(const DeviceSnapshot &, const DisplayFrame &previous, const DisplayInputs &, DisplayEffects *);
+void setGraphLights(DisplayFrame &, int start, int end, QString colour = "black");
+int intensityLight(int intensity, int maxIntensity);
+void setWaveStyles(DisplayFrame &, QString wavelength, QString colour = "black");
+QString waveName(WaveIcon);
+
+#endif // DISPLAYFRAME_H
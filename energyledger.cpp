@@ -0,0 +1,107 @@
+#include "energyledger.h"
+
+EnergyLedger::EnergyLedger() : rate(0), lastMs(0), consumedTotal(0), untaken(0), sessionOpen(false) {
+    open.startMs = -1;
+    open.endMs = -1;
+    open.consumed = 0;
+}
+
+// close the running interval at the current rate
+void EnergyLedger::advance(long long nowMs) {
+    if (nowMs <= lastMs) return;
+    double used = rate * (nowMs - lastMs);
+    consumedTotal += used;
+    untaken += used;
+    if (sessionOpen) open.consumed += used;
+    lastMs = nowMs;
+}
+
+/*
+    Function: setRate
+    Purpose: Change the consumption rate from now on
+    Inputs:
+        nowMs: long long, time of the change
+        percentPerMs: double, battery percent used per millisecond
+    Return: void
+ */
+void EnergyLedger::setRate(long long nowMs, double percentPerMs) {
+    advance(nowMs);
+    this->rate = percentPerMs;
+}
+
+double EnergyLedger::take(long long nowMs) {
+    advance(nowMs);
+    double used = untaken;
+    untaken = 0;
+    return used;
+}
+
+void EnergyLedger::beginSession(long long nowMs, const std::string &group, const std::string &type) {
+    if (sessionOpen) endSession(nowMs);
+    advance(nowMs);
+    open.group = group;
+    open.type = type;
+    open.user.clear();
+    open.startMs = nowMs;
+    open.endMs = -1;
+    open.consumed = 0;
+    sessionOpen = true;
+}
+
+// the user is only known once a name is typed, any time during the session
+void EnergyLedger::setSessionUser(const std::string &user) {
+    if (sessionOpen) open.user = user;
+}
+
+void EnergyLedger::endSession(long long nowMs) {
+    if (!sessionOpen) return;
+    advance(nowMs);
+    open.endMs = nowMs;
+    closed.push_back(open);
+    sessionOpen = false;
+}
+
+bool EnergyLedger::inSession() const {
+    return sessionOpen;
+}
+
+// everything consumed so far, including the running interval
+double EnergyLedger::pending(long long nowMs) const {
+    return untaken + (nowMs > lastMs ? rate * (nowMs - lastMs) : 0);
+}
+
+double EnergyLedger::total(long long nowMs) const {
+    return consumedTotal + (nowMs > lastMs ? rate * (nowMs - lastMs) : 0);
+}
+
+// the open session brought up to now, endMs is -1 if there is none
+SessionEnergy EnergyLedger::current(long long nowMs) const {
+    SessionEnergy s = open;
+    if (!sessionOpen) {
+        s.endMs = -1;
+        s.consumed = 0;
+        return s;
+    }
+    s.consumed += nowMs > lastMs ? rate * (nowMs - lastMs) : 0;
+    return s;
+}
+
+const std::vector<SessionEnergy> &EnergyLedger::sessions() const {
+    return closed;
+}
+
+/*
+    Function: totalFor
+    Purpose: Battery used by every session of one therapy (group, type and user), open one included
+    Return: double, battery percent
+ */
+double EnergyLedger::totalFor(const std::string &group, const std::string &type, const std::string &user, long long nowMs) const {
+    double sum = 0;
+    for (const SessionEnergy &s : closed) {
+        if (s.group == group && s.type == type && s.user == user) sum += s.consumed;
+    }
+    if (sessionOpen && open.group == group && open.type == type && open.user == user) {
+        sum += current(nowMs).consumed;
+    }
+    return sum;
+}
@@ -0,0 +1,54 @@
+#ifndef ENERGYLEDGER_H
+#define ENERGYLEDGER_H
+
+#include <string>
+#include <vector>
+
+// battery used by one session, from startSession until the device powers off
+struct SessionEnergy {
+    std::string group;
+    std::string type;
+    std::string user;
+    long long startMs;
+    long long endMs;     // -1 while the session is still open
+    double consumed;     // battery percent
+};
+
+/*
+    Class: EnergyLedger
+    Purpose: Integrates battery consumption exactly as a piecewise constant rate. The owner
+             sets the new rate whenever the state, intensity or connection changes and the
+             ledger closes the previous interval at the old rate, so nothing is sampled.
+ */
+class EnergyLedger
+{
+public:
+    EnergyLedger();
+
+    void setRate(long long nowMs, double percentPerMs);
+    double take(long long nowMs);  // consumed since the previous take
+    double pending(long long nowMs) const;  // what take would return, without taking it
+
+    void beginSession(long long nowMs, const std::string &group, const std::string &type);
+    void setSessionUser(const std::string &user);
+    void endSession(long long nowMs);
+    bool inSession() const;
+
+    double total(long long nowMs) const;
+    SessionEnergy current(long long nowMs) const;
+    const std::vector<SessionEnergy> &sessions() const;
+    double totalFor(const std::string &group, const std::string &type, const std::string &user, long long nowMs) const;
+
+private:
+    double rate;            // percent per ms since lastMs
+    long long lastMs;
+    double consumedTotal;   // up to lastMs
+    double untaken;         // up to lastMs, not yet handed out by take
+    std::vector<SessionEnergy> closed;
+    SessionEnergy open;
+    bool sessionOpen;
+
+    void advance(long long nowMs);
+};
+
+#endif // ENERGYLEDGER_H
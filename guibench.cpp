@@ -0,0 +1,265 @@
+#include "guibench.h"
+
+#include <QApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QImage>
+#include <QPixmap>
+#include <QTextStream>
+
+// animation time per rendered frame, the rate the animation clock runs at on screen
+static const int FRAME_MS = 16;
+
+GuiBenchmark::GuiBenchmark(MainWindow *w, QObject *parent) : QObject(parent),
+                                                            window(w),
+                                                            framesPerScene(120),
+                                                            screenshotEvery(30),
+                                                            paint(true),
+                                                            polishes(0),
+                                                            styleChanges(0) {}
+
+void GuiBenchmark::setFramesPerScene(int frames) {
+    this->framesPerScene = frames > 0 ? frames : 1;
+}
+
+void GuiBenchmark::setScreenshotEvery(int frames) {
+    this->screenshotEvery = frames > 0 ? frames : 1;
+}
+
+void GuiBenchmark::setScreenshotDir(QString dir) {
+    this->screenshotDir = dir;
+}
+
+void GuiBenchmark::setCompareDir(QString dir) {
+    this->compareDir = dir;
+}
+
+// without painting only the widget updates are measured
+void GuiBenchmark::setPaint(bool on) {
+    this->paint = on;
+}
+
+bool GuiBenchmark::eventFilter(QObject *, QEvent *event) {
+    if (event->type() == QEvent::Polish || event->type() == QEvent::PolishRequest) {
+        this->polishes++;
+    } else if (event->type() == QEvent::StyleChange) {
+        this->styleChanges++;
+    }
+    return false;
+}
+
+/*
+    Function: script
+    Purpose: The scenes a run goes through, every State plus the animated warnings
+    Return: QVector<BenchScene> in run order
+*/
+QVector<BenchScene> GuiBenchmark::script() const {
+    DeviceSnapshot on = DeviceSnapshot();
+    on.state = State::ChoosingSession;
+    on.batteryState = BatteryState::High;
+    on.connectionStatus = ConnectionStatus::Excellent;
+    on.wavelength = WaveSmall;
+    on.batteryLevel = 80;
+    on.intensity = 1;
+    on.maxIntensity = DeviceCore::Intensity::MAX;
+    on.remainingSessionTime = -1;
+    on.therapyCount = 3;
+
+    QVector<BenchScene> scenes;
+    auto add = [&scenes](QString name, DeviceSnapshot s, bool blink = false, bool scroll = false) {
+        BenchScene scene;
+        scene.name = name;
+        scene.snapshot = s;
+        scene.wavelengthBlink = blink;
+        scene.scroll = scroll;
+        scenes.append(scene);
+    };
+
+    DeviceSnapshot s = on;
+    s.state = State::Off;
+    s.wavelength = WaveNone;
+    add("off", s);
+
+    for (int group = 0; group < 2; ++group) {
+        s = on;
+        s.selectedSessionGroup = group;
+        add(QString("choosing-group%1").arg(group), s);
+    }
+    for (int user = 0; user < 2; ++user) {
+        s = on;
+        s.selectedSessionGroup = 2;
+        s.selectedUserSession = user;
+        s.wavelength = user == 0 ? WaveSmall : WaveBoth;
+        add(QString("choosing-user%1").arg(user), s);
+    }
+
+    s = on;
+    s.state = State::ChoosingRecordedTherapy;
+    s.selectedRecordedTherapy = 1;
+    add("choosing-recorded", s);
+
+    const ConnectionStatus statuses[] = {ConnectionStatus::Excellent, ConnectionStatus::Okay, ConnectionStatus::No};
+    const char *statusNames[] = {"excellent", "okay", "no"};
+    for (int i = 0; i < 3; ++i) {
+        s = on;
+        s.state = State::TestingConnection;
+        s.connectionStatus = statuses[i];
+        add(QString("testing-%1").arg(statusNames[i]), s, true);
+    }
+
+    for (int level = 1; level <= 8; ++level) {
+        s = on;
+        s.state = State::InSession;
+        s.intensity = level;
+        s.remainingSessionTime = 20000;
+        s.toggleRecord = level % 2 == 0;
+        add(QString("session-intensity%1").arg(level), s);
+    }
+
+    s = on;
+    s.state = State::Paused;
+    s.remainingSessionTime = 12000;
+    s.connectionStatus = ConnectionStatus::No;
+    s.disconnected = true;
+    add("paused-disconnected", s);
+
+    s.returningToSafeVoltage = true;
+    add("safe-voltage", s, false, true);
+
+    s = on;
+    s.state = State::InSession;
+    s.remainingSessionTime = 15000;
+    s.batteryLevel = 25;
+    s.batteryState = BatteryState::Low;
+    s.batteryAnimations = 1;
+    add("battery-low", s);
+
+    s.state = State::Paused;
+    s.batteryLevel = 12;
+    s.batteryState = BatteryState::Critical;
+    s.batteryAnimations = 2;
+    add("battery-critical", s);
+
+    s = on;
+    s.state = State::SoftOff;
+    s.intensity = 3;
+    add("soft-off", s);
+    return scenes;
+}
+
+// number of pixels that differ between a screenshot and its reference, -1 if there is no reference
+static int pixelDiff(const QImage &shot, const QString &referencePath) {
+    QImage reference(referencePath);
+    if (reference.isNull()) return -1;
+    QImage a = shot.convertToFormat(QImage::Format_ARGB32);
+    QImage b = reference.convertToFormat(QImage::Format_ARGB32);
+    if (a.size() != b.size()) return a.width() * a.height();
+
+    int differing = 0;
+    for (int y = 0; y < a.height(); ++y) {
+        const QRgb *rowA = reinterpret_cast<const QRgb *>(a.constScanLine(y));
+        const QRgb *rowB = reinterpret_cast<const QRgb *>(b.constScanLine(y));
+        for (int x = 0; x < a.width(); ++x) differing += rowA[x] != rowB[x];
+    }
+    return differing;
+}
+
+/*
+    Function: runScene
+    Purpose: Show one scene and step its animations frame by frame, painting each frame
+    Inputs:
+        scene: BenchScene to show
+        version: unsigned integer, publication count given to the scene's snapshot
+    Return: SceneResult with the scene's timings and counts
+*/
+SceneResult GuiBenchmark::runScene(const BenchScene &scene, unsigned int version) {
+    AnimationClock &animations = window->getAnimations();
+    SceneResult result;
+    result.name = scene.name;
+    result.frames = framesPerScene;
+    result.updateMs = 0;
+    result.paintMs = 0;
+    result.mismatches = 0;
+    this->polishes = 0;
+    this->styleChanges = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    animations.stopAll();
+    DeviceSnapshot snapshot = scene.snapshot;
+    snapshot.version = version;
+    window->showSnapshot(snapshot);
+    // the same slots the device's signals reach
+    QMetaObject::invokeMethod(window, "updateWavelengthBlinker", Qt::DirectConnection, Q_ARG(bool, scene.wavelengthBlink));
+    QMetaObject::invokeMethod(window, "setScrollGraph", Qt::DirectConnection, Q_ARG(bool, scene.scroll));
+    result.updateMs += timer.nsecsElapsed() / 1e6;
+
+    for (int frame = 0; frame < framesPerScene; ++frame) {
+        timer.restart();
+        animations.advance(FRAME_MS);
+        result.updateMs += timer.nsecsElapsed() / 1e6;
+
+        if (!paint) continue;
+        timer.restart();
+        QPixmap pixels = window->grab();
+        result.paintMs += timer.nsecsElapsed() / 1e6;
+
+        if (frame % screenshotEvery != 0 || (screenshotDir.isEmpty() && compareDir.isEmpty())) continue;
+        QString file = QString("%1-%2.png").arg(scene.name).arg(frame, 4, 10, QChar('0'));
+        QImage shot = pixels.toImage();
+        if (!screenshotDir.isEmpty()) shot.save(QDir(screenshotDir).filePath(file));
+        if (!compareDir.isEmpty() && pixelDiff(shot, QDir(compareDir).filePath(file)) != 0) result.mismatches++;
+    }
+    result.polishes = polishes;
+    result.styleChanges = styleChanges;
+    return result;
+}
+
+/*
+    Function: run
+    Purpose: Run every scene of the script once
+    Return: QVector<SceneResult>, one per scene
+*/
+QVector<SceneResult> GuiBenchmark::run() {
+    if (!screenshotDir.isEmpty()) QDir().mkpath(screenshotDir);
+    window->getAnimations().setManual(true);
+    qApp->installEventFilter(this);
+
+    QVector<SceneResult> results;
+    QVector<BenchScene> scenes = script();
+    for (int i = 0; i < scenes.size(); ++i) {
+        results.append(runScene(scenes[i], 1000 + i));
+    }
+
+    qApp->removeEventFilter(this);
+    window->getAnimations().setManual(false);
+    return results;
+}
+
+// table of the scenes followed by the totals
+QString GuiBenchmark::report(const QVector<SceneResult> &results) const {
+    QString out;
+    QTextStream stream(&out);
+    stream << "scene\tframes\tupdate_ms\tpaint_ms\tfps\tpolishes\tstyle_changes\tmismatches\n";
+    int frames = 0, polishTotal = 0, styleTotal = 0, mismatchTotal = 0;
+    double updateTotal = 0, paintTotal = 0;
+    for (const SceneResult &r : results) {
+        double ms = r.updateMs + r.paintMs;
+        stream << r.name << '\t' << r.frames << '\t' << QString::number(r.updateMs, 'f', 2) << '\t'
+               << QString::number(r.paintMs, 'f', 2) << '\t' << QString::number(ms > 0 ? r.frames * 1000.0 / ms : 0, 'f', 0) << '\t'
+               << r.polishes << '\t' << r.styleChanges << '\t' << r.mismatches << '\n';
+        frames += r.frames;
+        updateTotal += r.updateMs;
+        paintTotal += r.paintMs;
+        polishTotal += r.polishes;
+        styleTotal += r.styleChanges;
+        mismatchTotal += r.mismatches;
+    }
+    double ms = updateTotal + paintTotal;
+    stream << "# " << frames << " frames in " << QString::number(ms, 'f', 1) << " ms, "
+           << QString::number(ms > 0 ? frames * 1000.0 / ms : 0, 'f', 0) << " fps, "
+           << polishTotal << " polishes, " << styleTotal << " style changes, "
+           << mismatchTotal << " screenshot mismatches\n";
+    return out;
+}
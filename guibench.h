@@ -0,0 +1,69 @@
+#ifndef GUIBENCH_H
+#define GUIBENCH_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include "mainwindow.h"
+
+// one scripted display state and the animations running on top of it
+struct BenchScene {
+    QString name;
+    DeviceSnapshot snapshot;
+    bool wavelengthBlink;   // connection test blink of the wavelength icons
+    bool scroll;            // safe voltage scroll of the graph
+};
+
+// what one scene cost
+struct SceneResult {
+    QString name;
+    int frames;
+    double updateMs;    // snapshot display plus animation frames
+    double paintMs;     // rendering the window to a pixmap
+    int polishes;
+    int styleChanges;
+    int mismatches;     // screenshots differing from the reference set
+};
+
+/*
+    Class: GuiBenchmark
+    Purpose: Drives a MainWindow through scripted snapshots of every state, battery warning,
+             connection test blink and safe voltage scroll, stepping its animations on a
+             manual clock. Measures frames per second and polish / style change events, and
+             saves or compares screenshots for pixel regression. Meant for the offscreen platform.
+ */
+class GuiBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit GuiBenchmark(MainWindow *, QObject *parent = nullptr);
+
+    void setFramesPerScene(int);
+    void setScreenshotEvery(int);
+    void setScreenshotDir(QString);
+    void setCompareDir(QString);
+    void setPaint(bool);
+
+    QVector<BenchScene> script() const;
+    QVector<SceneResult> run();
+    QString report(const QVector<SceneResult> &) const;
+
+protected:
+    bool eventFilter(QObject *, QEvent *) override;
+
+private:
+    MainWindow *window;
+    int framesPerScene;
+    int screenshotEvery;
+    QString screenshotDir;
+    QString compareDir;
+    bool paint;
+    int polishes;
+    int styleChanges;
+
+    SceneResult runScene(const BenchScene &, unsigned int version);
+};
+
+#endif // GUIBENCH_H
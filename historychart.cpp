@@ -0,0 +1,175 @@
+#include "historychart.h"
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QLineF>
+#include <QPainter>
+
+#include "devicecore.h"
+
+// the states a session is made of
+static const uint32_t SESSION_STATES = 1u << State::InSession | 1u << State::Paused | 1u << State::SoftOff;
+
+HistoryChart::HistoryChart(TelemetryStore *s, uint32_t id, int max, QWidget *parent) : QWidget(parent),
+                                                                                      store(s),
+                                                                                      series(id),
+                                                                                      maxIntensity(max > 0 ? max : 1),
+                                                                                      fromMs(0),
+                                                                                      toMs(0),
+                                                                                      bucketMs(1000),
+                                                                                      following(false),
+                                                                                      samplesShown(0),
+                                                                                      decimateUs(0),
+                                                                                      refreshTimer(this) {
+    setMinimumSize(400, 160);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+
+    // telemetry is sampled once a second, there is nothing new to draw any sooner
+    this->refreshTimer.setInterval(1000);
+    connect(&refreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+    this->refreshTimer.start();
+}
+
+void HistoryChart::showRange(qint64 from, qint64 to) {
+    this->fromMs = from;
+    this->toMs = to > from ? to : from + 1000;
+    this->following = false;
+    decimate();
+}
+
+void HistoryChart::follow(qint64 from) {
+    this->fromMs = from;
+    this->following = true;
+    refresh();
+}
+
+const std::vector<TelemetrySpan> &HistoryChart::getSessions() const {
+    return sessions;
+}
+
+qint64 HistoryChart::getStart() const {
+    return fromMs;
+}
+
+// a followed range moves on to now, a fixed one is already drawn, only the session list can grow
+void HistoryChart::refresh() {
+    if (following) {
+        this->toMs = QDateTime::currentMSecsSinceEpoch();
+        if (this->toMs <= this->fromMs) this->toMs = this->fromMs + 1000;
+        decimate();
+    }
+    size_t before = sessions.size();
+    this->sessions = store->spans(series, 0, QDateTime::currentMSecsSinceEpoch(), SESSION_STATES);
+    if (sessions.size() != before) {
+        update();
+        emit sessionsChanged((int)sessions.size());
+    }
+}
+
+void HistoryChart::resizeEvent(QResizeEvent *) {
+    decimate();
+}
+
+// room left for the axis labels
+QRect HistoryChart::plotArea() const {
+    return rect().adjusted(40, 18, -8, -18);
+}
+
+/*
+    Function: decimate
+    Purpose: Reduce the range to one bucket per pixel column, each with the battery, intensity
+             and connection extremes
+    Return: void
+*/
+void HistoryChart::decimate() {
+    QElapsedTimer timer;
+    timer.start();
+    int width = plotArea().width() > 1 ? plotArea().width() : 1;
+    this->bucketMs = (toMs - fromMs + width - 1) / width;
+    if (this->bucketMs < 1) this->bucketMs = 1;
+    this->columns = store->downsample(series, fromMs, toMs, bucketMs);
+    this->samplesShown = 0;
+    for (const TelemetryBucket &column : columns) this->samplesShown += column.count;
+    this->decimateUs = timer.nsecsElapsed() / 1000;
+    update();
+}
+
+/*
+    Function: paintEvent
+    Purpose: Draw the battery in the top lane as a min/max band with its last value, the
+             intensity in the middle lane as bars of the highest level, and the connection in
+             the bottom strip coloured by its worst grade. Lines and bars of one kind are
+             batched into a single call.
+    Return: void
+*/
+void HistoryChart::paintEvent(QPaintEvent *) {
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(20, 20, 20));
+    QRect plot = plotArea();
+    int batteryH = plot.height() * 6 / 10;
+    int intensityH = plot.height() * 25 / 100;
+    int intensityTop = plot.top() + batteryH + 4;
+    int connectionTop = intensityTop + intensityH + 4;
+    int connectionH = plot.bottom() - connectionTop;
+    double span = (double)(toMs - fromMs);
+    auto xAt = [&plot, span, this](qint64 ms) { return plot.left() + (ms - fromMs) * plot.width() / span; };
+
+    // sessions behind everything
+    for (const TelemetrySpan &session : sessions) {
+        if (session.endMs < fromMs || session.startMs > toMs) continue;
+        double left = qMax((double)plot.left(), xAt(session.startMs));
+        double right = qMin((double)plot.right(), xAt(session.endMs));
+        painter.fillRect(QRectF(left, plot.top(), qMax(1.0, right - left), plot.height()), QColor(40, 60, 90));
+    }
+
+    QVector<QLineF> batteryBand;
+    QVector<QLineF> batteryLine;
+    QVector<QRectF> intensityBars;
+    QVector<QRectF> connection[4];
+    auto batteryY = [&plot, batteryH](float level) { return plot.top() + batteryH * (1 - level / 100.0); };
+    double columnW = qMax(1.0, bucketMs * plot.width() / span);
+    qint64 lastColumn = -2;
+    double lastX = 0;
+    double lastY = 0;
+    for (const TelemetryBucket &column : columns) {
+        qint64 index = (column.startMs - fromMs) / bucketMs;
+        double x = xAt(column.startMs);
+        double y = batteryY(column.batteryLast);
+        batteryBand.append(QLineF(x, batteryY(column.batteryMax), x, batteryY(column.batteryMin)));
+        if (index == lastColumn + 1) batteryLine.append(QLineF(lastX, lastY, x, y));  // gaps stay gaps
+        lastColumn = index;
+        lastX = x;
+        lastY = y;
+
+        double barH = intensityH * column.intensityMax / (double)maxIntensity;
+        if (barH > 0) intensityBars.append(QRectF(x, intensityTop + intensityH - barH, columnW, barH));
+        connection[column.connectionMax & 3].append(QRectF(x, connectionTop, columnW, connectionH));
+    }
+
+    painter.setPen(QColor(60, 140, 60));
+    painter.drawLines(batteryBand);
+    painter.setPen(QPen(QColor(120, 255, 120), 1.5));
+    painter.drawLines(batteryLine);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QColor(255, 170, 60));
+    painter.drawRects(intensityBars);
+    const QColor grades[4] = {QColor(90, 90, 90), QColor("green"), QColor("yellow"), QColor("red")};  // by ConnectionStatus
+    for (int grade = 0; grade < 4; ++grade) {
+        painter.setBrush(grades[grade]);
+        painter.drawRects(connection[grade]);
+    }
+
+    painter.setPen(Qt::lightGray);
+    painter.setBrush(Qt::NoBrush);
+    painter.drawText(QRect(0, plot.top() - 6, plot.left() - 4, 14), Qt::AlignRight, "100%");
+    painter.drawText(QRect(0, plot.top() + batteryH - 8, plot.left() - 4, 14), Qt::AlignRight, "0%");
+    painter.drawText(QRect(0, intensityTop - 2, plot.left() - 4, 14), Qt::AlignRight, QString::number(maxIntensity));
+    painter.drawText(QRect(0, connectionTop - 2, plot.left() - 4, 14), Qt::AlignRight, "conn");
+    QString format = toMs - fromMs > 86400000 ? "MMM d HH:mm" : "HH:mm:ss";
+    painter.drawText(QRect(plot.left(), plot.bottom() + 2, plot.width(), 16), Qt::AlignLeft,
+                     QDateTime::fromMSecsSinceEpoch(fromMs).toString(format));
+    painter.drawText(QRect(plot.left(), plot.bottom() + 2, plot.width(), 16), Qt::AlignRight,
+                     QDateTime::fromMSecsSinceEpoch(toMs).toString(format));
+    painter.drawText(QRect(plot.left(), 0, plot.width(), 16), Qt::AlignRight,
+                     QString("%1 samples in %2 columns, %3 us").arg(samplesShown).arg(columns.size()).arg(decimateUs));
+}
@@ -0,0 +1,61 @@
+#ifndef HISTORYCHART_H
+#define HISTORYCHART_H
+
+#include <QWidget>
+#include <QTimer>
+#include <QVector>
+
+#include <vector>
+
+#include "telemetry.h"
+
+/*
+    Class: HistoryChart
+    Purpose: Plots a device's battery, intensity and connection from its telemetry, with its
+             sessions shaded behind. However many samples the range holds, the store reduces
+             them to one min/max bucket per pixel column in a single pass over its blocks, so
+             a repaint only draws as many columns as the chart is wide.
+ */
+class HistoryChart : public QWidget
+{
+    Q_OBJECT
+
+public:
+    HistoryChart(TelemetryStore *, uint32_t, int maxIntensity, QWidget *parent = nullptr);
+
+    void showRange(qint64, qint64);  // a fixed range, wall clock ms
+    void follow(qint64);             // from a time up to now, moving on with every new sample
+    const std::vector<TelemetrySpan> &getSessions() const;
+    qint64 getStart() const;
+
+protected:
+    void paintEvent(QPaintEvent *) override;
+    void resizeEvent(QResizeEvent *) override;
+
+private:
+    TelemetryStore *store;
+    uint32_t series;
+    int maxIntensity;  // top of the intensity bars
+    qint64 fromMs;
+    qint64 toMs;
+    qint64 bucketMs;
+    bool following;
+
+    // what the last decimation produced, redrawn as is until the range, size or data changes
+    std::vector<TelemetryBucket> columns;
+    std::vector<TelemetrySpan> sessions;
+    qint64 samplesShown;
+    qint64 decimateUs;
+    QTimer refreshTimer;
+
+    void decimate();
+    QRect plotArea() const;
+
+private slots:
+    void refresh();
+
+signals:
+    void sessionsChanged(int);
+};
+
+#endif // HISTORYCHART_H
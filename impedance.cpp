@@ -0,0 +1,248 @@
+#include "impedance.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "lifecycle.h"
+
+ElectrodeParams::ElectrodeParams() : reversionRate(0.5), noiseOhms(150) {
+    // Firm contact mostly stays firm, a loose electrode usually settles back
+    double defaults[3][3] = {
+        {0, 0.002, 0.0005}, // from Firm
+        {0.05, 0, 0.01},    // from Loose
+        {0.02, 0.01, 0},    // from Detached
+    };
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            rates[i][j] = defaults[i][j];
+    meanOhms[0] = 1500;
+    meanOhms[1] = 6000;
+    meanOhms[2] = 1000000;
+}
+
+static int contactIndex(const std::string &name) {
+    return name == "firm" ? 0 : name == "loose" ? 1 : name == "detached" ? 2 : -1;
+}
+
+/*
+    Function: parseElectrodeParams
+    Purpose: Override some of the params from comma separated key=value pairs. Keys are
+             reversion and noise, a contact state (firm, loose, detached) for its mean ohms, or
+             from>to for a transition rate per second, e.g. firm>detached=0.001
+    Inputs:
+        spec: string, the pairs
+        params: ElectrodeParams, changed in place
+    Return: false if a key or value was not understood, params may be partly changed
+*/
+bool parseElectrodeParams(const std::string &spec, ElectrodeParams &params) {
+    size_t start = 0;
+    while (start < spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == std::string::npos) end = spec.size();
+        std::string pair = spec.substr(start, end - start);
+        start = end + 1;
+        size_t equals = pair.find('=');
+        if (equals == std::string::npos) return false;
+        std::string key = pair.substr(0, equals);
+        const char *text = pair.c_str() + equals + 1;
+        char *rest = nullptr;
+        double value = std::strtod(text, &rest);
+        if (rest == text || *rest != '\0' || value < 0) return false;
+
+        size_t arrow = key.find('>');
+        if (key == "reversion") {
+            params.reversionRate = value;
+        } else if (key == "noise") {
+            params.noiseOhms = value;
+        } else if (arrow != std::string::npos) {
+            int from = contactIndex(key.substr(0, arrow));
+            int to = contactIndex(key.substr(arrow + 1));
+            if (from < 0 || to < 0 || from == to) return false;
+            params.rates[from][to] = value;
+        } else if (contactIndex(key) >= 0) {
+            params.meanOhms[contactIndex(key)] = value;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// xorshift32, one stream per electrode so the loops have no shared state
+static inline uint32_t nextRandom(uint32_t &state) {
+    uint32_t x = state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state = x;
+    return x;
+}
+
+static inline float uniform(uint32_t &state) {
+    return (nextRandom(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+ImpedanceField::ImpedanceField(size_t devices, const ElectrodeParams &params, uint32_t seed)
+    : ImpedanceField(devices, params, params, seed) {}
+
+ImpedanceField::ImpedanceField(size_t devices, const ElectrodeParams &left, const ElectrodeParams &right, uint32_t seed)
+    : devices(devices),
+      contact(2 * devices, (uint8_t)ContactState::Firm),
+      impedance(2 * devices),
+      rng(2 * devices),
+      loop(devices, (float)(left.meanOhms[0] + right.meanOhms[0])),
+      grade(devices, 2),
+      inSession(devices, 0),
+      disconnectedFor(devices, 0) {
+    setElectrodeParams(LeftElectrode, left);
+    setElectrodeParams(RightElectrode, right);
+    std::fill(impedance.begin(), impedance.begin() + devices, (float)left.meanOhms[0]);
+    std::fill(impedance.begin() + devices, impedance.end(), (float)right.meanOhms[0]);
+    // spread the seed so neighbouring electrodes are uncorrelated, xorshift can not hold 0
+    for (size_t i = 0; i < rng.size(); ++i) {
+        uint32_t s = seed + 0x9E3779B9u * (uint32_t)(i + 1);
+        s ^= s >> 16;
+        s *= 0x85EBCA6Bu;
+        s ^= s >> 13;
+        rng[i] = s ? s : 1;
+    }
+    study.disconnects = 0;
+    study.pauses = 0;
+    study.safeVoltages = 0;
+    study.deviceSeconds = 0;
+}
+
+// contact states and impedances carry on from where they are under the new params
+void ImpedanceField::setElectrodeParams(Electrode side, const ElectrodeParams &p) {
+    this->params[side] = p;
+    for (int from = 0; from < 3; ++from) {
+        double sum = 0;
+        for (int to = 0; to < 3; ++to) {
+            sum += from == to ? 0 : p.rates[from][to];
+            cumulative[side][from][to] = sum;
+        }
+    }
+}
+
+const ElectrodeParams &ImpedanceField::getElectrodeParams(Electrode side) const {
+    return params[side];
+}
+
+/*
+    Function: step
+    Purpose: Advance every electrode and device by dt seconds. Contact states jump with
+             probability rate * dt, impedances follow an Ornstein-Uhlenbeck process towards
+             the mean of their contact state, each side with its own params, then each
+             device's loop impedance is graded.
+    Inputs:
+        dt: double, step length in seconds, should be small against 1 / rate
+    Return: void
+ */
+void ImpedanceField::step(double dt) {
+    stepElectrodes(LeftElectrode, dt);
+    stepElectrodes(RightElectrode, dt);
+
+    // counters accumulate from comparisons so this loop stays branch free too
+    const float fdt = (float)dt;
+    const float delay = (float)(SAFE_VOLTAGE_DELAY_MS / 1000.0);
+    const float *z = impedance.data();
+    float *l = loop.data();
+    uint8_t *g = grade.data();
+    const uint8_t *s = inSession.data();
+    float *off = disconnectedFor.data();
+    long long disconnects = 0, pauses = 0, safeVoltages = 0;
+    for (size_t d = 0; d < devices; ++d) {
+        float total = z[d] + z[devices + d];
+        l[d] = total;
+        uint32_t next = total < EXCELLENT_BELOW_OHMS ? 2 : total < OKAY_BELOW_OHMS ? 1 : 0;
+
+        uint32_t dropped = (next == 0) & (g[d] != 0);
+        disconnects += dropped;
+        pauses += dropped & s[d];
+
+        float before = off[d];
+        float after = next == 0 ? before + fdt : 0;
+        safeVoltages += s[d] & (before < delay) & (after >= delay);
+        off[d] = after;
+        g[d] = (uint8_t)next;
+    }
+    study.disconnects += disconnects;
+    study.pauses += pauses;
+    study.safeVoltages += safeVoltages;
+    study.deviceSeconds += dt * devices;
+}
+
+/*
+    Function: stepElectrodes
+    Purpose: Contact jumps and impedance noise of one side's electrodes over dt seconds
+    Inputs:
+        side: Electrode, the half of the arrays to advance
+        dt: double, step length in seconds
+    Return: void
+ */
+void ImpedanceField::stepElectrodes(Electrode side, double dt) {
+    const ElectrodeParams &p = params[side];
+    const float decay = (float)(p.reversionRate * dt);
+    // sum of four uniforms has variance 1/3, scale it to a unit normal approximation
+    const float sigma = (float)(p.noiseOhms * std::sqrt(dt) * std::sqrt(3.0));
+
+    // per step jump probabilities, selected per lane rather than gathered so the loops vectorize
+    float jump[3][3];
+    for (int from = 0; from < 3; ++from)
+        for (int to = 0; to < 3; ++to)
+            jump[from][to] = (float)(cumulative[side][from][to] * dt);
+    const float mean0 = (float)p.meanOhms[0];
+    const float mean1 = (float)p.meanOhms[1];
+    const float mean2 = (float)p.meanOhms[2];
+
+    // left electrodes at [0, devices), right at [devices, 2 * devices)
+    uint8_t *__restrict c = contact.data() + side * devices;
+    float *__restrict z = impedance.data() + side * devices;
+    uint32_t *__restrict r = rng.data() + side * devices;
+    for (size_t i = 0; i < devices; ++i) {
+
+        uint32_t from = c[i];
+        float u = uniform(r[i]);
+        float t0 = from == 0 ? jump[0][0] : from == 1 ? jump[1][0] : jump[2][0];
+        float t1 = from == 0 ? jump[0][1] : from == 1 ? jump[1][1] : jump[2][1];
+        float t2 = from == 0 ? jump[0][2] : from == 1 ? jump[1][2] : jump[2][2];
+        uint32_t to = u < t0 ? 0 : u < t1 ? 1 : u < t2 ? 2 : from;
+
+        float noise = uniform(r[i]) + uniform(r[i]) + uniform(r[i]) + uniform(r[i]) - 2.0f;
+        float mean = to == 0 ? mean0 : to == 1 ? mean1 : mean2;
+        float next = z[i] + decay * (mean - z[i]) + sigma * noise;
+        z[i] = next < 0 ? 0 : next;
+        c[i] = (uint8_t)to;
+    }
+}
+
+size_t ImpedanceField::size() const {
+    return devices;
+}
+
+double ImpedanceField::getLoopImpedance(size_t device) const {
+    return loop[device];
+}
+
+int ImpedanceField::getGrade(size_t device) const {
+    return grade[device];
+}
+
+ContactState ImpedanceField::getContact(size_t device, int electrode) const {
+    return (ContactState)contact[electrode == 0 ? device : devices + device];
+}
+
+void ImpedanceField::setInSession(size_t device, bool inSession) {
+    this->inSession[device] = inSession ? 1 : 0;
+}
+
+// number of devices currently graded No, Okay and Excellent
+void ImpedanceField::countGrades(size_t counts[3]) const {
+    counts[0] = counts[1] = counts[2] = 0;
+    for (size_t d = 0; d < devices; ++d) counts[grade[d]]++;
+}
+
+const ContactStudy &ImpedanceField::getStudy() const {
+    return study;
+}
@@ -0,0 +1,91 @@
+#ifndef IMPEDANCE_H
+#define IMPEDANCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// contact of a single electrode with the skin
+enum class ContactState : uint8_t {Firm = 0, Loose = 1, Detached = 2};
+
+// loop impedance (left + right electrode) thresholds used to grade the connection
+const double EXCELLENT_BELOW_OHMS = 5000;
+const double OKAY_BELOW_OHMS = 20000;
+
+// the two electrodes of a device
+enum Electrode {LeftElectrode = 0, RightElectrode = 1};
+
+/*
+    Struct: ElectrodeParams
+    Purpose: Markov contact process and Ornstein-Uhlenbeck impedance noise for one electrode.
+             Rates are transitions per second, the impedance of each contact state
+             reverts towards its mean at reversionRate with noiseOhms of noise per sqrt(s).
+ */
+struct ElectrodeParams {
+    double rates[3][3];
+    double meanOhms[3];
+    double reversionRate;
+    double noiseOhms;
+    ElectrodeParams();
+};
+
+// apply a spec like "noise=300,loose=8000,firm>loose=0.01" to params, false on an unknown key
+bool parseElectrodeParams(const std::string &spec, ElectrodeParams &params);
+
+// what happened across the field during one step or a whole run
+struct ContactStudy {
+    long long disconnects;     // transitions into a No connection grade
+    long long pauses;          // disconnects of devices that were in a session
+    long long safeVoltages;    // disconnects that outlasted SAFE_VOLTAGE_DELAY_MS in session
+    double deviceSeconds;      // simulated device time covered
+};
+
+/*
+    Class: ImpedanceField
+    Purpose: Contact and impedance state for many devices, two electrodes each, kept as
+             structure of arrays so the per step update runs as flat vectorizable loops.
+             Left and right electrodes each follow their own ElectrodeParams.
+ */
+class ImpedanceField
+{
+public:
+    ImpedanceField(size_t devices, const ElectrodeParams &params = ElectrodeParams(), uint32_t seed = 1);
+    ImpedanceField(size_t devices, const ElectrodeParams &left, const ElectrodeParams &right, uint32_t seed = 1);
+
+    // change one side's contact process and noise from the next step on
+    void setElectrodeParams(Electrode, const ElectrodeParams &);
+    const ElectrodeParams &getElectrodeParams(Electrode) const;
+
+    void step(double dt);
+    size_t size() const;
+
+    double getLoopImpedance(size_t device) const;
+    int getGrade(size_t device) const;  // 0 No, 1 Okay, 2 Excellent, same as the connection slider
+    ContactState getContact(size_t device, int electrode) const;
+    void setInSession(size_t device, bool inSession);
+    void countGrades(size_t counts[3]) const;
+    const ContactStudy &getStudy() const;
+
+private:
+    ElectrodeParams params[2];
+    double cumulative[2][3][3]; // per electrode, per second cumulative transition rates by from-state
+    size_t devices;
+
+    void stepElectrodes(Electrode, double dt);
+
+    // per electrode, left electrodes at [0, devices) right at [devices, 2 * devices)
+    std::vector<uint8_t> contact;
+    std::vector<float> impedance;
+    std::vector<uint32_t> rng;
+
+    // per device
+    std::vector<float> loop;
+    std::vector<uint8_t> grade;
+    std::vector<uint8_t> inSession;
+    std::vector<float> disconnectedFor;
+
+    ContactStudy study;
+};
+
+#endif // IMPEDANCE_H
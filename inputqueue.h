@@ -0,0 +1,104 @@
+#ifndef INPUTQUEUE_H
+#define INPUTQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// every input a device accepts, whoever produces it
+enum class DeviceInput : uint8_t {
+    PowerPress,
+    PowerRelease,
+    IntensityUp,
+    IntensityDown,
+    StartSession,
+    SetBattery,     // value: percent
+    ResetBattery,
+    SetConnection,  // value: 0 none, 1 okay, 2 excellent
+    Username,       // text
+    Record,
+    Replay
+};
+
+struct DeviceInputEvent {
+    DeviceInput input;
+    int32_t value;
+    std::string text;
+};
+
+/*
+    Class: MpscQueue
+    Purpose: Bounded lock-free queue, any number of threads push and one thread pops. Each
+             cell carries a sequence number telling producers and the consumer whose turn it
+             is, a producer claims a cell with one compare and swap on the tail and never
+             waits for another producer to finish.
+ */
+template <typename T>
+class MpscQueue
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit MpscQueue(size_t capacity = 1024) : cells(roundUp(capacity)), mask(cells.size() - 1), head(0), tail(0) {
+        for (size_t i = 0; i < cells.size(); ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    // any thread, false when the queue is full
+    bool push(T value) {
+        size_t position = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells[position & mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+            if (difference == 0) {
+                if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // consumer thread only, false when nothing is ready
+    bool pop(T &value) {
+        Cell &cell = cells[head & mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (sequence != head + 1) return false;
+        value = std::move(cell.value);
+        cell.sequence.store(head + mask + 1, std::memory_order_release);
+        head++;
+        return true;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+        Cell() : sequence(0) {}
+    };
+
+    static size_t roundUp(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        return size;
+    }
+
+    std::vector<Cell> cells;
+    size_t mask;
+    alignas(64) size_t head;  // consumer only
+    alignas(64) std::atomic<size_t> tail;
+};
+
+#endif // INPUTQUEUE_H
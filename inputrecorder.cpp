@@ -0,0 +1,262 @@
+#include "inputrecorder.h"
+
+#include <QAbstractButton>
+#include <QButtonGroup>
+#include <QFile>
+#include <QLineEdit>
+#include <QSlider>
+#include <QTextStream>
+#include <algorithm>
+
+// names used in recording files, in InputKind order
+static const char *KIND_NAMES[] = {"power-press", "power-release", "intensity-up", "intensity-down",
+                                   "start-session", "battery", "connection", "username"};
+static const int KIND_COUNT = sizeof(KIND_NAMES) / sizeof(KIND_NAMES[0]);
+
+// time left after the last input for its display update to arrive
+static const int SETTLE_MS = 2000;
+
+InputRecorder::InputRecorder(MainWindow *w, QObject *parent) : QObject(parent),
+                                                               window(w),
+                                                               recording(false),
+                                                               nextEvent(0),
+                                                               firstPending(0) {
+    this->replayTimer.setSingleShot(true);
+    this->replayTimer.setTimerType(Qt::PreciseTimer);
+    connect(&replayTimer, SIGNAL(timeout()), this, SLOT(replayNext()));
+    connect(w, SIGNAL(displayUpdated()), this, SLOT(displayUpdated()));
+}
+
+/*
+    Function: startRecording
+    Purpose: Start capturing the window's inputs, timestamps count from now
+    Return: void
+*/
+void InputRecorder::startRecording() {
+    this->events.clear();
+    this->recording = true;
+    this->clock.start();
+
+    auto power = window->findChild<QAbstractButton *>("powerButton");
+    connect(power, SIGNAL(pressed()), this, SLOT(powerPressed()));
+    connect(power, SIGNAL(released()), this, SLOT(powerReleased()));
+    connect(window->findChild<QButtonGroup *>("intArrowButtonGroup"), SIGNAL(buttonClicked(QAbstractButton*)), this, SLOT(arrowClicked(QAbstractButton*)));
+    connect(window->findChild<QAbstractButton *>("checkMarkButton"), SIGNAL(pressed()), this, SLOT(startPressed()));
+    connect(window->findChild<QSlider *>("batteryLevelSlider"), SIGNAL(valueChanged(int)), this, SLOT(batteryMoved(int)));
+    connect(window->findChild<QSlider *>("connectionStrengthSlider"), SIGNAL(valueChanged(int)), this, SLOT(connectionMoved(int)));
+    connect(window->findChild<QLineEdit *>("usernameInput"), SIGNAL(textEdited(QString)), this, SLOT(usernameEdited(QString)));
+}
+
+void InputRecorder::record(InputKind kind, int value, QString text) {
+    if (!recording) return;
+    InputEvent event;
+    event.atMs = clock.elapsed();
+    event.kind = kind;
+    event.value = value;
+    event.text = text;
+    this->events.append(event);
+}
+
+void InputRecorder::powerPressed() {
+    record(InputKind::PowerPress);
+}
+
+void InputRecorder::powerReleased() {
+    record(InputKind::PowerRelease);
+}
+
+void InputRecorder::arrowClicked(QAbstractButton *button) {
+    bool up = button == window->findChild<QAbstractButton *>("intUpButton");
+    record(up ? InputKind::IntensityUp : InputKind::IntensityDown);
+}
+
+void InputRecorder::startPressed() {
+    record(InputKind::StartSession);
+}
+
+void InputRecorder::batteryMoved(int value) {
+    record(InputKind::Battery, value);
+}
+
+void InputRecorder::connectionMoved(int value) {
+    record(InputKind::Connection, value);
+}
+
+void InputRecorder::usernameEdited(QString text) {
+    record(InputKind::Username, 0, text);
+}
+
+/*
+    Function: save
+    Purpose: Write the recording as tab separated lines of time, input, value and text
+    Inputs:
+        path: QString, file to write
+    Return: bool, false if the file could not be written
+*/
+bool InputRecorder::save(QString path) const {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+    QTextStream out(&file);
+    out << "# oasis-pro input recording: ms, input, value, text\n";
+    for (const InputEvent &event : events) {
+        out << event.atMs << '\t' << KIND_NAMES[(int)event.kind] << '\t' << event.value << '\t' << event.text << '\n';
+    }
+    return true;
+}
+
+// read a recording written by save, unknown inputs are skipped
+bool InputRecorder::load(QString path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+    this->events.clear();
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QString line = in.readLine();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+        QStringList fields = line.split('\t');
+        int kind = 0;
+        while (kind < KIND_COUNT && fields.value(1) != KIND_NAMES[kind]) ++kind;
+        if (kind == KIND_COUNT) continue;
+
+        InputEvent event;
+        event.atMs = fields.value(0).toLongLong();
+        event.kind = (InputKind)kind;
+        event.value = fields.value(2).toInt();
+        event.text = fields.value(3);
+        this->events.append(event);
+    }
+    return true;
+}
+
+/*
+    Function: replay
+    Purpose: Feed the loaded inputs to the window at their recorded times. replayFinished
+             is emitted a little after the last one so its display update can land.
+    Return: void
+*/
+void InputRecorder::replay() {
+    this->recording = false;
+    this->latencies.clear();
+    this->sentAtNs.fill(-1, events.size());
+    for (const InputEvent &event : events) {
+        InputLatency latency;
+        latency.event = event;
+        latency.latencyMs = -1;
+        this->latencies.append(latency);
+    }
+    this->nextEvent = 0;
+    this->firstPending = 0;
+    this->clock.start();
+    replayNext();
+}
+
+// deliver every input that is due and wait for the next one
+void InputRecorder::replayNext() {
+    while (nextEvent < events.size() && events[nextEvent].atMs <= clock.elapsed()) {
+        this->sentAtNs[nextEvent] = clock.nsecsElapsed();
+        deliver(events[nextEvent]);
+        this->nextEvent++;
+    }
+    if (nextEvent < events.size()) {
+        this->replayTimer.setInterval((int)(events[nextEvent].atMs - clock.elapsed()));
+        this->replayTimer.start();
+    } else {
+        QTimer::singleShot(SETTLE_MS, this, [this]() { emit this->replayFinished(); });
+    }
+}
+
+/*
+    Function: deliver
+    Purpose: Drive the control an input was recorded on the way a user would. Disabled
+             controls ignore the input just like they do for a user.
+    Inputs:
+        event: InputEvent to deliver
+    Return: void
+*/
+void InputRecorder::deliver(const InputEvent &event) {
+    switch (event.kind) {
+        case InputKind::PowerPress:
+        case InputKind::PowerRelease: {
+            auto power = window->findChild<QAbstractButton *>("powerButton");
+            if (!power->isEnabled()) break;
+            power->setDown(event.kind == InputKind::PowerPress);
+            if (event.kind == InputKind::PowerPress) {
+                emit power->pressed();
+            } else {
+                emit power->released();
+            }
+            break;
+        }
+        case InputKind::IntensityUp:
+            window->findChild<QAbstractButton *>("intUpButton")->click();
+            break;
+        case InputKind::IntensityDown:
+            window->findChild<QAbstractButton *>("intDownButton")->click();
+            break;
+        case InputKind::StartSession: {
+            auto check = window->findChild<QAbstractButton *>("checkMarkButton");
+            if (check->isEnabled()) emit check->pressed();
+            break;
+        }
+        case InputKind::Battery:
+            window->findChild<QSlider *>("batteryLevelSlider")->setValue(event.value);
+            break;
+        case InputKind::Connection:
+            window->findChild<QSlider *>("connectionStrengthSlider")->setValue(event.value);
+            break;
+        case InputKind::Username: {
+            auto name = window->findChild<QLineEdit *>("usernameInput");
+            if (!name->isEnabled()) break;
+            name->setText(event.text);
+            emit name->textEdited(event.text);
+            break;
+        }
+    }
+}
+
+// an update finished, every input sent since the last one is charged up to now
+void InputRecorder::displayUpdated() {
+    if (recording) return;
+    qint64 now = clock.nsecsElapsed();
+    for (int i = firstPending; i < nextEvent; ++i) {
+        this->latencies[i].latencyMs = (now - sentAtNs[i]) / 1e6;
+    }
+    this->firstPending = nextEvent;
+}
+
+QVector<InputEvent> InputRecorder::getEvents() const {
+    return events;
+}
+
+QVector<InputLatency> InputRecorder::getLatencies() const {
+    return latencies;
+}
+
+/*
+    Function: report
+    Purpose: Per input latency of the last replay followed by a summary of the measured ones
+    Return: QString, tab separated table
+*/
+QString InputRecorder::report() const {
+    QString out;
+    QTextStream stream(&out);
+    QVector<double> measured;
+    stream << "input\tat_ms\tlatency_ms\n";
+    for (const InputLatency &latency : latencies) {
+        stream << KIND_NAMES[(int)latency.event.kind] << '\t' << latency.event.atMs << '\t';
+        if (latency.latencyMs < 0) {
+            stream << "-\n";
+        } else {
+            stream << QString::number(latency.latencyMs, 'f', 3) << '\n';
+            measured.append(latency.latencyMs);
+        }
+    }
+    std::sort(measured.begin(), measured.end());
+    if (!measured.isEmpty()) {
+        stream << "# " << measured.size() << " of " << latencies.size() << " inputs updated the display"
+               << ", median " << QString::number(measured[measured.size() / 2], 'f', 3)
+               << " ms, p95 " << QString::number(measured[(measured.size() * 95) / 100], 'f', 3)
+               << " ms, max " << QString::number(measured.last(), 'f', 3) << " ms\n";
+    }
+    return out;
+}
@@ -0,0 +1,79 @@
+#ifndef INPUTRECORDER_H
+#define INPUTRECORDER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+#include <QTimer>
+
+#include "mainwindow.h"
+
+// the window inputs a recording can hold
+enum class InputKind {PowerPress, PowerRelease, IntensityUp, IntensityDown, StartSession, Battery, Connection, Username};
+
+struct InputEvent {
+    qint64 atMs;      // since recording started
+    InputKind kind;
+    int value;        // slider position
+    QString text;     // username text after the edit
+};
+
+// how long one replayed input took to reach the screen, -1 if no display update followed it
+struct InputLatency {
+    InputEvent event;
+    double latencyMs;
+};
+
+/*
+    Class: InputRecorder
+    Purpose: Records timestamped inputs on a MainWindow's controls and replays them against
+             another window at the same pace, timing each input to the end of the first
+             updateDisplay that follows it. Controls are found by their object names.
+ */
+class InputRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InputRecorder(MainWindow *, QObject *parent = nullptr);
+
+    void startRecording();
+    bool save(QString) const;
+    bool load(QString);
+    void replay();
+
+    QVector<InputEvent> getEvents() const;
+    QVector<InputLatency> getLatencies() const;
+    QString report() const;
+
+signals:
+    void replayFinished();
+
+private:
+    MainWindow *window;
+    QVector<InputEvent> events;
+    QVector<InputLatency> latencies;
+    QElapsedTimer clock;
+    bool recording;
+    int nextEvent;           // next event to replay
+    int firstPending;        // replayed inputs from here on are waiting for a display update
+    QVector<qint64> sentAtNs;
+    QTimer replayTimer;
+
+    void record(InputKind, int = 0, QString = QString());
+    void deliver(const InputEvent &);
+
+private slots:
+    void powerPressed();
+    void powerReleased();
+    void arrowClicked(QAbstractButton *);
+    void startPressed();
+    void batteryMoved(int);
+    void connectionMoved(int);
+    void usernameEdited(QString);
+    void displayUpdated();
+    void replayNext();
+};
+
+#endif // INPUTRECORDER_H
@@ -0,0 +1,13 @@
+#ifndef LIFECYCLE_H
+#define LIFECYCLE_H
+
+// session lifecycle timings, shared by the device's timers, the coroutine flows and the electrode model
+const int TEST_CONNECTION_MS = 5000;     // connection grade shown before a session starts
+const int SAFE_VOLTAGE_DELAY_MS = 5000;  // disconnected this long before returning to safe voltage
+const int SAFE_VOLTAGE_MS = 20000;       // time to bring the output down to safe voltage
+const int SOFT_OFF_STEP_MS = 1000;       // intensity drops one level per step at the end of a session
+const int SESSION_START_RAMP_MS = 2000;  // output brought up from zero to the session's intensity
+
+enum RampUse {StartRamp, SoftOffRamp, SafeVoltageRamp, NoRamp}; // what the running intensity ramp is for
+
+#endif // LIFECYCLE_H
@@ -1,13 +1,238 @@
 #include "mainwindow.h"
+#include "allocstats.h"
+#include "controlserver.h"
+#include "dashboard.h"
+#include "guibench.h"
+#include "inputrecorder.h"
 #include "device.h"
+#include "sessionflow.h"
+#include "tools.h"
+#include "tracer.h"
 
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+
+#include <memory>
 
 int main(int argc, char *argv[])
 {
+    // headless tools never create a window
+    if (argc > 1 && isToolCommand(argv[1])) {
+        QCoreApplication a(argc, argv);
+        int allocArg = a.arguments().indexOf("--alloc-report");
+        if (allocArg < 0 || !AllocStats::compiledIn()) return runTool(a.arguments());
+        AllocStats::start();
+        int result = runTool(a.arguments());
+        AllocStats::stop();
+        AllocStats::writeReport(a.arguments().value(allocArg + 1, "oasis-allocs.tsv").toStdString());
+        return result;
+    }
+
+    // the GUI benchmark renders without a display unless a platform was asked for
+    bool guiBench = false;
+    for (int i = 1; i < argc; ++i) guiBench = guiBench || QString(argv[i]) == "--gui-bench";
+    if (guiBench && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
     QApplication a(argc, argv);
+    bool impedance = a.arguments().contains("--impedance");
+    // each --electrode left|right|both:key=value,... tunes the electrode model, and turns it on
+    ElectrodeParams leftElectrode, rightElectrode;
+    QString badElectrode;
+    if (!electrodeOptions(a.arguments(), leftElectrode, rightElectrode, &badElectrode)) {
+        qDebug() << "Bad --electrode" << badElectrode;
+        return 1;
+    }
+    impedance = impedance || a.arguments().contains("--electrode");
+
+    // record a trace of the whole run, written once every thread that traces has finished
+    int traceArg = a.arguments().indexOf("--trace");
+    QString tracePath = traceArg >= 0 ? a.arguments().value(traceArg + 1, "oasis-trace.json") : QString();
+    if (!tracePath.isEmpty()) Tracer::instance().start();
+    auto writeTrace = [tracePath]() {
+        if (tracePath.isEmpty()) return;
+        Tracer::instance().stop();
+        if (!Tracer::instance().writeJson(tracePath.toStdString())) qDebug() << "Could not write trace" << tracePath;
+    };
+
+    // heap and copy counts per slot, written when the app quits or the GUI benchmark ends
+    int allocArg = a.arguments().indexOf("--alloc-report");
+    QString allocPath = allocArg >= 0 ? a.arguments().value(allocArg + 1, "oasis-allocs.tsv") : QString();
+    if (allocPath.startsWith("--")) allocPath = "oasis-allocs.tsv";
+    auto writeAllocReport = [allocPath]() {
+        AllocStats::stop();
+        if (!AllocStats::writeReport(allocPath.toStdString())) qDebug() << "Could not write allocation report" << allocPath;
+    };
+    if (!allocPath.isEmpty()) {
+        if (AllocStats::compiledIn()) {
+            AllocStats::start();
+            QObject::connect(&a, &QCoreApplication::aboutToQuit, writeAllocReport);
+        } else {
+            qDebug() << "--alloc-report needs a build with CONFIG += alloc_stats";
+            allocPath.clear();
+        }
+    }
+
+    // a second by second history of every device of this run, kept for a day
+    TelemetryStore telemetry;
+
+    // state of every device in shared memory, for shm-monitor and other local readers
+    int shmArg = a.arguments().indexOf("--shm");
+    QString shmName = shmArg >= 0 ? a.arguments().value(shmArg + 1, "oasis-pro") : QString();
+    if (shmName.startsWith("--")) shmName = "oasis-pro";
+    std::unique_ptr<SharedStateTable> shared;
+    auto share = [&](int capacity) {
+        shared.reset(SharedStateTable::create(shmName.toStdString(), capacity));
+        if (!shared) qDebug() << "Could not create shared state" << shmName;
+    };
+
+    // fleet view: power every device on and start a session on each
+    int dashboardArg = a.arguments().indexOf("--dashboard");
+    if (dashboardArg >= 0) {
+        int count = a.arguments().value(dashboardArg + 1, "100").toInt();
+        if (!shmName.isEmpty()) share(count);
+        QVector<Device *> fleet;
+        for (int i = 0; i < count; ++i) {
+            auto d = new Device();
+            if (impedance) d->core().setImpedanceModel(leftElectrode, rightElectrode, i + 1);
+            d->core().setTelemetry(&telemetry, telemetry.addSeries());
+            if (shared) d->core().setSharedState(shared.get(), shared->claim());
+            d->SetBattery(20 + (i * 37) % 81);
+            d->PowerButtonPressed();  // never released, so it is held and powers on after 1s
+            QTimer::singleShot(1500 + (i * 13) % 1000, d, SLOT(StartSessionButtonClicked()));
+            fleet.append(d);
+        }
+        DashboardWidget dashboard(fleet);
+        dashboard.show();
+        int result = a.exec();
+        writeTrace();
+        return result;
+    }
+
+    // scripted states on an idle device, no device thread needed
+    if (guiBench) {
+        auto option = [&a](QString name, QString fallback) {
+            int index = a.arguments().indexOf(name);
+            return index >= 0 ? a.arguments().value(index + 1, fallback) : fallback;
+        };
+        Device device;
+        MainWindow w(&device);
+        w.show();
+        GuiBenchmark bench(&w);
+        bench.setFramesPerScene(option("--frames", "120").toInt());
+        bench.setScreenshotEvery(option("--shot-every", "30").toInt());
+        bench.setScreenshotDir(option("--screenshots", ""));
+        bench.setCompareDir(option("--compare", ""));
+        bench.setPaint(!a.arguments().contains("--no-paint"));
+        QVector<SceneResult> results = bench.run();
+        if (!allocPath.isEmpty()) writeAllocReport();
+        writeTrace();
+        QTextStream(stdout) << bench.report(results);
+        for (const SceneResult &r : results) {
+            if (r.mismatches > 0) return 1;
+        }
+        return 0;
+    }
+
     auto d = new Device();
+    if (impedance) {
+        d->core().setImpedanceModel(leftElectrode, rightElectrode);
+    }
+    // ramp shapes, each --ramp is use:shape[:ms] with use start, softoff or safe and shape linear, exp or step
+    for (int i = 1; i + 1 < a.arguments().size(); ++i) {
+        if (a.arguments().at(i) != "--ramp") continue;
+        QStringList parts = a.arguments().at(i + 1).split(':');
+        int use = QStringList({"start", "softoff", "safe"}).indexOf(parts.value(0));
+        int shape = QStringList({"linear", "exp", "step"}).indexOf(parts.value(1));
+        if (use < 0 || shape < 0) {
+            qDebug() << "Unknown ramp" << a.arguments().at(i + 1);
+            continue;
+        }
+        int fallback[] = {SESSION_START_RAMP_MS, SOFT_OFF_STEP_MS, SAFE_VOLTAGE_MS};
+        d->core().setRamp((RampUse)use, (RampShape)shape, parts.size() > 2 ? parts.at(2).toInt() : fallback[use]);
+    }
+    // therapy history kept across runs for the history-report tool, saved from the device thread on quit
+    int historyArg = a.arguments().indexOf("--history");
+    QString historyPath = historyArg >= 0 ? a.arguments().value(historyArg + 1, "oasis-history.tsv") : QString();
+    if (!historyPath.isEmpty() && QFile::exists(historyPath) && !d->loadHistory(historyPath)) {
+        qDebug() << "Could not read therapy history" << historyPath;
+    }
+
+    // carry on where the last run left off, then keep the checkpoint current
+    int checkpointArg = a.arguments().indexOf("--checkpoint");
+    if (checkpointArg >= 0) {
+        QString checkpointPath = a.arguments().value(checkpointArg + 1, "oasis-checkpoint.ock");
+        QElapsedTimer restoreTimer;
+        restoreTimer.start();
+        if (QFile::exists(checkpointPath) && d->restoreCheckpoint(checkpointPath)) {
+            qDebug() << "Resumed from" << checkpointPath << "in" << restoreTimer.nsecsElapsed() / 1000 << "us";
+        }
+        if (!d->enableCheckpoints(checkpointPath)) {
+            qDebug() << "Could not write checkpoint" << checkpointPath;
+        }
+    }
+    d->core().setTelemetry(&telemetry, telemetry.addSeries());
+    if (!shmName.isEmpty()) share(1);
+    if (shared) d->core().setSharedState(shared.get(), shared->claim());
     MainWindow w(d);
+
+    // record a tester's inputs, or replay a recording and report how fast each one showed up
+    InputRecorder recorder(&w);
+    int recordArg = a.arguments().indexOf("--record");
+    int replayArg = a.arguments().indexOf("--replay");
+    if (recordArg >= 0) {
+        QString recordPath = a.arguments().value(recordArg + 1, "oasis-inputs.tsv");
+        recorder.startRecording();
+        QObject::connect(&a, &QCoreApplication::aboutToQuit, [&recorder, recordPath]() { recorder.save(recordPath); });
+    } else if (replayArg >= 0) {
+        if (!recorder.load(a.arguments().value(replayArg + 1))) {
+            qDebug() << "Could not read input recording" << a.arguments().value(replayArg + 1);
+            return 1;
+        }
+        int reportArg = a.arguments().indexOf("--latency-report");
+        QString reportPath = reportArg >= 0 ? a.arguments().value(reportArg + 1) : QString();
+        QObject::connect(&recorder, &InputRecorder::replayFinished, [&recorder, reportPath]() {
+            QFile file(reportPath);
+            if (!reportPath.isEmpty() && file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+                file.write(recorder.report().toUtf8());
+            } else {
+                QTextStream(stdout) << recorder.report();
+            }
+            QCoreApplication::quit();
+        });
+        QTimer::singleShot(0, [&recorder]() { recorder.replay(); });
+    }
+
+    // external harnesses drive the same device as the window, from the device's thread
+    auto control = new ControlServer(d);
+
+    // the device runs its timers on its own thread, the window reads its published snapshots
+    QThread deviceThread;
+    d->moveToThread(&deviceThread);
+    control->moveToThread(&deviceThread);
+    QObject::connect(&deviceThread, &QThread::finished, control, &QObject::deleteLater);
+    QObject::connect(&deviceThread, &QThread::finished, d, &QObject::deleteLater);
+    deviceThread.start();
+
+    if (!historyPath.isEmpty()) {
+        QObject::connect(&a, &QCoreApplication::aboutToQuit, [d, historyPath]() {
+            QMetaObject::invokeMethod(d, "saveHistory", Qt::BlockingQueuedConnection, Q_ARG(QString, historyPath));
+        });
+    }
+
+    int controlArg = a.arguments().indexOf("--control");
+    if (controlArg >= 0) {
+        QMetaObject::invokeMethod(control, "listen", Q_ARG(QString, a.arguments().value(controlArg + 1, "oasis-pro")));
+    }
+
     w.show();
-    return a.exec();
+    int result = a.exec();
+    deviceThread.quit();
+    deviceThread.wait();
+    writeTrace();
+    return result;
 }
@@ -2,12 +2,20 @@
 
 #include "ui_mainwindow.h"
 
+#include <QDateTime>
+#include <QDockWidget>
+#include <QVBoxLayout>
+
 MainWindow::MainWindow(Device* d, QWidget* parent)
     : QMainWindow(parent), ui(new Ui::MainWindow) {
     ui->setupUi(this);
     this->setupGraph();
     this->device = d;
-    this->displayBatteryInfo();
+    this->view = d->core().readSnapshot();
+    this->shownBatteryAnimations = this->view.batteryAnimations;
+    this->therapyLines = d->getTherapySummaries();  // before the device thread starts
+    this->shownValid = false;
+    this->setupHistory();
 
     // Icons
     this->ui->intUpButton->setIcon(style.standardIcon(QStyle::SP_ArrowUp));
@@ -15,37 +23,41 @@ MainWindow::MainWindow(Device* d, QWidget* parent)
     this->ui->checkMarkButton->setIcon(style.standardIcon(QStyle::SP_DialogApplyButton));
     this->ui->checkMarkButton->setIconSize(QSize(40, 40));
 
-    // observe
-    connect(d, SIGNAL(deviceUpdated()), this, SLOT(updateDisplay()));
+    // observe, the device may run on another thread so these are queued and only carry values
+    connect(d, SIGNAL(deviceUpdated()), this, SLOT(deviceChanged()));
+    connect(d, SIGNAL(therapiesChanged(QStringList)), this, SLOT(setRecordedTherapies(QStringList)));
     connect(d, SIGNAL(connectionTest(bool)), this, SLOT(updateWavelengthBlinker(bool)));
     connect(d, SIGNAL(safeVoltage(bool)), this, SLOT(setScrollGraph(bool)));
 
-    this->scrollGraphTimer.setInterval(500);
-    connect(&this->scrollGraphTimer, SIGNAL(timeout()), this, SLOT(scrollGraph()));
-
-    // session timer timer
-    this->sessionTimerChecker.setInterval(1000);
-    connect(&this->sessionTimerChecker, SIGNAL(timeout()), this, SLOT(displaySessionTime()));
+    // animations
+    connect(&this->animations, &AnimationClock::frame, this, &MainWindow::renderAnimations);
+    connect(&this->animations, &AnimationClock::finished, this, &MainWindow::animationFinished);
 
     // setup ui
-    connect(ui->powerButton, SIGNAL(pressed()), this->device, SLOT(PowerButtonPressed()));
-    connect(ui->powerButton, SIGNAL(released()), this->device, SLOT(PowerButtonReleased()));
-    connect(ui->intArrowButtonGroup, SIGNAL(buttonClicked(QAbstractButton*)), this->device, SLOT(INTArrowButtonClicked(QAbstractButton*)));
-    connect(ui->checkMarkButton, SIGNAL(pressed()), this->device, SLOT(StartSessionButtonClicked()));
-    connect(ui->batteryLevelSlider, SIGNAL(valueChanged(int)), this->device, SLOT(SetBattery(int)));
-    connect(ui->replaceBatteryButton, SIGNAL(pressed()), this->device, SLOT(ResetBattery()));
-    connect(ui->connectionStrengthSlider, SIGNAL(valueChanged(int)), this->device, SLOT(SetConnectionStatus(int)));
-
-    connect(ui->usernameInput, SIGNAL(textEdited(QString)), this->device, SLOT(UsernameInputted(QString)));
-    connect(ui->recordTherapyButton, SIGNAL(pressed()), this->device, SLOT(RecordButtonClicked()));
-    connect(ui->replayTherapyButton, SIGNAL(pressed()), this->device, SLOT(ReplayButtonClicked()));
-
-    clearDisplay();
+    // inputs are queued on the device as typed events, no signal per input crosses the thread
+    Device *dev = this->device;
+    connect(ui->powerButton, &QAbstractButton::pressed, this, [dev]() { dev->post(DeviceInput::PowerPress); });
+    connect(ui->powerButton, &QAbstractButton::released, this, [dev]() { dev->post(DeviceInput::PowerRelease); });
+    connect(ui->intArrowButtonGroup, SIGNAL(buttonClicked(QAbstractButton*)), this, SLOT(intensityArrowClicked(QAbstractButton*)));
+    connect(ui->checkMarkButton, &QAbstractButton::pressed, this, [dev]() { dev->post(DeviceInput::StartSession); });
+    connect(ui->batteryLevelSlider, &QAbstractSlider::valueChanged, this, [dev](int value) { dev->post(DeviceInput::SetBattery, value); });
+    connect(ui->replaceBatteryButton, &QAbstractButton::pressed, this, [dev]() { dev->post(DeviceInput::ResetBattery); });
+    connect(ui->connectionStrengthSlider, &QAbstractSlider::valueChanged, this, [dev](int value) { dev->post(DeviceInput::SetConnection, value); });
+
+    connect(ui->usernameInput, &QLineEdit::textEdited, this, [dev](const QString &text) { dev->post(DeviceInput::Username, 0, text); });
+    connect(ui->recordTherapyButton, &QAbstractButton::pressed, this, [dev]() { dev->post(DeviceInput::Record); });
+    connect(ui->replayTherapyButton, &QAbstractButton::pressed, this, [dev]() { dev->post(DeviceInput::Replay); });
+
+    this->showSnapshot(this->view);
+
+    // a device resumed from a checkpoint can already be mid test or returning to safe voltage
+    if (this->view.state == State::TestingConnection) this->updateWavelengthBlinker(true);
+    if (this->view.returningToSafeVoltage) this->setScrollGraph(true);
 }
 
 /*
     Function: setupGraph
-    Purpose: Store graph widgets in an easily accessible vector
+    Purpose: Store graph, session group and session type widgets in easily accessible vectors
     Return: void
  */
 void MainWindow::setupGraph() {
@@ -55,454 +67,322 @@ void MainWindow::setupGraph() {
         graphLightName.append(QString::number(i));
         this->graph.append(gWidget->findChild<QLabel*>(graphLightName));
     }
+    for (int i = 0; i < this->ui->groupLayout->count() && i < GROUP_ICONS; ++i) {
+        this->groupIcons.append(this->ui->groupLayout->itemAt(i)->widget());
+    }
+    for (int i = 0; i < this->ui->typeLayout->count() && i < TYPE_ICONS; ++i) {
+        this->typeIcons.append(qobject_cast<QLabel*>(this->ui->typeLayout->itemAt(i)->widget()));
+    }
 }
 
-MainWindow::~MainWindow() {
-    delete device;
-    delete ui;
+/*
+    Function: setupHistory
+    Purpose: Dock the history chart under the device with a choice of range: this run, the
+             last hour or day, or one of the sessions so far
+    Return: void
+ */
+void MainWindow::setupHistory() {
+    this->historyChart = nullptr;
+    this->historyRange = nullptr;
+    this->runStartMs = QDateTime::currentMSecsSinceEpoch();
+    if (!device->core().getTelemetry()) return;
+
+    auto panel = new QWidget();
+    auto layout = new QVBoxLayout(panel);
+    this->historyRange = new QComboBox(panel);
+    this->historyRange->addItems({"This run", "Last hour", "Last 24 hours"});
+    this->historyChart = new HistoryChart(device->core().getTelemetry(), device->core().getTelemetrySeries(),
+                                          device->core().snapshot().maxIntensity, panel);
+    layout->addWidget(historyRange);
+    layout->addWidget(historyChart, 1);
+
+    auto dock = new QDockWidget("History", this);
+    dock->setWidget(panel);
+    addDockWidget(Qt::BottomDockWidgetArea, dock);
+
+    connect(historyRange, SIGNAL(currentIndexChanged(int)), this, SLOT(historyRangeChosen(int)));
+    connect(historyChart, SIGNAL(sessionsChanged(int)), this, SLOT(listHistorySessions(int)));
+    this->historyChart->follow(runStartMs);
 }
 
-// update ui elements based on state of device
-// observer pattern
-void MainWindow::updateDisplay() {
-    this->displayBatteryInfo();
-
-    auto state = device->getState();
-
-    this->ui->replayTherapyButton->setEnabled(state == State::ChoosingSession && device->getRecordedTherapies().count() > 0);
-    if (state == State::Off) {
-        stopAllTimers();
-        this->clearDisplay();
-        return;
-    } else if (state == State::TestingConnection) {
-        auto status = this->device->getConnectionStatus();
-        switch (status) {
-            case ConnectionStatus::No:
-                this->setGraph(7, 8, true, "red");
-                break;
-            case ConnectionStatus::Okay:
-                this->setGraph(4, 6, false, "yellow");
-                break;
-            case ConnectionStatus::Excellent:
-                this->setGraph(1, 3, false, "green");
-                break;
-        }
-    } else if (state == State::InSession) {
-        this->displaySessionTime();
-
-        if (!this->sessionTimerChecker.isActive())
-            this->sessionTimerChecker.start();
-        auto intensity = this->device->getIntensity();
-        // if the graph is animating then don't overwrite with intensity
-        if (!this->graphTimer.isActive())
-            this->setGraph(intensity, intensity, false, "green");
-    } else if (state == State::SoftOff) {
-        auto intensity = this->device->getIntensity();
-        this->setGraph(intensity, intensity, false, "green");
-    } else if (state == State::ChoosingSession) {
-        if (this->device->getSelectedSessionGroup() == 2) {  // User designed session
-            int selectedUserSession = this->device->getSelectedUserSession();
-            unHighlightSessionType();
-            if (!this->graphTimer.isActive()) {
-                this->setGraph(selectedUserSession + 1, selectedUserSession + 1, false, "green");  // Highlight graph
-            }
-        } else {
-            if (!this->graphTimer.isActive()) {
-                this->setGraph(0, 0);  // Reset graph when inactive
-            }
-        }
-    } else if (state == State::ChoosingRecordedTherapy) {
-        this->ui->treatmentHistoryList->setCurrentRow(device->getSelectedRecordedTherapy());
-    } else if (state == State::Paused) {
-        if (this->device->getDisconnected() && !this->device->getReturningToSafeVoltage()) {
-            this->setGraph(7, 8, true, "red");
-        }
+/*
+    Function: historyRangeChosen [Slot]
+    Purpose: Show the range picked in the history list, a session is shown with a little
+             either side of it
+    Inputs:
+        index: integer, entry of the list
+    Return: void
+ */
+void MainWindow::historyRangeChosen(int index) {
+    TRACE_SCOPE("MainWindow::historyRangeChosen");
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (index == 0) {
+        historyChart->follow(runStartMs);
+    } else if (index == 1) {
+        historyChart->follow(now - 3600 * 1000);
+    } else if (index == 2) {
+        historyChart->follow(now - TELEMETRY_DAY_MS);
+    } else if (index - 3 < (int)historyChart->getSessions().size()) {
+        const TelemetrySpan &session = historyChart->getSessions()[index - 3];
+        qint64 margin = (session.endMs - session.startMs) / 20 + 1000;
+        historyChart->showRange(session.startMs - margin, session.endMs + margin);
     }
-    auto wavelength = this->device->getActiveWavelength();
-    this->setWavelength(wavelength, false, "red");
-
-    setDeviceButtonsEnabled(state != State::Paused);
-    toggleLRChannels(this->device->getConnectionStatus() != ConnectionStatus::No);
-    this->ui->powerButton->setStyleSheet("border: 5px solid green;");
-    displayRecordedSessions();
-    highlightSession();
 }
 
-// handler to start/stop scroll animation of graph during connection lost
-void MainWindow::setScrollGraph(bool isStart) {
-    if (isStart) {
-        scrollGraphTimer.start();
-    } else {
-        scrollGraphTimer.stop();
+// one entry per session, the entries already there keep their place
+void MainWindow::listHistorySessions(int count) {
+    TRACE_SCOPE("MainWindow::listHistorySessions");
+    historyRange->blockSignals(true);
+    while (historyRange->count() > 3 + count) historyRange->removeItem(historyRange->count() - 1);
+    for (int i = historyRange->count() - 3; i < count; ++i) {
+        const TelemetrySpan &session = historyChart->getSessions()[i];
+        historyRange->addItem(QString("Session %1, %2").arg(i + 1).arg(QDateTime::fromMSecsSinceEpoch(session.startMs).toString("HH:mm:ss")));
     }
+    historyRange->blockSignals(false);
 }
 
-// handler to perform scroll animation of graph during connection lost
-void MainWindow::scrollGraph() {
-    static int currScrollNum = 1;
-    static bool upDir = true;
-    if (this->device->getDisconnected()) {
-        setGraph(currScrollNum, currScrollNum, false, "green");
-        if (upDir) {
-            ++currScrollNum;
-            if (currScrollNum == 8) {
-                upDir = false;
-            }
-        } else {
-            --currScrollNum;
-            if (currScrollNum == 1) {
-                upDir = true;
-            }
-        }
-    }
+// the device is owned by its thread, see main
+MainWindow::~MainWindow() {
+    delete ui;
 }
 
-// Stops all UI timers
-void MainWindow::stopAllTimers() {
-    graphTimer.stop();
-    wavelengthBlinkTimer.stop();
-    scrollGraphTimer.stop();
+/*
+    Function: deviceChanged [Slot]
+    Purpose: Handle a deviceUpdated from the device thread. Several queued updates can arrive
+             together, the display is only redrawn if a newer snapshot was published.
+    Return: void
+*/
+void MainWindow::deviceChanged() {
+    TRACE_SCOPE("MainWindow::deviceChanged");
+    DeviceSnapshot latest = this->device->core().readSnapshot();
+    if (latest.version == this->view.version) return;
+    this->updateDisplay();
 }
 
-// sets all ui elements back to default values
-void MainWindow::clearDisplay() {
-    this->ui->powerButton->setStyleSheet("");
-
-    // clear recorded therapy items
-    //    this->ui->treatmentHistoryList->clearSelection();
-    this->ui->treatmentHistoryList->clear();
-    this->ui->usernameInput->clear();
-
-    // turn off graph
-    this->setGraph(0, 0);
-
-    // turn off CES mode wavelengths
-    this->setWavelength("none");
-
-    // disable device buttons
-    setDeviceButtonsEnabled(false);
-
-    unHighlightSession();
+// forward the arrow as a typed input so the device never touches a widget
+void MainWindow::intensityArrowClicked(QAbstractButton* button) {
+    TRACE_SCOPE("MainWindow::intensityArrowClicked");
+    this->device->post(button == this->ui->intUpButton ? DeviceInput::IntensityUp : DeviceInput::IntensityDown);
+}
 
-    toggleLRChannels(false);
+// copy of the recorded therapy list, sent by the device whenever it grows
+void MainWindow::setRecordedTherapies(QStringList lines) {
+    TRACE_SCOPE("MainWindow::setRecordedTherapies");
+    this->therapyLines = lines;
+    this->showSnapshot(this->view);
 }
 
-// turns device buttons on/off
-void MainWindow::setDeviceButtonsEnabled(bool flag) {
-    this->ui->checkMarkButton->setEnabled(device->getState() == State::ChoosingSession || device->getState() == State::ChoosingRecordedTherapy);
-    this->ui->intUpButton->setEnabled(flag);
-    this->ui->intDownButton->setEnabled(flag);
+// update ui elements based on state of device
+// observer pattern
+void MainWindow::updateDisplay() {
+    this->showSnapshot(this->device->core().readSnapshot());
+}
 
-    auto state = device->getState();
-    if (state == State::InSession && this->device->getSelectedSessionGroup() != 2) {
-        this->ui->usernameInput->setEnabled(true);
-    } else {
-        this->ui->usernameInput->setEnabled(false);
-    }
-    this->toggleRecordButton();
+// the window's animations, the offscreen benchmark runs them on a manual clock
+AnimationClock &MainWindow::getAnimations() {
+    return this->animations;
 }
 
 /*
-    Function: displayBatteryInfo
-    Purpose: Set UI elements based on battery state. Show current percentage
-             and also show have the graph blink in the low battery states.
+    Function: showSnapshot
+    Purpose: Bring every widget in line with a device snapshot. Normally the device's latest,
+             the offscreen benchmark passes scripted ones to reach each state directly.
+    Inputs:
+        snapshot: DeviceSnapshot to display
     Return: void
- */
-void MainWindow::displayBatteryInfo() {
-    auto newBatteryLevel = (int)device->getBatteryLevel();
-    BatteryState newBatteryState = device->getBatteryState();
-
-    this->ui->batteryDisplay->display(newBatteryLevel);
-    this->ui->batteryLevelSlider->blockSignals(true);
-    this->ui->batteryLevelSlider->setValue(newBatteryLevel);
-    this->ui->batteryLevelSlider->blockSignals(false);
-
-    if (device->getRunBatteryAnimation()) {
-        if (newBatteryState == BatteryState::Low) {
-            qDebug() << "Battery Low";
-            this->setGraph(1, 2, true, "yellow");
-        } else if (newBatteryState == BatteryState::Critical) {
-            qDebug() << "Battery Critically Low";
-            this->setGraph(1, 1, true, "red");
-        }
-    }
-}
-
-// turns wavelength icons on/off.
-void MainWindow::setWavelength(QString wavelength, bool blink, QString colour) {
-    if (wavelength == "small" || wavelength == "big") {
-        QLabel *activeIcon, *inactiveIcon;
-        activeIcon = wavelength == "small" ? this->ui->cesSmallWaveIcon : this->ui->cesBigWaveIcon;
-        inactiveIcon = wavelength == "small" ? this->ui->cesBigWaveIcon : this->ui->cesSmallWaveIcon;
-
-        if (blink && !this->wavelengthBlinkTimer.isActive()) {
-            this->isWavelengthBlinkOn = true;
-            this->wavelengthBlinkTimer.setInterval(1000);
-            disconnect(&this->wavelengthBlinkTimer, &QTimer::timeout, 0, 0);
-            connect(&this->wavelengthBlinkTimer, &QTimer::timeout, this, [wavelength, this]() { this->wavelengthBlink(wavelength); });
-            this->wavelengthBlinkTimer.start();
-        } else {
-            activeIcon->setStyleSheet("color: " + colour + ";");
-            inactiveIcon->setStyleSheet("color: black;");
-        }
-    } else if (wavelength == "both") {
-        if (blink && !this->wavelengthBlinkTimer.isActive()) {
-            this->isWavelengthBlinkOn = true;
-            this->wavelengthBlinkTimer.setInterval(1000);
-            disconnect(&this->wavelengthBlinkTimer, &QTimer::timeout, 0, 0);
-            connect(&this->wavelengthBlinkTimer, &QTimer::timeout, this, [wavelength, this]() { this->wavelengthBlink(wavelength); });
-            this->wavelengthBlinkTimer.start();
-        } else {
-            this->ui->cesSmallWaveIcon->setStyleSheet("color: " + colour + ";");
-            this->ui->cesBigWaveIcon->setStyleSheet("color: " + colour + ";");
+*/
+void MainWindow::showSnapshot(const DeviceSnapshot &snapshot) {
+    TRACE_SCOPE("MainWindow::showSnapshot");
+    this->view = snapshot;
+
+    DisplayInputs in;
+    // each low/critical warning the device raised is animated once
+    in.batteryWarning = this->view.batteryAnimations != this->shownBatteryAnimations;
+    this->shownBatteryAnimations = this->view.batteryAnimations;
+    in.graphBlinking = this->animations.isActive(AnimationTrack::GraphBlink);
+    in.userTypeMask = 0;
+    if (this->view.state != State::Off && this->view.selectedSessionGroup == 2) {
+        for (SessionType *t : this->device->core().getUserSessionTypes(this->view.selectedUserSession)) {
+            for (int i = 0; i < this->typeIcons.size(); ++i) {
+                if (QString::fromStdString(t->name) == this->typeIcons.at(i)->text()) {
+                    in.userTypeMask |= 1 << i;
+                    break;
+                }
+            }
         }
-    } else {
-        this->ui->cesSmallWaveIcon->setStyleSheet("color: black;");
-        this->ui->cesBigWaveIcon->setStyleSheet("color: black;");
     }
-}
+    in.historyCount = this->therapyLines.length();
 
-// handler to perform blink animation of wavelength icon
-void MainWindow::wavelengthBlink(QString wavelength) {
-    if (isWavelengthBlinkOn) {
-        this->setWavelength(wavelength);
-    } else {
-        this->setWavelength(wavelength, false, "red");
-    }
+    DisplayEffects effects;
+    DisplayFrame next = composeFrame(this->view, this->shown, in, &effects);
 
-    isWavelengthBlinkOn = !isWavelengthBlinkOn;
-}
+    if (in.batteryWarning && this->view.batteryState == BatteryState::Low) qDebug() << "Battery Low";
+    if (in.batteryWarning && this->view.batteryState == BatteryState::Critical) qDebug() << "Battery Critically Low";
 
-// handler to start/stop blink animation of wavelength icons
-void MainWindow::updateWavelengthBlinker(bool isStart) {
-    if (isStart) {
-        auto wavelength = this->device->getActiveWavelength();
-        this->setWavelength(wavelength, true, "red");
-    } else {
-        this->wavelengthBlinkTimer.stop();
+    if (effects.stopAll) this->stopAllTimers();
+    if (effects.graphBlink < 0) {
+        this->animations.stop(AnimationTrack::GraphBlink);
+    } else if (effects.graphBlink > 0) {
+        // lights start on and toggle every second, the display refreshes after the fifth toggle
+        this->animations.start(AnimationTrack::GraphBlink, Animation::blink(1000, 5, effects.blinkLow, effects.blinkHigh, effects.blinkColour));
     }
-}
-
-// turns L/R icons on/off
-void MainWindow::toggleLRChannels(bool flag) {
-    if (flag) {
-        ui->cesLeftIcon->setStyleSheet("color: green;");
-        ui->cesRightIcon->setStyleSheet("color: green;");
-    } else {
-        ui->cesLeftIcon->setStyleSheet("color: black;");
-        ui->cesRightIcon->setStyleSheet("color: black;");
+    if (effects.countdown < 0) {
+        this->animations.stop(AnimationTrack::SessionCountdown);
+    } else if (effects.countdown > 0) {
+        this->animations.start(AnimationTrack::SessionCountdown, Animation::countdown(effects.countdownMs));
     }
-}
+    if (effects.clearUsername && !this->ui->usernameInput->text().isEmpty()) this->ui->usernameInput->clear();
 
-/*
-    Function: setGraph
-    Purpose: Set the graph to display as inputs request
-    Inputs:
-        start: integer, first light in range to light up
-        end: integer, second light in range to light up
-        blink: boolean, whether the range should blink
-        colour: QString, what colour the graph should display
-    Return: void
- */
-void MainWindow::setGraph(int start, int end, bool blink, QString colour) {
-    // stop the graph timer so that it doesn't reset changes
-    this->graphTimer.stop();
-    // set the lights
-    this->setGraphLights(start, end, colour);
-    if (blink) {
-        this->numGraphBlinks = 0;
-        this->isGraphBlinkOn = true;
-        // graph timer can be applied to more than just blinking so disconnect other slots
-        disconnect(&this->graphTimer, &QTimer::timeout, 0, 0);
-        // qt signal slot using lambda expression to run graphBlink with the specified values
-        connect(&this->graphTimer, &QTimer::timeout, this, [start, end, colour, this]() { this->graphBlink(start, end, colour); });
-        this->graphTimer.setInterval(1000);
-        this->graphTimer.start();
-    }
+    this->applyFrame(next);
+    emit this->displayUpdated();
 }
 
 /*
-    Function: setGraphLights
-    Purpose: Set the graph lights directly, used as a helper
+    Function: applyFrame
+    Purpose: Write a frame to the widgets, only the fields that differ from the frame on
+             screen are applied so an unchanged widget is never restyled or repainted
     Inputs:
-        start: integer, first light in range to light up
-        end: integer, second light in range to light up
-        colour: QString, what colour the graph should display
+        next: DisplayFrame to show
     Return: void
- */
-void MainWindow::setGraphLights(int start, int end, QString colour) {
-    for (int i = 1; i < 9; ++i) {
-        if (i >= start && i <= end) {
-            this->graph.at(i - 1)->setStyleSheet("background-color: " + colour + ";");
-        } else {
-            this->graph.at(i - 1)->setStyleSheet("background-color: black;");
-        }
+*/
+void MainWindow::applyFrame(const DisplayFrame &next) {
+    TRACE_SCOPE("MainWindow::applyFrame");
+    const DisplayFrame &old = this->shown;
+    bool all = !this->shownValid;
+    auto applyStyle = [all](QWidget *widget, const QString &was, const QString &now) {
+        if (widget && (all || was != now)) widget->setStyleSheet(now);
+    };
+    auto applyEnabled = [all](QWidget *widget, bool was, bool now) {
+        if (all || was != now) widget->setEnabled(now);
+    };
+    auto applySlider = [all](QAbstractSlider *slider, int was, int now) {
+        if (!all && was == now) return;
+        slider->blockSignals(true);
+        slider->setValue(now);
+        slider->blockSignals(false);
+    };
+
+    applyStyle(this->ui->powerButton, old.powerStyle, next.powerStyle);
+    if (all || old.batteryNumber != next.batteryNumber) this->ui->batteryDisplay->display(next.batteryNumber);
+    applySlider(this->ui->batteryLevelSlider, old.batterySlider, next.batterySlider);
+    applySlider(this->ui->connectionStrengthSlider, old.connectionSlider, next.connectionSlider);
+    if (all || old.therapyTime != next.therapyTime) this->ui->therapyTime->display(next.therapyTime);
+
+    for (int i = 0; i < GRAPH_LIGHTS && i < this->graph.size(); ++i) {
+        applyStyle(this->graph.at(i), old.graphStyles[i], next.graphStyles[i]);
     }
-}
-
-/*
-    Function: graphBlink
-    Purpose: cause the graph to blink on or off
-    Inputs:
-        start: integer, first light in range to light up
-        end: integer, second light in range to light up
-        colour: Qstring, what colour the graph should display
-    Return: void
- */
-void MainWindow::graphBlink(int start, int end, QString colour) {
-    // if on, turn off
-    if (this->isGraphBlinkOn) {
-        this->setGraphLights(0, 0);
+    applyStyle(this->ui->cesSmallWaveIcon, old.smallWaveStyle, next.smallWaveStyle);
+    applyStyle(this->ui->cesBigWaveIcon, old.bigWaveStyle, next.bigWaveStyle);
+    applyStyle(this->ui->cesLeftIcon, old.leftStyle, next.leftStyle);
+    applyStyle(this->ui->cesRightIcon, old.rightStyle, next.rightStyle);
+    for (int i = 0; i < this->groupIcons.size(); ++i) {
+        applyStyle(this->groupIcons.at(i), old.groupStyles[i], next.groupStyles[i]);
     }
-    // if off, turn on
-    else {
-        this->setGraphLights(start, end, colour);
+    for (int i = 0; i < this->typeIcons.size(); ++i) {
+        applyStyle(this->typeIcons.at(i), old.typeStyles[i], next.typeStyles[i]);
     }
 
-    this->isGraphBlinkOn = !this->isGraphBlinkOn;
-    this->numGraphBlinks++;
-    if (this->numGraphBlinks == 5) {
-        this->numGraphBlinks = 0;
-        // by default blink assumes the lights are on and should be turned off
-        this->isGraphBlinkOn = true;
-        this->graphTimer.stop();
-        this->updateDisplay();
+    applyEnabled(this->ui->checkMarkButton, old.checkEnabled, next.checkEnabled);
+    applyEnabled(this->ui->intUpButton, old.intUpEnabled, next.intUpEnabled);
+    applyEnabled(this->ui->intDownButton, old.intDownEnabled, next.intDownEnabled);
+    applyEnabled(this->ui->usernameInput, old.usernameEnabled, next.usernameEnabled);
+    applyEnabled(this->ui->recordTherapyButton, old.recordEnabled, next.recordEnabled);
+    applyEnabled(this->ui->replayTherapyButton, old.replayEnabled, next.replayEnabled);
+
+    // the list is rebuilt when therapies are recorded and cleared on power off
+    bool listRebuilt = all || old.historyCount != next.historyCount;
+    if (listRebuilt) {
+        this->ui->treatmentHistoryList->clear();
+        for (int i = 0; i < next.historyCount && i < this->therapyLines.length(); ++i) {
+            QListWidgetItem* item = new QListWidgetItem;
+            item->setText(this->therapyLines[i]);
+            item->setData(Qt::UserRole, QString::number(i));
+            this->ui->treatmentHistoryList->addItem(item);
+        }
+    }
+    if ((listRebuilt || old.historyRow != next.historyRow) && next.historyRow >= 0) {
+        this->ui->treatmentHistoryList->setCurrentRow(next.historyRow);
     }
+
+    this->shown = next;
+    this->shownValid = true;
 }
 
-/*
- * Function: toggleRecordButton
- * Purpose: Function for enabling/disabling the "Record Therapy" button on the UI.
- * Input: N/A
- * Return: N/A
- */
-void MainWindow::toggleRecordButton() {
-    // Record Button only visible when there is valid text in the username input box and when device is in a session
-    auto toggleRecord = device->getToggleRecord();
-    if (device->getState() == State::InSession) {
-        this->ui->recordTherapyButton->setEnabled(toggleRecord);
+// handler to start/stop scroll animation of graph during connection lost
+void MainWindow::setScrollGraph(bool isStart) {
+    TRACE_SCOPE("MainWindow::setScrollGraph");
+    if (isStart) {
+        this->animations.start(AnimationTrack::GraphScroll, Animation::scroll(500, 1, GRAPH_LIGHTS));
     } else {
-        // If device not in session state then ever show the record therapy button
-        this->ui->recordTherapyButton->setEnabled(false);
+        this->animations.stop(AnimationTrack::GraphScroll);
     }
 }
 
 /*
- * Function: displayRecordedSessions
- * Purpose: Function for updating the UI with the list of recorded therapies/treatments
- * Input: N/A
- * Return: N/A
+    Function: renderAnimations [Slot]
+    Purpose: Draw the tracks the animation clock reports as changed this frame
+    Inputs:
+        dirtyTracks: integer, bit mask of AnimationTrack values
+    Return: void
  */
-void MainWindow::displayRecordedSessions() {
-    // only update treatment list when necessary
-    if (device->getRecordedTherapies().length() > this->ui->treatmentHistoryList->count()) {
-        ui->treatmentHistoryList->clear();
-
-        int widgetLength = ui->treatmentHistoryList->count();
-        auto list = device->getRecordedTherapies();
-        for (int i = 0; i < list.length(); ++i) {
-            QListWidgetItem* item = new QListWidgetItem;
-            item->setText(list[i]->username + " | " + list[i]->group.name + " | " + list[i]->type.name + " | " + QString::number(list[i]->intensity));
-            item->setData(Qt::UserRole, QString::number(i));
-            ui->treatmentHistoryList->addItem(item);
+void MainWindow::renderAnimations(int dirtyTracks) {
+    TRACE_SCOPE("MainWindow::renderAnimations");
+    auto changed = [this, dirtyTracks](AnimationTrack track) {
+        return (dirtyTracks & (1 << (int)track)) && this->animations.isActive(track);
+    };
+
+    DisplayFrame next = this->shown;
+    if (changed(AnimationTrack::GraphBlink)) {
+        const Animation &blink = this->animations.animation(AnimationTrack::GraphBlink);
+        if (this->animations.value(AnimationTrack::GraphBlink)) {
+            setGraphLights(next, blink.low, blink.high, blink.colour);
+        } else {
+            setGraphLights(next, 0, 0);
         }
     }
-}
-
-/*
- * Function: highlightSession
- * Purpose: Function for highlighting the selected session group and session type icons on the UI.
- * Input: N/A
- * Return: N/A
- */
-void MainWindow::highlightSession() {
-    unHighlightSession();
-    auto currSessionType = this->device->getSelectedSessionType();
-    auto currSessionGroup = this->device->getSelectedSessionGroup();
-
-    // Highlighting for selected sessiong group
-    auto sessionGroupParent = this->ui->groupLayout;
-    sessionGroupParent->itemAt(currSessionGroup)->widget()->setStyleSheet("background-color: green;");
-
-    if (this->device->getSelectedSessionGroup() != 2) {
-        // Highlighting for selected sessiong type
-        auto sessionTypeParent = this->ui->typeLayout;
-        sessionTypeParent->itemAt(currSessionType)->widget()->setStyleSheet("background-color: green;");
-    } else {
-        highlightUserSessionTypes(this->device->getUserSessionTypes());
+    // scrolling during connection lost takes over the graph from any blink
+    if (changed(AnimationTrack::GraphScroll) && this->view.disconnected) {
+        int currScrollNum = this->animations.value(AnimationTrack::GraphScroll);
+        this->animations.stop(AnimationTrack::GraphBlink);
+        setGraphLights(next, currScrollNum, currScrollNum, "green");
     }
-}
-
-// Highlight the corresponding session types for a session group
-void MainWindow::highlightUserSessionTypes(QVector<SessionType*> types) {
-    // Widget containing types
-    auto sessionTypeParent = this->ui->typeLayout;
-
-    // Loop through the user designed session group's session types
-    for (SessionType* t : types) {
-        for (int i = 0; i < sessionTypeParent->count(); i++) {
-            auto currUiType = qobject_cast<QLabel*>(sessionTypeParent->itemAt(i)->widget());
-
-            // Highlight the UI type(s) matching the parameter
-            if (QString::compare(t->name, currUiType->text()) == 0) {
-                currUiType->setStyleSheet("background-color: green;");
-                break;
-            }
+    if (changed(AnimationTrack::WavelengthBlink)) {
+        const Animation &blink = this->animations.animation(AnimationTrack::WavelengthBlink);
+        if (this->animations.value(AnimationTrack::WavelengthBlink)) {
+            setWaveStyles(next, blink.target, blink.colour);
+        } else {
+            setWaveStyles(next, blink.target);
         }
     }
+    if (changed(AnimationTrack::SessionCountdown)) {
+        next.therapyTime = this->animations.value(AnimationTrack::SessionCountdown);
+    }
+    this->applyFrame(next);
 }
 
-/*
- * Function: unHighlightSession
- * Purpose: Function for unhighlighting the selected session group and session type icons on the UI.
- * Input: N/A
- * Return: N/A
- */
-void MainWindow::unHighlightSession() {
-    unHighlightSessionGroup();
-    unHighlightSessionType();
-}
-
-/*
- * Function: unHighlightSessionGroup
- * Purpose: Function for unhighlighting all the session group icons on the UI
- * Input: N/A
- * Return: N/A
- */
-void MainWindow::unHighlightSessionGroup() {
-    // Highlighting for selected sessiong group
-    auto sessionGroupParent = this->ui->groupLayout;
-    for (int i = 0; i < sessionGroupParent->count(); ++i) {
-        sessionGroupParent->itemAt(i)->widget()->setStyleSheet("");
+// handler for animations that ran all their steps
+void MainWindow::animationFinished(AnimationTrack track) {
+    TRACE_SCOPE("MainWindow::animationFinished");
+    if (track == AnimationTrack::GraphBlink) {
+        this->showSnapshot(this->view);
+    } else if (track == AnimationTrack::SessionCountdown) {
+        DisplayFrame next = this->shown;
+        next.therapyTime = 0;
+        this->applyFrame(next);
     }
 }
 
-/*
- * Function: unHighlightSessionGroup
- * Purpose: Function for unhighlighting all the session type icons on the UI
- * Input: N/A
- * Return: N/A
- */
-void MainWindow::unHighlightSessionType() {
-    // Highlighting for selected sessiong group
-    auto sessionTypeParent = this->ui->typeLayout;
-    for (int i = 0; i < sessionTypeParent->count(); ++i) {
-        sessionTypeParent->itemAt(i)->widget()->setStyleSheet("");
-    }
+// Stops all UI animations
+void MainWindow::stopAllTimers() {
+    this->animations.stopAll();
 }
 
-/*
-    Function: displaySessionTime
-    Purpose: Display the current amount of time left in the session
-    Return: void
- */
-void MainWindow::displaySessionTime() {
-    int remainingTime = this->device->getRemainingSessionTime();
-    qDebug() << "Session time remaining: " << remainingTime;
-    if (remainingTime <= 0) {
-        this->sessionTimerChecker.stop();
-        this->ui->therapyTime->display(0);
-        return;
+// handler to start/stop blink animation of wavelength icons
+void MainWindow::updateWavelengthBlinker(bool isStart) {
+    TRACE_SCOPE("MainWindow::updateWavelengthBlinker");
+    if (!isStart) {
+        this->animations.stop(AnimationTrack::WavelengthBlink);
+    } else if (!this->animations.isActive(AnimationTrack::WavelengthBlink)) {
+        this->animations.start(AnimationTrack::WavelengthBlink, Animation::blink(1000, -1, 0, 0, "red", waveName(this->view.wavelength)));
     }
-    this->ui->therapyTime->display(remainingTime / 1000);
 }
@@ -2,11 +2,16 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QAbstractButton>
 #include <QVector>
 #include <QTimer>
 #include <QLabel>
 #include <QCommonStyle>
+#include <QComboBox>
 #include "device.h"
+#include "animator.h"
+#include "displayframe.h"
+#include "historychart.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui
@@ -23,46 +28,48 @@ public:
     MainWindow(Device *, QWidget *parent = nullptr);
     ~MainWindow();
 
+    void showSnapshot(const DeviceSnapshot &);
+    AnimationClock &getAnimations();
+
 private:
     Ui::MainWindow *ui;
     Device *device;
+    DeviceSnapshot view;          // device state as of the last published snapshot
+    QStringList therapyLines;     // recorded therapies as sent by the device
+    int shownBatteryAnimations;   // battery warnings already animated
     QVector<QLabel *> graph;
-    QTimer graphTimer;
-    QTimer wavelengthBlinkTimer;
-    QTimer sessionTimerChecker;
-    QTimer scrollGraphTimer;
+    QVector<QWidget *> groupIcons;
+    QVector<QLabel *> typeIcons;
+    DisplayFrame shown;           // what the widgets currently show
+    bool shownValid;              // false until the first frame is applied in full
+    AnimationClock animations; // the window's only timer, drives every blink/scroll/countdown
 
     QCommonStyle style;
-    int numGraphBlinks;
-    bool isGraphBlinkOn;
-    bool isWavelengthBlinkOn;
+
+    // battery, intensity and connection history from the device's telemetry, if it has any
+    HistoryChart *historyChart;
+    QComboBox *historyRange;
+    qint64 runStartMs;
 
     void setupGraph();
+    void setupHistory();
     void stopAllTimers();
-    void clearDisplay();
-    void displayBatteryInfo();
-    void setGraph(int, int, bool = false, QString = "black");
-    void setGraphLights(int, int, QString = "black");
-    void graphBlink(int, int, QString = "black");
-    void setDeviceButtonsEnabled(bool);
-    void setWavelength(QString, bool = false, QString = "black");
-    void wavelengthBlink(QString);
-    void toggleRecordButton();
-    void displayRecordedSessions();
-    void highlightSession();
-    void highlightUserSessionTypes(QVector<SessionType*>);
-    void unHighlightSession();
-    void unHighlightSessionGroup();
-    void unHighlightSessionType();
-    void toggleLRChannels(bool);
-
+    void applyFrame(const DisplayFrame &);
 
 private slots:
+    void deviceChanged();
     void updateDisplay();
+    void intensityArrowClicked(QAbstractButton*);
+    void setRecordedTherapies(QStringList);
     void updateWavelengthBlinker(bool);
-    void displaySessionTime();
     void setScrollGraph(bool);
-    void scrollGraph();
+    void renderAnimations(int);
+    void animationFinished(AnimationTrack);
+    void historyRangeChosen(int);
+    void listHistorySessions(int);
+
+signals:
+    void displayUpdated(); // end of every updateDisplay, used to measure input latency
 
 };
 #endif // MAINWINDOW_H
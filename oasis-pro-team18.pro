@@ -1,9 +1,7 @@
-QT       += core gui
+QT       += core gui network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
-CONFIG += c++11
-
 # The following define makes your compiler emit warnings if you use
 # any Qt feature that has been marked deprecated (the exact warnings
 # depend on your compiler). Please consult the documentation of the
@@ -15,15 +13,35 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# the Qt-free device core and engine, also built on its own by devicecore.pro
+include(devicecore.pri)
+
+# the Qt side: the device adapter, the windows and the tools
 SOURCES += \
+    animator.cpp \
+    controlserver.cpp \
+    dashboard.cpp \
     device.cpp \
+    displayframe.cpp \
+    guibench.cpp \
+    historychart.cpp \
+    inputrecorder.cpp \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    tools.cpp
 
 HEADERS += \
-    defs.h \
+    animator.h \
+    controlprotocol.h \
+    controlserver.h \
+    dashboard.h \
     device.h \
-    mainwindow.h
+    displayframe.h \
+    guibench.h \
+    historychart.h \
+    inputrecorder.h \
+    mainwindow.h \
+    tools.h
 
 FORMS += \
     mainwindow.ui
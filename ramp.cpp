@@ -0,0 +1,146 @@
+#include "ramp.h"
+
+#include <algorithm>
+#include <cmath>
+
+// chords an exponential ramp is cut into at most
+static const long long MAX_CHORDS = 4096;
+
+// a profile with the default shape settings, change the fields for the rest
+RampProfile rampProfile(RampShape shape, double from, double to, long long durationUs) {
+    RampProfile profile;
+    profile.shape = shape;
+    profile.from = from;
+    profile.to = to;
+    profile.durationUs = durationUs;
+    profile.steps = 0;
+    profile.sharpness = RAMP_SHARPNESS;
+    return profile;
+}
+
+Ramp::Ramp() : shape(rampProfile(RampShape::Linear, 0, 0, 0)) {}
+
+/*
+    Function: Ramp
+    Purpose: Compile a profile. Linear and stepwise ramps are exact, an exponential ramp is cut
+             into just enough equal chords to stay within RAMP_TOLERANCE of the curve.
+    Inputs:
+        profile: RampProfile to compile
+*/
+Ramp::Ramp(const RampProfile &profile) : shape(profile) {
+    long long total = profile.durationUs;
+    double change = profile.to - profile.from;
+    addPoint(0, profile.from);
+
+    if (total <= 0) {
+        addPoint(0, profile.to);
+    } else if (profile.shape == RampShape::Linear) {
+        addPoint(total, profile.to);
+    } else if (profile.shape == RampShape::Stepwise) {
+        long long n = profile.steps > 0 ? profile.steps : std::max(1L, std::lround(std::fabs(change)));
+        double level = profile.from;
+        for (long long k = 1; k <= n; ++k) {
+            long long at = total * k / n;
+            addPoint(at, level);
+            level = k == n ? profile.to : profile.from + change * k / n;
+            addPoint(at, level);
+        }
+    } else {
+        // level = to + change' * (e^(-k t/T) - e^(-k)) / (1 - e^(-k)), scaled to end exactly on to
+        double k = profile.sharpness > 0 ? profile.sharpness : RAMP_SHARPNESS;
+        double tail = std::exp(-k);
+        auto level = [&profile, k, tail, total](long long us) {
+            return profile.to + (profile.from - profile.to) * (std::exp(-k * us / total) - tail) / (1 - tail);
+        };
+        // a chord of width h strays at most h^2 / 8 times the steepest curvature, found at the start
+        double curvature = std::fabs(change) * (k / total) * (k / total) / (1 - tail);
+        long long n = 1;
+        if (curvature > 0) n = (long long)std::ceil(total / std::sqrt(8 * RAMP_TOLERANCE / curvature));
+        n = std::max(1LL, std::min(n, std::min(MAX_CHORDS, total)));
+        for (long long i = 1; i < n; ++i) addPoint(total * i / n, level(total * i / n));
+        addPoint(total, profile.to);
+    }
+    findSteps();
+}
+
+void Ramp::addPoint(long long us, double level) {
+    path.push_back(RampPoint{us, level});
+}
+
+// walk the path once and note where the rounded level changes, to the microsecond
+void Ramp::findSteps() {
+    long current = std::lround(path.front().level);
+    for (size_t i = 1; i < path.size(); ++i) {
+        const RampPoint &a = path[i - 1];
+        const RampPoint &b = path[i];
+        long target = std::lround(b.level);
+        if (a.us == b.us) {
+            if (target != current) steps.push_back(RampPoint{b.us, (double)target});
+            current = target;
+            continue;
+        }
+        while (current != target) {
+            int direction = target > current ? 1 : -1;
+            double boundary = current + 0.5 * direction;
+            double t = a.us + (boundary - a.level) / (b.level - a.level) * (b.us - a.us);
+            long long us = std::min(b.us, std::max(a.us, (long long)std::ceil(t)));
+            current += direction;
+            if (!steps.empty() && steps.back().us == us) {
+                steps.back().level = current;
+            } else {
+                steps.push_back(RampPoint{us, (double)current});
+            }
+        }
+    }
+}
+
+const RampProfile &Ramp::profile() const {
+    return shape;
+}
+
+bool Ramp::empty() const {
+    return path.empty();
+}
+
+long long Ramp::duration() const {
+    return path.empty() ? 0 : path.back().us;
+}
+
+size_t Ramp::size() const {
+    return path.size();
+}
+
+const std::vector<RampPoint> &Ramp::changes() const {
+    return steps;
+}
+
+static bool before(long long us, const RampPoint &point) {
+    return us < point.us;
+}
+
+/*
+    Function: levelAt
+    Purpose: Level of the ramp at a time, interpolated between the points either side
+    Inputs:
+        us: long long, microseconds since the ramp started
+    Return: double, level
+*/
+double Ramp::levelAt(long long us) const {
+    if (path.empty()) return 0;
+    auto next = std::upper_bound(path.begin(), path.end(), us, before);
+    if (next == path.begin()) return path.front().level;
+    auto last = next - 1;
+    if (next == path.end()) return last->level;
+    return last->level + (next->level - last->level) * (double)(us - last->us) / (double)(next->us - last->us);
+}
+
+int Ramp::stepAt(long long us) const {
+    auto next = std::upper_bound(steps.begin(), steps.end(), us, before);
+    if (next == steps.begin()) return path.empty() ? 0 : (int)std::lround(path.front().level);
+    return (int)(next - 1)->level;
+}
+
+long long Ramp::nextStepUs(long long us) const {
+    auto next = std::upper_bound(steps.begin(), steps.end(), us, before);
+    return next == steps.end() ? duration() : next->us;
+}
@@ -0,0 +1,69 @@
+#ifndef RAMP_H
+#define RAMP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class RampShape : uint8_t {Linear, Exponential, Stepwise};
+
+const double RAMP_SHARPNESS = 4;      // time constants an exponential ramp covers by default
+const double RAMP_TOLERANCE = 0.01;   // furthest an exponential ramp's chords stray from the curve, in levels
+
+/*
+    Struct: RampProfile
+    Purpose: How a level moves from one value to another. A linear ramp moves evenly, an
+             exponential one moves quickly at first and settles onto the end value, a stepwise
+             one holds each level and jumps at equal intervals, the last jump landing on the
+             end value at the end of the ramp.
+ */
+struct RampProfile {
+    RampShape shape;
+    double from;
+    double to;
+    long long durationUs;
+    int steps;         // stepwise: number of jumps, 0 for one per whole level
+    double sharpness;  // exponential: time constants over the duration
+};
+
+RampProfile rampProfile(RampShape, double from, double to, long long durationUs);
+
+// a point of a compiled ramp, two points at one time are a jump
+struct RampPoint {
+    long long us;
+    double level;
+};
+
+/*
+    Class: Ramp
+    Purpose: A ramp profile compiled once into a piecewise linear path and the times its
+             whole level changes. The level at any microsecond is a binary search and one
+             interpolation, so a device can sleep until the next whole level change instead
+             of ticking, and a waveform can scale every sample by the exact level.
+ */
+class Ramp
+{
+public:
+    Ramp();
+    explicit Ramp(const RampProfile &);
+
+    const RampProfile &profile() const;
+    bool empty() const;
+    long long duration() const;
+    size_t size() const;                        // points on the path
+    const std::vector<RampPoint> &changes() const;
+
+    double levelAt(long long us) const;         // from before the start, to after the end
+    int stepAt(long long us) const;             // level rounded to a whole level
+    long long nextStepUs(long long us) const;   // next whole level change, duration() if none is left
+
+private:
+    RampProfile shape;
+    std::vector<RampPoint> path;
+    std::vector<RampPoint> steps;  // whole level changes in time order
+
+    void addPoint(long long us, double level);
+    void findSteps();
+};
+
+#endif // RAMP_H
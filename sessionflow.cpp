@@ -0,0 +1,283 @@
+#include "sessionflow.h"
+
+#include <algorithm>
+#include <exception>
+#include <new>
+
+size_t FlowTask::frameBytes = 0;
+
+void FlowTask::promise_type::unhandled_exception() {
+    std::terminate();
+}
+
+void *FlowTask::promise_type::operator new(size_t bytes) {
+    FlowTask::frameBytes = bytes;
+    return ::operator new(bytes);
+}
+
+void FlowTask::promise_type::operator delete(void *frame, size_t) {
+    ::operator delete(frame);
+}
+
+FlowScheduler::FlowScheduler(const LifecycleConfig &config, size_t capacity) : stats(), ramps(config), clock(0), running(0) {
+    sessions.reserve(capacity);
+    timers.reserve(capacity);
+}
+
+// heap order of the timers, earliest deadline on top
+bool FlowScheduler::after(const Timer &a, const Timer &b) {
+    return a.deadline > b.deadline;
+}
+
+// flows still waiting are destroyed with their frames
+FlowScheduler::~FlowScheduler() {
+    for (FlowSession &s : sessions) {
+        if (s.handle) s.handle.destroy();
+    }
+}
+
+uint32_t FlowScheduler::add(bool connected) {
+    FlowSession s = {};
+    s.phase = LifecyclePhase::Testing;
+    s.connected = connected;
+    sessions.push_back(s);
+    return (uint32_t)(sessions.size() - 1);
+}
+
+// the flow runs up to its first wait straight away
+void FlowScheduler::start(uint32_t id, FlowTask task) {
+    sessions[id].handle = task.handle;
+    running++;
+    resume(id, Wake::Timer);
+}
+
+/*
+    Function: setConnected
+    Purpose: Deliver a connection change, a flow waiting for it resumes on the next runUntil
+             unless the connection changes back before then
+    Inputs:
+        id: session
+        connected: bool, electrodes in contact
+    Return: void
+*/
+void FlowScheduler::setConnected(uint32_t id, bool connected) {
+    FlowSession &s = sessions[id];
+    if (s.connected == connected) return;
+    s.connected = connected;
+    if (s.waitConnection == (connected ? 1 : 2)) ready.push_back(id);
+}
+
+/*
+    Function: post
+    Purpose: Deliver an input to a session in progress, it resumes on the next runUntil
+    Inputs:
+        id: session
+        input: FlowInput
+    Return: false if the flow takes no input now or one is still waiting to be taken
+*/
+bool FlowScheduler::post(uint32_t id, FlowInput input) {
+    FlowSession &s = sessions[id];
+    if (!s.waitInput || s.input != FlowInput::None || input == FlowInput::None) return false;
+    s.input = input;
+    ready.push_back(id);
+    return true;
+}
+
+FlowInput FlowScheduler::takeInput(uint32_t id) {
+    FlowInput input = sessions[id].input;
+    sessions[id].input = FlowInput::None;
+    return input;
+}
+
+void FlowScheduler::resume(uint32_t id, Wake wake) {
+    FlowSession &s = sessions[id];
+    s.wake = wake;
+    stats.resumes++;
+    std::coroutine_handle<> handle = s.handle;
+    handle.resume();
+    if (handle.done()) {
+        handle.destroy();
+        sessions[id].handle = nullptr;
+        running--;
+    }
+}
+
+/*
+    Function: runUntil
+    Purpose: Advance the clock to ms, resuming every flow whose event arrived or whose timer
+             expired, in deadline order
+    Inputs:
+        ms: integer, simulated time to run to
+    Return: void
+*/
+void FlowScheduler::runUntil(int64_t ms) {
+    for (;;) {
+        while (!ready.empty()) {
+            std::vector<uint32_t> woken;
+            woken.swap(ready);
+            for (uint32_t id : woken) {
+                // the wait may have ended or the connection changed back since the entry was queued
+                FlowSession &s = sessions[id];
+                Wake wake;
+                if (!s.handle) continue;
+                if (s.waitInput && s.input != FlowInput::None) {
+                    wake = Wake::Input;
+                } else if (s.waitConnection && s.connected == (s.waitConnection == 1)) {
+                    wake = Wake::Connection;
+                } else {
+                    continue;
+                }
+                s.waitConnection = 0;
+                s.waitInput = false;
+                s.generation++;  // drops the timer it was racing
+                resume(id, wake);
+            }
+        }
+        if (timers.empty() || timers.front().deadline > ms) break;
+        std::pop_heap(timers.begin(), timers.end(), after);
+        Timer timer = timers.back();
+        timers.pop_back();
+        FlowSession &s = sessions[timer.session];
+        if (timer.generation != s.generation || !s.handle) continue;  // woken by its event first
+        clock = timer.deadline;
+        s.waitConnection = 0;
+        s.waitInput = false;
+        s.generation++;
+        resume(timer.session, Wake::Timer);
+    }
+    clock = std::max(clock, ms);
+}
+
+// a connection wait already satisfied does not suspend
+bool FlowScheduler::Awaiter::await_ready() {
+    FlowSession &s = scheduler->sessions[id];
+    if (connection && s.connected == (connection == 1)) {
+        s.wake = Wake::Connection;
+        return true;
+    }
+    s.wake = Wake::Timer;
+    return delayMs == 0;
+}
+
+void FlowScheduler::Awaiter::await_suspend(std::coroutine_handle<>) {
+    FlowSession &s = scheduler->sessions[id];
+    s.generation++;
+    s.waitConnection = connection;
+    s.waitInput = inputs;
+    if (delayMs >= 0) {
+        scheduler->timers.push_back(Timer{scheduler->clock + delayMs, id, s.generation});
+        std::push_heap(scheduler->timers.begin(), scheduler->timers.end(), after);
+    }
+}
+
+// the flow's clock in us, what its lifecycle's ramps run on
+static long long nowUs(const FlowScheduler &scheduler) {
+    return scheduler.now() * 1000;
+}
+
+// copy the lifecycle's phase and level into the session, where the scheduler's callers read them
+static void publish(FlowScheduler &scheduler, uint32_t id, const SessionLifecycle &lifecycle) {
+    scheduler.session(id).phase = lifecycle.phase();
+    scheduler.session(id).intensity = (int8_t)lifecycle.level();
+}
+
+/*
+    Function: runSessionFlow
+    Purpose: Drive a SessionLifecycle, the one DeviceCore drives from its timers, as one
+             coroutine so a single thread can run hundreds of thousands of sessions. The flow
+             only keeps time: it waits for the connection test, the program's segments and
+             ramp steps, the intensity arrows and a power click, a disconnect and the safe
+             voltage delay, and hands each to the lifecycle. flow-check runs it beside a core
+             to check the two keep the same time.
+    Inputs:
+        scheduler: FlowScheduler running the flow
+        id: session it drives
+        program: SessionTimeline of the session, shared between flows
+        intensity: integer, level the session starts at
+    Return: FlowTask
+*/
+FlowTask runSessionFlow(FlowScheduler &scheduler, uint32_t id, const SessionTimeline &program, int intensity) {
+    const LifecycleConfig &config = scheduler.config();
+    SessionLifecycle lifecycle(scheduler.rampTable());
+    lifecycle.setLevel(intensity);
+
+    // show the connection for a while, then wait for contact before starting
+    lifecycle.testConnection();
+    publish(scheduler, id, lifecycle);
+    co_await scheduler.sleep(id, config.testConnectionMs);
+    co_await scheduler.connection(id, true);
+
+    lifecycle.applyProgram(program, 0);
+    lifecycle.start(nowUs(scheduler));
+    publish(scheduler, id, lifecycle);
+
+    long long segmentEnd = program.nextChangeMs(0);
+    long long left = program.duration();
+    int64_t safeDeadline = 0;  // a reconnect does not restart the safe voltage delay, as on the device
+    while (left > 0) {
+        // run to the next segment, ramp step or the end unless an input or a disconnect comes first
+        long long elapsed = program.duration() - left;
+        int64_t wait = std::min(segmentEnd, program.duration()) - elapsed;
+        int64_t rampWait = lifecycle.rampWaitMs(nowUs(scheduler));
+        if (rampWait >= 0) wait = std::min(wait, rampWait);
+        int64_t started = scheduler.now();
+        Wake wake = co_await scheduler.timerOrConnection(id, wait, false, true);
+        left -= scheduler.now() - started;
+        elapsed = program.duration() - left;
+
+        if (wake == Wake::Timer) {
+            if (left <= 0) break;
+            if (elapsed >= segmentEnd) {
+                lifecycle.applyProgram(program, elapsed);
+                segmentEnd = program.nextChangeMs(elapsed);
+            }
+            lifecycle.stepRamp(nowUs(scheduler));
+            publish(scheduler, id, lifecycle);
+            continue;
+        }
+
+        if (wake == Wake::Input) {
+            FlowInput input = scheduler.takeInput(id);
+            if (input == FlowInput::Power) break;
+            lifecycle.arrow(input == FlowInput::IntensityUp ? 1 : -1);
+            publish(scheduler, id, lifecycle);
+            continue;
+        }
+
+        // paused, the clock stops until the connection comes back
+        scheduler.stats.pauses++;
+        lifecycle.pause();
+        publish(scheduler, id, lifecycle);
+        if (safeDeadline <= scheduler.now()) safeDeadline = scheduler.now() + config.safeVoltageDelayMs;
+        if (co_await scheduler.timerOrConnection(id, safeDeadline - scheduler.now(), true) == Wake::Timer) {
+            // down the safe voltage ramp, a reconnect keeps the level it reached
+            scheduler.stats.safeVoltages++;
+            lifecycle.returnToSafeVoltage(nowUs(scheduler));
+            publish(scheduler, id, lifecycle);
+            for (;;) {
+                rampWait = lifecycle.rampWaitMs(nowUs(scheduler));
+                if (rampWait > 0 && co_await scheduler.timerOrConnection(id, rampWait, true) == Wake::Connection) break;
+                if (lifecycle.stepRamp(nowUs(scheduler)) == SafeVoltageRamp) {
+                    publish(scheduler, id, lifecycle);
+                    co_await scheduler.connection(id, true);
+                    break;
+                }
+                publish(scheduler, id, lifecycle);
+            }
+        }
+        lifecycle.resume();
+        publish(scheduler, id, lifecycle);
+    }
+
+    // soft off down the soft off ramp until the output is off
+    lifecycle.softOff(nowUs(scheduler));
+    publish(scheduler, id, lifecycle);
+    for (;;) {
+        int64_t rampWait = lifecycle.rampWaitMs(nowUs(scheduler));
+        if (rampWait > 0) co_await scheduler.sleep(id, rampWait);
+        if (lifecycle.stepRamp(nowUs(scheduler)) == SoftOffRamp) break;
+        publish(scheduler, id, lifecycle);
+    }
+    publish(scheduler, id, lifecycle);
+    scheduler.stats.completed++;
+}
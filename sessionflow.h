@@ -0,0 +1,124 @@
+#ifndef SESSIONFLOW_H
+#define SESSIONFLOW_H
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sessionlifecycle.h"
+#include "timeline.h"
+
+// why a waiting flow was resumed
+enum class Wake : uint8_t {Timer, Connection, Input};
+
+// inputs a session in progress takes, a power click starts the soft off
+enum class FlowInput : uint8_t {None, IntensityUp, IntensityDown, Power};
+
+/*
+    Struct: FlowTask
+    Purpose: Coroutine type of a session flow. It starts suspended, the scheduler resumes it
+             and destroys the frame once the flow returns.
+ */
+struct FlowTask {
+    struct promise_type {
+        FlowTask get_return_object() { return FlowTask{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception();
+        static void *operator new(size_t);
+        static void operator delete(void *, size_t);
+    };
+    std::coroutine_handle<promise_type> handle;
+
+    static size_t frameBytes; // size of the last frame allocated, for the memory report
+};
+
+// per session state, kept small as there can be hundreds of thousands
+struct FlowSession {
+    std::coroutine_handle<> handle;
+    uint32_t generation;  // bumped by every wait and wake so stale timers are skipped
+    LifecyclePhase phase; // the flow's lifecycle as of its last transition
+    Wake wake;
+    uint8_t waitConnection;  // 0 not waiting, 1 for a connection, 2 for a disconnect
+    bool waitInput;
+    FlowInput input;         // posted and not yet taken
+    bool connected;
+    int8_t intensity;
+};
+
+struct FlowStats {
+    long long completed;
+    long long pauses;
+    long long safeVoltages;
+    long long resumes;  // coroutine resumptions, timer and event
+};
+
+/*
+    Class: FlowScheduler
+    Purpose: Runs session flows on one thread against a simulated millisecond clock. Timers sit
+             in one binary heap shared by every session, connection changes and inputs resume
+             the flows waiting on them. A wait can race a timer against a connection change or
+             an input, whichever comes first resumes the flow and the others are dropped. Ramps
+             are compiled once per use and levels and shared by every flow.
+ */
+class FlowScheduler {
+public:
+    explicit FlowScheduler(const LifecycleConfig &, size_t capacity = 0);
+    ~FlowScheduler();
+    FlowScheduler(const FlowScheduler &) = delete;
+    FlowScheduler &operator=(const FlowScheduler &) = delete;
+
+    // a session is added first so its flow can be created knowing its id
+    uint32_t add(bool connected);
+    void start(uint32_t id, FlowTask);
+    FlowSession &session(uint32_t id) { return sessions[id]; }
+    size_t size() const { return sessions.size(); }
+    size_t active() const { return running; }
+    int64_t now() const { return clock; }
+    const LifecycleConfig &config() const { return ramps.config(); }
+    RampTable &rampTable() { return ramps; }
+    FlowStats stats;
+
+    void setConnected(uint32_t id, bool);
+    bool post(uint32_t id, FlowInput);
+    FlowInput takeInput(uint32_t id);
+    void runUntil(int64_t ms);
+
+    struct Awaiter {
+        FlowScheduler *scheduler;
+        uint32_t id;
+        int64_t delayMs;   // -1 waits on the connection only
+        uint8_t connection; // 0 waits on the timer only
+        bool inputs;
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<>);
+        Wake await_resume() { return scheduler->sessions[id].wake; }
+    };
+    Awaiter sleep(uint32_t id, int64_t ms) { return Awaiter{this, id, ms, 0, false}; }
+    Awaiter connection(uint32_t id, bool connected) { return Awaiter{this, id, -1, (uint8_t)(connected ? 1 : 2), false}; }
+    Awaiter timerOrConnection(uint32_t id, int64_t ms, bool connected, bool inputs = false) {
+        return Awaiter{this, id, ms, (uint8_t)(connected ? 1 : 2), inputs};
+    }
+
+private:
+    struct Timer {
+        int64_t deadline;
+        uint32_t session;
+        uint32_t generation;
+    };
+    std::vector<FlowSession> sessions;
+    std::vector<Timer> timers;
+    std::vector<uint32_t> ready;
+    RampTable ramps;
+    int64_t clock;
+    size_t running;
+
+    void resume(uint32_t id, Wake);
+    static bool after(const Timer &, const Timer &);
+};
+
+FlowTask runSessionFlow(FlowScheduler &, uint32_t id, const SessionTimeline &program, int intensity);
+
+#endif // SESSIONFLOW_H
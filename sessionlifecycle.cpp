@@ -0,0 +1,221 @@
+#include "sessionlifecycle.h"
+
+#include <algorithm>
+
+/*
+    Function: lifecycleRamp
+    Purpose: Profile of a session start, soft off or safe voltage ramp
+    Inputs:
+        use: RampUse the ramp is for
+        shape: RampShape configured for that use
+        from / to: integer intensities at the start and the end
+        ms: integer, length of the whole ramp
+    Return: RampProfile
+*/
+RampProfile lifecycleRamp(RampUse use, RampShape shape, int from, int to, int ms) {
+    RampProfile profile = rampProfile(shape, from, to, (long long)ms * 1000);
+    if (use == SoftOffRamp) profile.steps = std::max(from - to, 1);  // one level per step however long a step is
+    return profile;
+}
+
+LifecycleConfig defaultLifecycleConfig() {
+    LifecycleConfig config = {1, 8, TEST_CONNECTION_MS, SAFE_VOLTAGE_DELAY_MS,
+                              {RampShape::Linear, RampShape::Stepwise, RampShape::Linear},
+                              {SESSION_START_RAMP_MS, SOFT_OFF_STEP_MS, SAFE_VOLTAGE_MS}};
+    return config;
+}
+
+RampTable::RampTable(const LifecycleConfig &config) : settings(config) {
+    size_t levels = (size_t)std::max(settings.maxIntensity, 0) + 1;
+    ramps.resize(NoRamp * levels * levels);
+    compiled.resize(ramps.size(), 0);
+}
+
+// change a use's shape and length, its ramps are compiled again the next time they start
+void RampTable::configure(RampUse use, RampShape shape, int ms) {
+    if (use == NoRamp) return;
+    settings.rampShapes[use] = shape;
+    settings.rampMs[use] = std::max(ms, 0);
+    size_t levels = (size_t)std::max(settings.maxIntensity, 0) + 1;
+    std::fill(compiled.begin() + use * levels * levels, compiled.begin() + (use + 1) * levels * levels, 0);
+}
+
+/*
+    Function: get
+    Purpose: The ramp of a use between two levels, compiled the first time it is asked for
+    Inputs:
+        use: RampUse
+        from / to: integer intensities, clamped to 0 and the maximum
+    Return: Ramp, valid as long as the table
+*/
+const Ramp &RampTable::get(RampUse use, int from, int to) {
+    int top = std::max(settings.maxIntensity, 0);
+    from = std::max(0, std::min(from, top));
+    to = std::max(0, std::min(to, top));
+    size_t index = ((size_t)use * (top + 1) + from) * (top + 1) + to;
+    if (!compiled[index]) {
+        int ms = use == SoftOffRamp ? std::max(from, 1) * settings.rampMs[use] : settings.rampMs[use];
+        ramps[index] = Ramp(lifecycleRamp(use, settings.rampShapes[use], from, to, ms));
+        compiled[index] = 1;
+    }
+    return ramps[index];
+}
+
+SessionLifecycle::SessionLifecycle(RampTable &ramps) : table(&ramps),
+                                                       active(nullptr),
+                                                       rampStartedUs(0),
+                                                       running(NoRamp),
+                                                       current(LifecyclePhase::Done),
+                                                       intensity(0) {}
+
+// the ramp in progress, an empty one when none is
+const Ramp &SessionLifecycle::ramp() const {
+    static const Ramp none;
+    return active ? *active : none;
+}
+
+long long SessionLifecycle::rampLeftUs(long long nowUs) const {
+    return active ? std::max(0LL, active->duration() - (nowUs - rampStartedUs)) : 0;
+}
+
+// whole ms until the ramp's next level change or its end, -1 with no ramp
+int64_t SessionLifecycle::rampWaitMs(long long nowUs) const {
+    if (!active) return -1;
+    long long elapsed = nowUs - rampStartedUs;
+    long long left = active->nextStepUs(elapsed) - elapsed;
+    return left > 0 ? (left + 999) / 1000 : 0;
+}
+
+// the level picked before a session starts
+void SessionLifecycle::setLevel(int level) {
+    this->intensity = level;
+}
+
+// put a session back in a phase at a level, with no ramp running
+void SessionLifecycle::restore(LifecyclePhase phase, int level) {
+    stopRamp();
+    this->current = phase;
+    this->intensity = level;
+}
+
+void SessionLifecycle::testConnection() {
+    this->current = LifecyclePhase::Testing;
+}
+
+/*
+    Function: applyProgram
+    Purpose: Move the level to what the program asks for at a time into the session. A level
+             the program changes ends the start ramp, the program's own ramp takes over.
+    Inputs:
+        program: SessionTimeline of the session
+        elapsedMs: long long, time into the session
+    Return: void
+*/
+void SessionLifecycle::applyProgram(const SessionTimeline &program, long long elapsedMs) {
+    const LifecycleConfig &config = table->config();
+    int level = program.intensityAt(elapsedMs, this->intensity);
+    if (level >= config.minIntensity && level <= config.maxIntensity) {
+        if (level != this->intensity && running == StartRamp) stopRamp();
+        this->intensity = level;
+    }
+}
+
+// the session starts, its output brought up from zero to the level the program starts at
+void SessionLifecycle::start(long long nowUs) {
+    this->current = LifecyclePhase::InSession;
+    if (intensity >= 1 && table->config().rampMs[StartRamp] > 0) startRamp(StartRamp, 0, intensity, nowUs);
+}
+
+/*
+    Function: arrow
+    Purpose: An intensity arrow clicked during a session, a level picked during the start ramp
+             sticks
+    Inputs:
+        direction: integer, 1 for up and -1 for down
+    Return: true if the level changed
+*/
+bool SessionLifecycle::arrow(int direction) {
+    if (current != LifecyclePhase::InSession) return false;
+    if (running == StartRamp) stopRamp();
+    const LifecycleConfig &config = table->config();
+    int level = intensity + direction;
+    if (level < config.minIntensity || level > config.maxIntensity) return false;
+    this->intensity = level;
+    return true;
+}
+
+// the session stops where it is, a start ramp in progress ends at the level it reached
+void SessionLifecycle::pause() {
+    if (current == LifecyclePhase::Paused || current == LifecyclePhase::SafeVoltage) return;
+    if (running == StartRamp) stopRamp();
+    this->current = LifecyclePhase::Paused;
+}
+
+// a paused session brings its output down to safe voltage, false if it is not paused
+bool SessionLifecycle::returnToSafeVoltage(long long nowUs) {
+    if (current != LifecyclePhase::Paused) return false;
+    this->current = LifecyclePhase::SafeVoltage;
+    startRamp(SafeVoltageRamp, intensity, 0, nowUs);
+    return true;
+}
+
+// the session carries on, the output stays where a return to safe voltage had brought it
+void SessionLifecycle::resume() {
+    if (running == SafeVoltageRamp) stopRamp();
+    this->current = LifecyclePhase::InSession;
+}
+
+void SessionLifecycle::softOff(long long nowUs) {
+    this->current = LifecyclePhase::SoftOff;
+    startRamp(SoftOffRamp, intensity, 0, nowUs);
+}
+
+// run a ramp the caller compiled and keeps, such as what was left of one before a restart
+void SessionLifecycle::runRamp(RampUse use, const Ramp &ramp, long long nowUs) {
+    this->active = &ramp;
+    this->running = use;
+    this->rampStartedUs = nowUs;
+    this->intensity = ramp.stepAt(0);
+}
+
+/*
+    Function: stepRamp
+    Purpose: Move the level along the ramp in progress. A soft off ends the session and a
+             return to safe voltage leaves it paused with the output off.
+    Inputs:
+        nowUs: long long, caller's clock
+    Return: RampUse of the ramp that just ended, NoRamp while it still runs or with no ramp
+*/
+RampUse SessionLifecycle::stepRamp(long long nowUs) {
+    if (!active) return NoRamp;
+    long long elapsed = nowUs - rampStartedUs;
+    this->intensity = std::max(0, std::min(table->config().maxIntensity, active->stepAt(elapsed)));
+    if (elapsed < active->duration()) return NoRamp;
+
+    RampUse finished = running;
+    stopRamp();
+    if (finished == SoftOffRamp) {
+        this->current = LifecyclePhase::Done;
+        this->intensity = 0;
+    } else if (finished == SafeVoltageRamp) {
+        this->current = LifecyclePhase::Paused;
+        this->intensity = 0;
+    }
+    return finished;
+}
+
+// the session is over or the device is off
+void SessionLifecycle::end() {
+    stopRamp();
+    this->current = LifecyclePhase::Done;
+    this->intensity = 0;
+}
+
+void SessionLifecycle::startRamp(RampUse use, int from, int to, long long nowUs) {
+    runRamp(use, table->get(use, from, to), nowUs);
+}
+
+void SessionLifecycle::stopRamp() {
+    this->active = nullptr;
+    this->running = NoRamp;
+}
@@ -0,0 +1,101 @@
+#ifndef SESSIONLIFECYCLE_H
+#define SESSIONLIFECYCLE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "lifecycle.h"
+#include "ramp.h"
+#include "timeline.h"
+
+// the ramp a lifecycle ramp runs, a soft off always takes one step per level
+RampProfile lifecycleRamp(RampUse, RampShape, int from, int to, int ms);
+
+/*
+    Struct: LifecycleConfig
+    Purpose: Lifecycle settings of a device: its intensity bounds, the test and safe voltage
+             delays, and the shape and length of each of its ramps, rampMs per level for the
+             soft off. DeviceCore::lifecycleConfig reads them off a core.
+ */
+struct LifecycleConfig {
+    int minIntensity;
+    int maxIntensity;
+    int testConnectionMs;
+    int safeVoltageDelayMs;
+    RampShape rampShapes[NoRamp];
+    int rampMs[NoRamp];
+};
+
+// the settings of a standard device with its default ramps
+LifecycleConfig defaultLifecycleConfig();
+
+enum class LifecyclePhase : uint8_t {Testing, InSession, Paused, SafeVoltage, SoftOff, Done};
+
+/*
+    Class: RampTable
+    Purpose: The lifecycle ramps of one configuration, compiled the first time a ramp between
+             two levels is asked for and kept, so every session of a device or a swarm shares
+             them. A soft off lasts its per level time for every level it drops.
+ */
+class RampTable {
+public:
+    explicit RampTable(const LifecycleConfig &);
+    RampTable(const RampTable &) = delete;
+    RampTable &operator=(const RampTable &) = delete;
+
+    const LifecycleConfig &config() const { return settings; }
+    void configure(RampUse, RampShape, int ms);
+    const Ramp &get(RampUse, int from, int to);
+
+private:
+    LifecycleConfig settings;
+    std::vector<Ramp> ramps;       // by use, from and to level
+    std::vector<uint8_t> compiled;
+};
+
+/*
+    Class: SessionLifecycle
+    Purpose: The session lifecycle's transitions: the connection test, the start ramp, the
+             program's levels, the intensity arrows, pausing, the safe voltage ramp and the
+             soft off. DeviceCore drives one from its timers and each coroutine flow drives
+             one from its waits, so both run the same rules. The caller keeps the time, it
+             passes its clock in us and sleeps rampWaitMs before the next stepRamp.
+ */
+class SessionLifecycle {
+public:
+    explicit SessionLifecycle(RampTable &);
+
+    LifecyclePhase phase() const { return current; }
+    int level() const { return intensity; }
+    RampUse rampUse() const { return running; }
+    const Ramp &ramp() const;
+    long long rampLeftUs(long long nowUs) const;
+    int64_t rampWaitMs(long long nowUs) const;
+
+    void setLevel(int);
+    void restore(LifecyclePhase, int level);
+    void testConnection();
+    void applyProgram(const SessionTimeline &, long long elapsedMs);
+    void start(long long nowUs);
+    bool arrow(int direction);
+    void pause();
+    bool returnToSafeVoltage(long long nowUs);
+    void resume();
+    void softOff(long long nowUs);
+    void runRamp(RampUse, const Ramp &, long long nowUs);
+    RampUse stepRamp(long long nowUs);
+    void end();
+
+private:
+    RampTable *table;
+    const Ramp *active;       // the ramp in progress, owned by the table or the caller
+    long long rampStartedUs;
+    RampUse running;
+    LifecyclePhase current;
+    int intensity;
+
+    void startRamp(RampUse, int from, int to, long long nowUs);
+    void stopRamp();
+};
+
+#endif // SESSIONLIFECYCLE_H
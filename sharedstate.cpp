@@ -0,0 +1,162 @@
+#include "sharedstate.h"
+
+#include <chrono>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SHARED_STATE_POSIX 1
+#endif
+
+// other processes read the same words, which only works if the atomics are plain memory
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "shared state needs address free atomics");
+
+// the header takes a whole cache line so the first slot starts on one
+static const size_t HEADER_BYTES = 64;
+static_assert(sizeof(SharedStateHeader) <= HEADER_BYTES, "shared state header outgrew its line");
+
+SharedStateTable::SharedStateTable(void *b, size_t n, const std::string &segment, bool creator) :
+    base(b),
+    bytes(n),
+    name(segment),
+    owner(creator),
+    head(static_cast<SharedStateHeader *>(b)),
+    entries(reinterpret_cast<Slot *>(static_cast<char *>(b) + HEADER_BYTES)) {}
+
+SharedStateTable::~SharedStateTable() {
+#ifdef SHARED_STATE_POSIX
+    munmap(base, bytes);
+    if (owner) shm_unlink(name.c_str());
+#endif
+}
+
+// shm_open wants a single leading slash
+std::string SharedStateTable::segmentName(const std::string &name) {
+    return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+size_t SharedStateTable::segmentBytes(uint32_t capacity) {
+    return HEADER_BYTES + (size_t)capacity * sizeof(Slot);
+}
+
+/*
+    Function: create
+    Purpose: Create the segment, replacing one a crashed run left behind, and lay out the header
+             and empty slots
+    Inputs:
+        name: string, segment name, a leading slash is added if missing
+        capacity: unsigned integer, most devices it will hold
+    Return: SharedStateTable, owned by the caller, or nullptr if the segment could not be made
+*/
+SharedStateTable *SharedStateTable::create(const std::string &name, uint32_t capacity) {
+#ifdef SHARED_STATE_POSIX
+    std::string segment = segmentName(name);
+    size_t bytes = segmentBytes(capacity);
+    shm_unlink(segment.c_str());
+    int fd = shm_open(segment.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) return nullptr;
+    if (ftruncate(fd, (off_t)bytes) != 0) {
+        close(fd);
+        shm_unlink(segment.c_str());
+        return nullptr;
+    }
+    void *base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        shm_unlink(segment.c_str());
+        return nullptr;
+    }
+
+    SharedStateTable *table = new SharedStateTable(base, bytes, segment, true);
+    for (uint32_t i = 0; i < capacity; ++i) new (&table->entries[i]) Slot();
+    SharedStateHeader *head = new (base) SharedStateHeader();
+    head->layout = SHARED_STATE_LAYOUT;
+    head->slotBytes = sizeof(Slot);
+    head->capacity = capacity;
+    head->devices.store(0, std::memory_order_relaxed);
+    head->writerPid = (int32_t)getpid();
+    head->createdMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    // the magic goes in last, a reader that sees it sees a laid out segment
+    std::atomic_thread_fence(std::memory_order_release);
+    head->magic = SHARED_STATE_MAGIC;
+    return table;
+#else
+    (void)name;
+    (void)capacity;
+    return nullptr;
+#endif
+}
+
+/*
+    Function: open
+    Purpose: Map an existing segment read only, checking it was written with this layout
+    Inputs:
+        name: string, segment name given to create
+    Return: SharedStateTable, owned by the caller, or nullptr if there is no usable segment
+*/
+SharedStateTable *SharedStateTable::open(const std::string &name) {
+#ifdef SHARED_STATE_POSIX
+    std::string segment = segmentName(name);
+    int fd = shm_open(segment.c_str(), O_RDONLY, 0);
+    if (fd < 0) return nullptr;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < HEADER_BYTES) {
+        close(fd);
+        return nullptr;
+    }
+    size_t bytes = (size_t)info.st_size;
+    void *base = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return nullptr;
+
+    const SharedStateHeader *head = static_cast<const SharedStateHeader *>(base);
+    bool valid = head->magic == SHARED_STATE_MAGIC && head->layout == SHARED_STATE_LAYOUT
+              && head->slotBytes == sizeof(Slot) && segmentBytes(head->capacity) <= bytes;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!valid) {
+        munmap(base, bytes);
+        return nullptr;
+    }
+    return new SharedStateTable(base, bytes, segment, false);
+#else
+    (void)name;
+    return nullptr;
+#endif
+}
+
+int32_t SharedStateTable::claim() {
+    uint32_t slot = head->devices.fetch_add(1, std::memory_order_acq_rel);
+    return slot < head->capacity ? (int32_t)slot : -1;  // devices() stops counting at the capacity
+}
+
+// single writer per slot, the device that claimed it
+void SharedStateTable::publish(uint32_t slot, const SharedDeviceState &state) {
+    entries[slot].value.store(state);
+}
+
+SharedDeviceState SharedStateTable::read(uint32_t slot) const {
+    return entries[slot].value.load();
+}
+
+// cheaper than a read when a poller only wants to know whether anything changed
+uint32_t SharedStateTable::version(uint32_t slot) const {
+    return entries[slot].value.version();
+}
+
+uint32_t SharedStateTable::devices() const {
+    uint32_t claimed = head->devices.load(std::memory_order_acquire);
+    return claimed < head->capacity ? claimed : head->capacity;
+}
+
+uint32_t SharedStateTable::capacity() const {
+    return head->capacity;
+}
+
+const SharedStateHeader &SharedStateTable::header() const {
+    return *head;
+}
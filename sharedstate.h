@@ -0,0 +1,96 @@
+#ifndef SHAREDSTATE_H
+#define SHAREDSTATE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "seqlock.h"
+
+const uint32_t SHARED_STATE_MAGIC = 0x4d53534f;  // "OSSM"
+const uint32_t SHARED_STATE_LAYOUT = 2;          // bumped whenever SharedDeviceState changes
+
+// flag bits, the same as the control protocol's GetFlags
+const uint32_t SHARED_TOGGLE_RECORD = 1;
+const uint32_t SHARED_DISCONNECTED = 2;
+const uint32_t SHARED_SAFE_VOLTAGE = 4;
+
+// what a monitor sees of one device, fixed width fields so any process can read it
+struct SharedDeviceState {
+    int32_t state;
+    int32_t batteryState;
+    int32_t connectionStatus;
+    int32_t wavelength;
+    double batteryLevel;
+    int32_t intensity;
+    int32_t remainingSessionTime;  // ms
+    int32_t selectedSessionGroup;
+    int32_t selectedSessionType;
+    int32_t selectedUserSession;
+    int32_t therapyCount;
+    int32_t batteryAnimations;
+    uint32_t flags;
+    uint32_t version;              // publishes so far
+    uint32_t sessionsStarted;
+    uint32_t safeVoltageReturns;
+    int32_t maxIntensity;          // top intensity level of the device's hardware
+    int64_t publishedMs;           // wall clock
+};
+
+// start of the segment, followed by capacity slots
+struct SharedStateHeader {
+    uint32_t magic;
+    uint32_t layout;
+    uint32_t slotBytes;
+    uint32_t capacity;
+    std::atomic<uint32_t> devices;  // slots claimed so far
+    int32_t writerPid;
+    int64_t createdMs;
+};
+
+/*
+    Class: SharedStateTable
+    Purpose: A named POSIX shared memory segment holding one seqlocked SharedDeviceState per
+             device. The process running the devices creates it and each device publishes into
+             its own slot, a store of a few cache lines that never waits for a reader. Monitors
+             in other processes map it read only and poll whichever slots they like, retrying a
+             slot only if it changed while they read it. Slots are cache line aligned so devices
+             publishing from different threads don't share lines.
+ */
+class SharedStateTable
+{
+public:
+    static SharedStateTable *create(const std::string &name, uint32_t capacity);  // nullptr on failure
+    static SharedStateTable *open(const std::string &name);                       // read only
+    ~SharedStateTable();  // unmaps, the creator also removes the name
+    SharedStateTable(const SharedStateTable &) = delete;
+    SharedStateTable &operator=(const SharedStateTable &) = delete;
+
+    int32_t claim();  // slot for a new device, -1 when full
+    void publish(uint32_t slot, const SharedDeviceState &);
+    SharedDeviceState read(uint32_t slot) const;
+    uint32_t version(uint32_t slot) const;
+
+    uint32_t devices() const;
+    uint32_t capacity() const;
+    const SharedStateHeader &header() const;
+
+private:
+    struct alignas(64) Slot {
+        SeqLock<SharedDeviceState> value;
+    };
+
+    SharedStateTable(void *base, size_t bytes, const std::string &name, bool owner);
+    static std::string segmentName(const std::string &);
+    static size_t segmentBytes(uint32_t capacity);
+
+    void *base;
+    size_t bytes;
+    std::string name;
+    bool owner;
+    SharedStateHeader *head;
+    Slot *entries;
+};
+
+#endif // SHAREDSTATE_H
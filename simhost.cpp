@@ -0,0 +1,93 @@
+#include "simhost.h"
+
+SimHost::SimHost(int64_t wallStart) : updates(0),
+                                      timersFired(0),
+                                      safeVoltageReturns(0),
+                                      core(nullptr),
+                                      fire(nullptr),
+                                      drain(nullptr),
+                                      nowUs(0),
+                                      wallStartMs(wallStart),
+                                      drainPending(false) {
+    for (Timer &timer : timers) timer = Timer{false, 0, 0};
+}
+
+/*
+    Function: advance
+    Purpose: Move the clock on, firing each timer at the moment it falls due. A timer started
+             by another one's handler fires in the same advance if it falls due in it.
+    Inputs:
+        ms: long long, simulated time to run
+    Return: void
+*/
+void SimHost::advance(long long ms) {
+    if (drainPending && core) {
+        drainPending = false;
+        drain(core);
+    }
+    long long endUs = nowUs + ms * 1000;
+    while (core) {
+        int next = -1;
+        for (int i = 0; i < CORE_TIMERS; ++i) {
+            if (timers[i].active && timers[i].dueUs <= endUs && (next < 0 || timers[i].dueUs < timers[next].dueUs)) next = i;
+        }
+        if (next < 0) break;
+        Timer &timer = timers[next];
+        this->nowUs = timer.dueUs;
+        if (coreTimerRepeats((CoreTimer)next)) {
+            timer.dueUs += (timer.intervalMs > 0 ? timer.intervalMs : 1) * 1000LL;
+        } else {
+            timer.active = false;
+        }
+        this->timersFired++;
+        fire(core, (CoreTimer)next);
+    }
+    this->nowUs = endUs;
+}
+
+long long SimHost::nowMs() const {
+    return nowUs / 1000;
+}
+
+void SimHost::startTimer(CoreTimer id, int ms) {
+    timers[id] = Timer{true, ms, nowUs + (ms > 0 ? ms : 0) * 1000LL};
+}
+
+void SimHost::stopTimer(CoreTimer id) {
+    timers[id].active = false;
+}
+
+bool SimHost::timerActive(CoreTimer id) const {
+    return timers[id].active;
+}
+
+// rounded up, like QTimer a timer due this very moment has 0 left
+int SimHost::remainingTime(CoreTimer id) const {
+    if (!timers[id].active) return -1;
+    long long left = timers[id].dueUs - nowUs;
+    return left > 0 ? (int)((left + 999) / 1000) : 0;
+}
+
+long long SimHost::elapsedUs() const {
+    return nowUs;
+}
+
+int64_t SimHost::wallClockMs() const {
+    return wallStartMs + nowUs / 1000;
+}
+
+void SimHost::wake() {
+    this->drainPending = true;
+}
+
+void SimHost::updated() {
+    this->updates++;
+}
+
+void SimHost::therapiesRecorded() {}
+
+void SimHost::connectionTesting(bool) {}
+
+void SimHost::safeVoltageReturn(bool returning) {
+    if (returning) this->safeVoltageReturns++;
+}
@@ -0,0 +1,64 @@
+#ifndef SIMHOST_H
+#define SIMHOST_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "devicecore.h"
+
+/*
+    Class: SimHost
+    Purpose: Runs a device core of any revision on a simulated clock with no event loop. advance moves the
+             clock on and fires every timer that falls due on the way, in time order, so hours
+             of device time take as long as the work the device does in them. Inputs posted to
+             the core are drained at the start of each advance.
+ */
+class SimHost : public DeviceHost
+{
+public:
+    explicit SimHost(int64_t wallStartMs = 0);
+
+    // the core this host runs, it must be constructed with this host
+    template <class Hardware>
+    void attach(BasicDeviceCore<Hardware> *device) {
+        this->core = device;
+        this->fire = [](void *c, CoreTimer timer) { static_cast<BasicDeviceCore<Hardware> *>(c)->onTimer(timer); };
+        this->drain = [](void *c) { static_cast<BasicDeviceCore<Hardware> *>(c)->drainInputs(); };
+    }
+    void advance(long long ms);
+    long long nowMs() const;
+
+    void startTimer(CoreTimer, int ms) override;
+    void stopTimer(CoreTimer) override;
+    bool timerActive(CoreTimer) const override;
+    int remainingTime(CoreTimer) const override;
+    long long elapsedUs() const override;
+    int64_t wallClockMs() const override;
+    void wake() override;
+    void updated() override;
+    void therapiesRecorded() override;
+    void connectionTesting(bool) override;
+    void safeVoltageReturn(bool) override;
+
+    // what the core told its host so far
+    size_t updates;
+    size_t timersFired;
+    size_t safeVoltageReturns;
+
+private:
+    struct Timer {
+        bool active;
+        int intervalMs;
+        long long dueUs;
+    };
+
+    void *core;
+    void (*fire)(void *, CoreTimer);
+    void (*drain)(void *);
+    long long nowUs;
+    int64_t wallStartMs;
+    bool drainPending;
+    Timer timers[CORE_TIMERS];
+};
+
+#endif // SIMHOST_H
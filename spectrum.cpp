@@ -0,0 +1,257 @@
+#include "spectrum.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+static const double PI = 3.14159265358979323846;
+
+Fft::Fft(size_t size) : n(size), twiddles(size / 2), bitReverse(size) {
+    for (size_t i = 0; i < n / 2; ++i) {
+        double angle = -2 * PI * i / n;
+        twiddles[i] = std::complex<float>((float)std::cos(angle), (float)std::sin(angle));
+    }
+    int bits = 0;
+    while (((size_t)1 << bits) < n) ++bits;
+    for (size_t i = 0; i < n; ++i) {
+        size_t r = 0;
+        for (int b = 0; b < bits; ++b) {
+            if (i & ((size_t)1 << b)) r |= (size_t)1 << (bits - 1 - b);
+        }
+        bitReverse[i] = r;
+    }
+}
+
+size_t Fft::size() const {
+    return n;
+}
+
+/*
+    Function: transform
+    Purpose: Forward FFT of data in place, data must hold size() values
+    Return: void
+ */
+void Fft::transform(std::vector<std::complex<float>> &data) const {
+    for (size_t i = 0; i < n; ++i) {
+        if (i < bitReverse[i]) std::swap(data[i], data[bitReverse[i]]);
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        size_t half = len / 2;
+        size_t stride = n / len;
+        for (size_t start = 0; start < n; start += len) {
+            for (size_t k = 0; k < half; ++k) {
+                std::complex<float> t = twiddles[k * stride] * data[start + k + half];
+                data[start + k + half] = data[start + k] - t;
+                data[start + k] += t;
+            }
+        }
+    }
+}
+
+SpectralAnalyzer::SpectralAnalyzer(int sampleRate, double bandLowHz, double bandHighHz,
+                                   int analysisRate, int fftSize, double loadOhms)
+    : sampleRate(sampleRate),
+      bandLow(bandLowHz),
+      bandHigh(bandHighHz),
+      decimation(analysisRate < sampleRate ? sampleRate / analysisRate : 1),
+      binHz((double)sampleRate / (analysisRate < sampleRate ? sampleRate / analysisRate : 1) / fftSize),
+      loadOhms(loadOhms),
+      fft(fftSize),
+      window(fftSize),
+      decimAccum(0),
+      decimCount(0),
+      scratch(fftSize),
+      powerSum(fftSize / 2 + 1, 0.0),
+      framesPerMinute((long long)sampleRate * 60),
+      minuteFrames(0) {
+    // Hann window
+    for (int i = 0; i < fftSize; ++i) {
+        window[i] = (float)(0.5 - 0.5 * std::cos(2 * PI * i / (fftSize - 1)));
+    }
+    block.reserve(fftSize);
+    std::memset(&current, 0, sizeof(current));
+    report.dominantHz = 0;
+    report.bandMatched = false;
+    report.blocks = 0;
+    report.matchedBlocks = 0;
+    report.totalChargeUc = 0;
+    report.totalEnergyUj = 0;
+}
+
+bool SpectralAnalyzer::inBand(double hz) const {
+    return hz >= bandLow && hz <= bandHigh;
+}
+
+/*
+    Function: feed
+    Purpose: Add the next frames of signal. The left channel is the loop current, it is
+             integrated at full rate for the dose and box-car decimated for the spectrum.
+    Inputs:
+        interleaved: float pointer, L/R samples in microamps
+        frames: size_t, number of L/R frames
+    Return: void
+ */
+void SpectralAnalyzer::feed(const float *interleaved, size_t frames) {
+    const double dt = 1.0 / sampleRate;
+    size_t i = 0;
+    while (i < frames) {
+        // work up to the end of the current minute so per minute sums stay exact
+        size_t n = frames - i;
+        if ((long long)n > framesPerMinute - minuteFrames) n = (size_t)(framesPerMinute - minuteFrames);
+
+        double absSum = 0, sqSum = 0;
+        float peak = current.peakUa > 0 ? (float)current.peakUa : 0.0f;
+        for (size_t k = i; k < i + n; ++k) {
+            float v = interleaved[2 * k];
+            float a = std::fabs(v);
+            absSum += a;
+            sqSum += (double)v * v;
+            if (a > peak) peak = a;
+
+            decimAccum += v;
+            if (++decimCount == decimation) {
+                block.push_back((float)(decimAccum / decimation));
+                decimAccum = 0;
+                decimCount = 0;
+                if (block.size() == fft.size()) analyzeBlock();
+            }
+        }
+
+        // uA * s = uC, uA^2 * ohm * s = 1e-12 J = 1e-6 uJ
+        current.chargeUc += absSum * dt;
+        current.energyUj += sqSum * loadOhms * dt * 1e-6;
+        current.peakUa = peak;
+        minuteFrames += n;
+        i += n;
+
+        if (minuteFrames == framesPerMinute) {
+            report.minutes.push_back(current);
+            report.totalChargeUc += current.chargeUc;
+            report.totalEnergyUj += current.energyUj;
+            std::memset(&current, 0, sizeof(current));
+            minuteFrames = 0;
+        }
+    }
+}
+
+// spectrum of one decimated block, added to the running average
+void SpectralAnalyzer::analyzeBlock() {
+    const size_t n = fft.size();
+    double mean = 0;
+    for (size_t i = 0; i < n; ++i) mean += block[i];
+    mean /= n;
+    for (size_t i = 0; i < n; ++i) {
+        scratch[i] = std::complex<float>((float)((block[i] - mean) * window[i]), 0.0f);
+    }
+    fft.transform(scratch);
+
+    std::vector<double> power(n / 2 + 1);
+    for (size_t i = 0; i <= n / 2; ++i) {
+        power[i] = std::norm(scratch[i]);
+        powerSum[i] += power[i];
+    }
+    double hz;
+    peakBin(power, &hz);
+    report.blocks++;
+    if (inBand(hz)) report.matchedBlocks++;
+    block.clear();
+}
+
+// largest non DC bin with parabolic interpolation for a finer frequency estimate
+size_t SpectralAnalyzer::peakBin(const std::vector<double> &power, double *hz) const {
+    size_t best = 1;
+    for (size_t i = 2; i < power.size(); ++i) {
+        if (power[i] > power[best]) best = i;
+    }
+    double offset = 0;
+    if (best + 1 < power.size() && power[best] > 0) {
+        double a = std::log(power[best - 1] + 1e-30);
+        double b = std::log(power[best]);
+        double c = std::log(power[best + 1] + 1e-30);
+        double denom = a - 2 * b + c;
+        if (denom != 0) offset = 0.5 * (a - c) / denom;
+    }
+    *hz = (best + offset) * binHz;
+    return best;
+}
+
+/*
+    Function: finish
+    Purpose: Close out the analysis, folding in any partial minute and partial block
+    Return: SpectralReport for everything fed so far
+ */
+SpectralReport SpectralAnalyzer::finish() {
+    if (minuteFrames > 0) {
+        report.minutes.push_back(current);
+        report.totalChargeUc += current.chargeUc;
+        report.totalEnergyUj += current.energyUj;
+        std::memset(&current, 0, sizeof(current));
+        minuteFrames = 0;
+    }
+    // a short signal still gets one zero padded block
+    if (report.blocks == 0 && !block.empty()) {
+        block.resize(fft.size(), 0.0f);
+        analyzeBlock();
+    }
+    if (report.blocks > 0) {
+        peakBin(powerSum, &report.dominantHz);
+        report.bandMatched = inBand(report.dominantHz);
+    }
+    return report;
+}
+
+static uint32_t getLE32(const unsigned char *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/*
+    Function: feedFile
+    Purpose: Feed a recorded or rendered 32 bit float stereo WAV file
+    Inputs:
+        path: string, file to read
+    Return: bool, false if the file is missing or not float stereo at the analyzer rate
+ */
+bool SpectralAnalyzer::feedFile(const std::string &path) {
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    unsigned char riff[12];
+    bool ok = std::fread(riff, sizeof(riff), 1, file) == 1 && std::memcmp(riff, "RIFF", 4) == 0 && std::memcmp(riff + 8, "WAVE", 4) == 0;
+    bool formatOk = false;
+
+    // walk every chunk, feeding the sample data
+    unsigned char chunk[8];
+    while (ok && std::fread(chunk, sizeof(chunk), 1, file) == 1) {
+        uint32_t size = getLE32(chunk + 4);
+        if (std::memcmp(chunk, "fmt ", 4) == 0) {
+            unsigned char fmt[16];
+            if (size < 16 || std::fread(fmt, sizeof(fmt), 1, file) != 1) {
+                ok = false;
+                break;
+            }
+            formatOk = (fmt[0] | (fmt[1] << 8)) == 3 && (fmt[2] | (fmt[3] << 8)) == 2 && (int)getLE32(fmt + 4) == sampleRate;
+            std::fseek(file, size - 16 + (size & 1), SEEK_CUR);
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!formatOk) {
+                ok = false;
+                break;
+            }
+            // only the chunk's own frames, chunks such as LIST may follow it
+            std::vector<float> buffer(2 * 65536);
+            size_t frames = size / (2 * sizeof(float));
+            while (frames > 0) {
+                size_t n = std::fread(buffer.data(), 2 * sizeof(float), std::min<size_t>(frames, 65536), file);
+                if (n == 0) break;
+                feed(buffer.data(), n);
+                frames -= n;
+            }
+            std::fseek(file, (long)(size % (2 * sizeof(float)) + (size & 1) + frames * 2 * sizeof(float)), SEEK_CUR);
+        } else {
+            std::fseek(file, size + (size & 1), SEEK_CUR);
+        }
+    }
+    std::fclose(file);
+    return ok && formatOk;
+}
@@ -0,0 +1,92 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <complex>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+const int DEFAULT_ANALYSIS_RATE = 1000;  // rate the signal is decimated to before the FFT
+const int DEFAULT_FFT_SIZE = 4096;       // 0.24 Hz resolution at the default analysis rate
+const double DEFAULT_LOAD_OHMS = 1000.0; // electrode to electrode resistance used for energy
+
+// delivered dose over one minute of signal
+struct MinuteDose {
+    double chargeUc;  // absolute charge, microcoulombs
+    double energyUj;  // energy into the load, microjoules
+    double peakUa;    // largest current magnitude seen, microamps
+};
+
+struct SpectralReport {
+    double dominantHz;          // peak of the averaged spectrum
+    bool bandMatched;           // dominant frequency falls in the expected band
+    int blocks;                 // FFT blocks analyzed
+    int matchedBlocks;          // blocks whose own peak was in the expected band
+    double totalChargeUc;
+    double totalEnergyUj;
+    std::vector<MinuteDose> minutes; // last entry may be a partial minute
+};
+
+/*
+    Class: Fft
+    Purpose: In place radix-2 complex FFT with precomputed twiddles and bit reversal
+ */
+class Fft
+{
+public:
+    explicit Fft(size_t size);
+    void transform(std::vector<std::complex<float>> &data) const;
+    size_t size() const;
+
+private:
+    size_t n;
+    std::vector<std::complex<float>> twiddles;
+    std::vector<size_t> bitReverse;
+};
+
+/*
+    Class: SpectralAnalyzer
+    Purpose: Streams interleaved L/R current samples, verifies the dominant frequency
+             band block by block and integrates the delivered charge and energy per minute.
+ */
+class SpectralAnalyzer
+{
+public:
+    SpectralAnalyzer(int sampleRate, double bandLowHz, double bandHighHz,
+                     int analysisRate = DEFAULT_ANALYSIS_RATE, int fftSize = DEFAULT_FFT_SIZE,
+                     double loadOhms = DEFAULT_LOAD_OHMS);
+
+    void feed(const float *interleaved, size_t frames);
+    SpectralReport finish();
+    bool feedFile(const std::string &path); // float stereo WAV as written by WaveformSynth
+
+private:
+    int sampleRate;
+    double bandLow;
+    double bandHigh;
+    int decimation;     // input samples averaged into one analysis sample
+    double binHz;
+    double loadOhms;
+    Fft fft;
+    std::vector<float> window;
+
+    // decimation state
+    double decimAccum;
+    int decimCount;
+    std::vector<float> block;
+    std::vector<std::complex<float>> scratch;
+    std::vector<double> powerSum;
+
+    // dose state
+    long long framesPerMinute;
+    long long minuteFrames;
+    MinuteDose current;
+
+    SpectralReport report;
+
+    void analyzeBlock();
+    size_t peakBin(const std::vector<double> &power, double *hz) const;
+    bool inBand(double hz) const;
+};
+
+#endif // SPECTRUM_H
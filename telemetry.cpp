@@ -0,0 +1,422 @@
+#include "telemetry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// worst case bits of one sample: flag, time, word and battery at their widest
+static const int MAX_SAMPLE_BITS = 1 + (3 + 32) + (1 + 9) + (3 + 16);
+static const int BLOCK_BITS = TELEMETRY_BLOCK_BYTES * 8;
+
+// state 3 bits, connection 2 bits, intensity 4 bits
+static uint16_t packWord(const TelemetrySample &sample) {
+    return (uint16_t)((sample.state & 7) | (sample.connection & 3) << 3 | (sample.intensity & 15) << 5);
+}
+
+static void unpackWord(uint16_t word, TelemetrySample *sample) {
+    sample->state = word & 7;
+    sample->connection = (word >> 3) & 3;
+    sample->intensity = (word >> 5) & 15;
+}
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static void putBits(uint8_t *data, uint16_t &position, uint64_t value, int bits) {
+    for (int i = bits - 1; i >= 0; --i) {
+        if ((value >> i) & 1) data[position >> 3] |= 0x80 >> (position & 7);
+        position++;
+    }
+}
+
+static uint64_t getBits(const uint8_t *data, int &position, int bits) {
+    uint64_t value = 0;
+    for (int i = 0; i < bits; ++i) {
+        value = (value << 1) | ((data[position >> 3] >> (7 - (position & 7))) & 1);
+        position++;
+    }
+    return value;
+}
+
+// a delta of deltas under one of three prefixes, the widths are picked for each signal
+static void putVarying(uint8_t *data, uint16_t &position, int64_t value, int narrow, int middle, int wide) {
+    uint64_t z = zigzag(value);
+    if (z < (1ULL << narrow)) {
+        putBits(data, position, 0b10, 2);
+        putBits(data, position, z, narrow);
+    } else if (z < (1ULL << middle)) {
+        putBits(data, position, 0b110, 3);
+        putBits(data, position, z, middle);
+    } else {
+        putBits(data, position, 0b111, 3);
+        putBits(data, position, z, wide);
+    }
+}
+
+static int64_t getVarying(const uint8_t *data, int &position, int narrow, int middle, int wide) {
+    if (!getBits(data, position, 1)) return 0;
+    if (!getBits(data, position, 1)) return unzigzag(getBits(data, position, narrow));
+    return unzigzag(getBits(data, position, getBits(data, position, 1) ? wide : middle));
+}
+
+// a battery draining at a fractional rate rounds to deltas like 35, 36, 35, 36, a change of
+// one is expected to swing back so that jitter costs nothing
+static int32_t expectedBatteryDod(int32_t lastDod) {
+    return lastDod == 1 || lastDod == -1 ? -lastDod : 0;
+}
+
+// time: 7, 12 or 32 bits, battery: 3, 8 or 16 bits
+static void putTime(uint8_t *data, uint16_t &position, int64_t dod) {
+    if (dod == 0) putBits(data, position, 0, 1);
+    else putVarying(data, position, dod, 7, 12, 32);
+}
+
+static void putBattery(uint8_t *data, uint16_t &position, int64_t dod) {
+    if (dod == 0) putBits(data, position, 0, 1);
+    else putVarying(data, position, dod, 3, 8, 16);
+}
+
+TelemetryStore::TelemetryStore(int64_t retentionMs) : retentionMs(retentionMs), poolSize(0) {}
+
+TelemetryStore::Block &TelemetryStore::block(uint32_t index) const {
+    return chunks[index / CHUNK_BLOCKS][index % CHUNK_BLOCKS];
+}
+
+// a block from the free list, or the next one of the pool, a new chunk when the pool is full
+uint32_t TelemetryStore::takeBlock() {
+    if (!freeBlocks.empty()) {
+        uint32_t index = freeBlocks.back();
+        freeBlocks.pop_back();
+        return index;
+    }
+    if (poolSize == chunks.size() * CHUNK_BLOCKS) chunks.emplace_back(new Block[CHUNK_BLOCKS]);
+    return (uint32_t)poolSize++;
+}
+
+uint32_t TelemetryStore::addSeries() {
+    std::lock_guard<std::mutex> guard(lock);
+    Series s = {};
+    all.push_back(s);
+    return (uint32_t)(all.size() - 1);
+}
+
+// start a block with this sample in full, the deltas start over from it
+void TelemetryStore::openBlock(Series &s, const TelemetrySample &sample, int32_t battery, uint16_t word) {
+    uint32_t index = takeBlock();
+    Block &b = block(index);
+    b.firstMs = sample.timeMs;
+    b.lastMs = sample.timeMs;
+    b.firstBattery = battery;
+    b.firstWord = word;
+    b.count = 1;
+    std::memset(b.data, 0, sizeof(b.data));
+    s.blocks.push_back(index);
+    s.lastDeltaMs = 0;
+    s.lastBatteryDelta = 0;
+    s.lastBatteryDod = 0;
+    s.bitPosition = 0;
+}
+
+// hand back the blocks that ended before the retention, the open block always stays
+void TelemetryStore::expire(Series &s, int64_t nowMs) {
+    size_t expired = 0;
+    while (expired + 1 < s.blocks.size() && block(s.blocks[expired]).lastMs < nowMs - retentionMs) {
+        freeBlocks.push_back(s.blocks[expired]);
+        expired++;
+    }
+    if (expired) s.blocks.erase(s.blocks.begin(), s.blocks.begin() + expired);
+}
+
+/*
+    Function: record
+    Purpose: Append a sample to a series, usually one bit when nothing but the time moved on
+    Inputs:
+        series: id from addSeries
+        sample: TelemetrySample, not older than the last one of the series
+    Return: void
+*/
+void TelemetryStore::record(uint32_t series, const TelemetrySample &sample) {
+    std::lock_guard<std::mutex> guard(lock);
+    Series &s = all[series];
+    int32_t battery = (int32_t)std::lround(sample.battery * TELEMETRY_BATTERY_UNITS);
+    uint16_t word = packWord(sample);
+    int64_t delta = sample.timeMs - s.lastMs;
+    int64_t timeDod = delta - s.lastDeltaMs;
+    int32_t batteryDelta = battery - s.lastBattery;
+    int32_t batteryDod = batteryDelta - s.lastBatteryDelta;
+    int64_t batteryMiss = (int64_t)batteryDod - expectedBatteryDod(s.lastBatteryDod);
+
+    bool fits = s.samples > 0 && delta >= 0 && s.bitPosition + MAX_SAMPLE_BITS <= BLOCK_BITS
+             && zigzag(timeDod) < (1ULL << 32) && zigzag(batteryMiss) < (1ULL << 16);
+    if (!fits) {
+        openBlock(s, sample, battery, word);
+    } else {
+        Block &b = block(s.blocks.back());
+        if (timeDod == 0 && word == s.lastWord && batteryMiss == 0) {
+            putBits(b.data, s.bitPosition, 0, 1);
+        } else {
+            putBits(b.data, s.bitPosition, 1, 1);
+            putTime(b.data, s.bitPosition, timeDod);
+            if (word == s.lastWord) {
+                putBits(b.data, s.bitPosition, 0, 1);
+            } else {
+                putBits(b.data, s.bitPosition, 1, 1);
+                putBits(b.data, s.bitPosition, word, 9);
+            }
+            putBattery(b.data, s.bitPosition, batteryMiss);
+        }
+        b.lastMs = sample.timeMs;
+        b.count++;
+        s.lastDeltaMs = delta;
+        s.lastBatteryDelta = batteryDelta;
+        s.lastBatteryDod = batteryDod;
+    }
+    s.lastMs = sample.timeMs;
+    s.lastBattery = battery;
+    s.lastWord = word;
+    s.samples++;
+    expire(s, sample.timeMs);
+}
+
+// every sample of a block in time order
+template <typename Visit>
+void TelemetryStore::decode(const Block &b, Visit visit) const {
+    TelemetrySample sample;
+    sample.timeMs = b.firstMs;
+    int32_t battery = b.firstBattery;
+    uint16_t word = b.firstWord;
+    int64_t delta = 0;
+    int32_t batteryDelta = 0;
+    int32_t batteryDod = 0;
+    int position = 0;
+    for (uint16_t i = 0; i < b.count; ++i) {
+        if (i > 0) {
+            int32_t miss = 0;
+            if (getBits(b.data, position, 1)) {
+                delta += getVarying(b.data, position, 7, 12, 32);
+                if (getBits(b.data, position, 1)) word = (uint16_t)getBits(b.data, position, 9);
+                miss = (int32_t)getVarying(b.data, position, 3, 8, 16);
+            }
+            batteryDod = expectedBatteryDod(batteryDod) + miss;
+            batteryDelta += batteryDod;
+            sample.timeMs += delta;
+            battery += batteryDelta;
+        }
+        sample.battery = (double)battery / TELEMETRY_BATTERY_UNITS;
+        unpackWord(word, &sample);
+        visit(sample);
+    }
+}
+
+// the samples of a series between two times, only the blocks overlapping them are decoded
+template <typename Visit>
+void TelemetryStore::scan(uint32_t series, int64_t fromMs, int64_t toMs, Visit visit) const {
+    const std::vector<uint32_t> &blocks = all[series].blocks;
+    auto first = std::lower_bound(blocks.begin(), blocks.end(), fromMs, [this](uint32_t index, int64_t ms) {
+        return block(index).lastMs < ms;
+    });
+    for (auto it = first; it != blocks.end() && block(*it).firstMs <= toMs; ++it) {
+        decode(block(*it), [fromMs, toMs, &visit](const TelemetrySample &sample) {
+            if (sample.timeMs >= fromMs && sample.timeMs <= toMs) visit(sample);
+        });
+    }
+}
+
+std::vector<TelemetrySample> TelemetryStore::range(uint32_t series, int64_t fromMs, int64_t toMs) const {
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<TelemetrySample> samples;
+    scan(series, fromMs, toMs, [&samples](const TelemetrySample &sample) { samples.push_back(sample); });
+    return samples;
+}
+
+/*
+    Function: downsample
+    Purpose: Summarize a time range in buckets of equal length, each with the battery and
+             intensity extremes, the last battery and state and the connection extremes.
+             Buckets without samples are left out.
+    Inputs:
+        series: id from addSeries
+        fromMs: int64, start of the range
+        toMs: int64, end of the range, included
+        bucketMs: int64, length of a bucket
+    Return: vector of TelemetryBucket in time order
+*/
+std::vector<TelemetryBucket> TelemetryStore::downsample(uint32_t series, int64_t fromMs, int64_t toMs, int64_t bucketMs) const {
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<TelemetryBucket> buckets;
+    if (bucketMs <= 0) bucketMs = 1;
+    scan(series, fromMs, toMs, [&buckets, fromMs, bucketMs](const TelemetrySample &sample) {
+        int64_t start = fromMs + (sample.timeMs - fromMs) / bucketMs * bucketMs;
+        float battery = (float)sample.battery;
+        if (buckets.empty() || buckets.back().startMs != start) {
+            TelemetryBucket b;
+            b.startMs = start;
+            b.count = 0;
+            b.batteryMin = b.batteryMax = battery;
+            b.intensityMin = b.intensityMax = sample.intensity;
+            b.connectionMin = b.connectionMax = sample.connection;
+            buckets.push_back(b);
+        }
+        TelemetryBucket &b = buckets.back();
+        b.count++;
+        b.batteryMin = std::min(b.batteryMin, battery);
+        b.batteryMax = std::max(b.batteryMax, battery);
+        b.batteryLast = battery;
+        b.intensityMin = std::min(b.intensityMin, sample.intensity);
+        b.intensityMax = std::max(b.intensityMax, sample.intensity);
+        b.connectionMin = std::min(b.connectionMin, sample.connection);
+        b.connectionMax = std::max(b.connectionMax, sample.connection);
+        b.state = sample.state;
+    });
+    return buckets;
+}
+
+/*
+    Function: spans
+    Purpose: Find the stretches of a time range the series spent in any of a set of states,
+             such as the sessions of a device. A stretch ends at the first sample outside
+             the states, or at the last sample.
+    Inputs:
+        series: id from addSeries
+        fromMs: int64, start of the range
+        toMs: int64, end of the range, included
+        stateMask: bit 1 << state set for each state to look for
+    Return: vector of TelemetrySpan in time order
+*/
+std::vector<TelemetrySpan> TelemetryStore::spans(uint32_t series, int64_t fromMs, int64_t toMs, uint32_t stateMask) const {
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<TelemetrySpan> found;
+    bool open = false;
+    scan(series, fromMs, toMs, [&found, &open, stateMask](const TelemetrySample &sample) {
+        bool inside = (stateMask >> sample.state) & 1;
+        if (inside && !open) found.push_back(TelemetrySpan{sample.timeMs, sample.timeMs});
+        if (inside || open) found.back().endMs = sample.timeMs;
+        open = inside;
+    });
+    return found;
+}
+
+bool TelemetryStore::latest(uint32_t series, TelemetrySample *sample) const {
+    std::lock_guard<std::mutex> guard(lock);
+    const Series &s = all[series];
+    if (s.samples == 0) return false;
+    sample->timeMs = s.lastMs;
+    sample->battery = (double)s.lastBattery / TELEMETRY_BATTERY_UNITS;
+    unpackWord(s.lastWord, sample);
+    return true;
+}
+
+size_t TelemetryStore::seriesCount() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return all.size();
+}
+
+// samples still held, expired blocks are not counted
+size_t TelemetryStore::samples() const {
+    std::lock_guard<std::mutex> guard(lock);
+    size_t total = 0;
+    for (const Series &s : all) {
+        for (uint32_t index : s.blocks) total += block(index).count;
+    }
+    return total;
+}
+
+size_t TelemetryStore::blocks() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return poolSize - freeBlocks.size();
+}
+
+size_t TelemetryStore::bytes() const {
+    std::lock_guard<std::mutex> guard(lock);
+    size_t total = (poolSize - freeBlocks.size()) * sizeof(Block) + all.capacity() * sizeof(Series);
+    for (const Series &s : all) total += s.blocks.capacity() * sizeof(uint32_t);
+    return total;
+}
+
+/*
+    Function: synthesizeTelemetry
+    Purpose: Fill a store with a fleet of devices sampled once a second. Each device sits off
+             or choosing a session for a while, runs a 20 or 45 minute session at some
+             intensity with the odd lost contact, soft offs and starts again, draining its
+             battery at the device's rates and recharging when it runs low.
+    Inputs:
+        store: TelemetryStore, one series is added per device
+        devices: number of devices
+        durationMs: int64, time simulated from 0
+        seed: random seed
+    Return: void
+*/
+void synthesizeTelemetry(TelemetryStore &store, size_t devices, int64_t durationMs, uint32_t seed) {
+    // device State and ConnectionStatus values
+    enum {Off = 0, Choosing = 1, InSession = 3, Paused = 4, Testing = 5, SoftOff = 6};
+    enum {Excellent = 1, Okay = 2, No = 3};
+
+    uint32_t random = seed ? seed : 1;
+    auto next = [&random]() {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        return random;
+    };
+
+    for (size_t d = 0; d < devices; ++d) {
+        uint32_t id = store.addSeries();
+        TelemetrySample sample = {};
+        sample.battery = 40 + next() % 60;
+        sample.state = Off;
+        sample.connection = Excellent;
+        int64_t left = (next() % 3600) * 1000;  // time left in the current state
+        int64_t sessionLeft = 0;
+
+        for (int64_t ms = 0; ms < durationMs; ms += 1000) {
+            sample.timeMs = ms;
+            store.record(id, sample);
+
+            if (sample.state == InSession) {
+                sample.battery -= (0.2 + 0.1 * sample.intensity + 0.01 * sample.connection) / 2;
+                sessionLeft -= 1000;
+                if (next() % 5000 == 0) sample.connection = next() % 2 ? Okay : Excellent;
+                if (next() % 20000 == 0) {
+                    sample.state = Paused;
+                    sample.connection = No;
+                    left = (5 + next() % 30) * 1000;
+                }
+            } else if (sample.state == Off) {
+                // nothing drains
+            } else {
+                sample.battery -= sample.state == Paused ? 0.025 : 0.05;
+            }
+            if (sample.battery < 5) sample.battery = 100;  // put on the charger
+
+            left -= 1000;
+            if (sample.state == InSession && sessionLeft <= 0) {
+                sample.state = SoftOff;
+                left = sample.intensity * 1000;
+            } else if (left > 0 || sample.state == InSession) {
+                continue;
+            } else if (sample.state == Off) {
+                sample.state = Choosing;
+                left = (10 + next() % 120) * 1000;
+            } else if (sample.state == Choosing) {
+                sample.state = Testing;
+                left = 5000;
+            } else if (sample.state == Testing) {
+                sample.state = InSession;
+                sample.intensity = 1 + next() % 8;
+                sessionLeft = (next() % 2 ? 20 : 45) * 60000LL;
+            } else if (sample.state == Paused) {
+                sample.state = InSession;
+                sample.connection = Excellent;
+            } else if (sample.state == SoftOff) {
+                sample.state = Off;
+                sample.intensity = 0;
+                left = (600 + next() % 7200) * 1000;
+            }
+        }
+    }
+}
@@ -0,0 +1,120 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+const int TELEMETRY_BLOCK_BYTES = 232;      // bit stream of a block, a block is 256 bytes with its header
+const int TELEMETRY_BATTERY_UNITS = 100;    // battery is kept to a hundredth of a percent
+const int64_t TELEMETRY_DAY_MS = 24LL * 3600 * 1000;
+
+// one reading of a device
+struct TelemetrySample {
+    int64_t timeMs;
+    double battery;
+    uint8_t state;
+    uint8_t intensity;
+    uint8_t connection;
+};
+
+// the readings of one interval of a downsampled range
+struct TelemetryBucket {
+    int64_t startMs;
+    uint32_t count;
+    float batteryMin;
+    float batteryMax;
+    float batteryLast;
+    uint8_t intensityMin;
+    uint8_t intensityMax;
+    uint8_t connectionMin;
+    uint8_t connectionMax;
+    uint8_t state;  // last
+};
+
+// a stretch of time a series spent in a set of states
+struct TelemetrySpan {
+    int64_t startMs;
+    int64_t endMs;
+};
+
+/*
+    Class: TelemetryStore
+    Purpose: Compressed history of the battery, intensity, state and connection of many
+             devices, one series per device. Each series is a list of fixed size blocks from
+             a shared pool. A block holds its first sample in full and then a bit stream of
+             the rest: a sample with the same time step, the same state/intensity/connection
+             and the same battery slope as the one before is a single bit, otherwise the time
+             and battery are written as deltas of their last delta and the packed state word
+             only when it changed. Blocks older than the retention are handed back to the pool.
+             Every call locks, so devices on different threads can share a store.
+ */
+class TelemetryStore
+{
+public:
+    explicit TelemetryStore(int64_t retentionMs = TELEMETRY_DAY_MS);
+    TelemetryStore(const TelemetryStore &) = delete;
+    TelemetryStore &operator=(const TelemetryStore &) = delete;
+
+    uint32_t addSeries();
+    void record(uint32_t series, const TelemetrySample &);  // times must not go back
+
+    std::vector<TelemetrySample> range(uint32_t series, int64_t fromMs, int64_t toMs) const;
+    std::vector<TelemetryBucket> downsample(uint32_t series, int64_t fromMs, int64_t toMs, int64_t bucketMs) const;
+    std::vector<TelemetrySpan> spans(uint32_t series, int64_t fromMs, int64_t toMs, uint32_t stateMask) const;
+    bool latest(uint32_t series, TelemetrySample *) const;
+
+    size_t seriesCount() const;
+    size_t samples() const;
+    size_t blocks() const;
+    size_t bytes() const;  // blocks in use and per series bookkeeping
+
+private:
+    struct Block {
+        int64_t firstMs;
+        int64_t lastMs;
+        int32_t firstBattery;
+        uint16_t firstWord;
+        uint16_t count;
+        uint8_t data[TELEMETRY_BLOCK_BYTES];
+    };
+    static_assert(sizeof(Block) == 256, "a telemetry block should fill 256 bytes");
+
+    // where the open block of a series was left, so the next sample can be encoded against it
+    struct Series {
+        std::vector<uint32_t> blocks;  // pool indices, oldest first
+        int64_t lastMs;
+        int64_t lastDeltaMs;
+        int32_t lastBattery;
+        int32_t lastBatteryDelta;
+        int32_t lastBatteryDod;
+        uint16_t lastWord;
+        uint16_t bitPosition;  // in the open block
+        uint64_t samples;
+    };
+
+    static const size_t CHUNK_BLOCKS = 4096;
+
+    mutable std::mutex lock;
+    int64_t retentionMs;
+    std::vector<Series> all;
+    std::vector<std::unique_ptr<Block[]>> chunks;  // the pool, chunks never move
+    std::vector<uint32_t> freeBlocks;
+    size_t poolSize;
+
+    Block &block(uint32_t index) const;
+    uint32_t takeBlock();
+    void openBlock(Series &, const TelemetrySample &, int32_t battery, uint16_t word);
+    void expire(Series &, int64_t nowMs);
+    template <typename Visit>
+    void decode(const Block &, Visit visit) const;
+    template <typename Visit>
+    void scan(uint32_t series, int64_t fromMs, int64_t toMs, Visit visit) const;
+};
+
+// a fleet of simulated devices going through sessions, one sample a second
+void synthesizeTelemetry(TelemetryStore &, size_t devices, int64_t durationMs, uint32_t seed);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,98 @@
+#include "timeline.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+SessionTimeline::SessionTimeline() : total(0) {}
+
+// zero length steps are dropped, the remaining ones are laid out in order
+SessionTimeline::SessionTimeline(const std::vector<ProgramStep> &steps) : total(0) {
+    starts.reserve(steps.size());
+    segments.reserve(steps.size());
+    for (const ProgramStep &step : steps) {
+        if (step.durationMs <= 0) continue;
+        TimelineSegment segment;
+        segment.startMs = total;
+        segment.endMs = total + step.durationMs;
+        segment.typeIndex = step.typeIndex;
+        segment.frequencyHz = step.frequencyHz;
+        segment.intensityFrom = step.intensityFrom;
+        segment.intensityTo = step.intensityFrom == FOLLOW_INTENSITY ? FOLLOW_INTENSITY : step.intensityTo;
+        starts.push_back(segment.startMs);
+        segments.push_back(segment);
+        total = segment.endMs;
+    }
+}
+
+long long SessionTimeline::duration() const {
+    return total;
+}
+
+size_t SessionTimeline::size() const {
+    return segments.size();
+}
+
+bool SessionTimeline::empty() const {
+    return segments.empty();
+}
+
+const TimelineSegment &SessionTimeline::segment(size_t index) const {
+    return segments[index];
+}
+
+/*
+    Function: indexAt
+    Purpose: Find the segment playing at a time since the start of the session
+    Inputs:
+        ms: long long, time into the session
+    Return: integer, segment index or -1 before the start or from the end on
+ */
+int SessionTimeline::indexAt(long long ms) const {
+    if (ms < 0 || ms >= total) return -1;
+    return (int)(std::upper_bound(starts.begin(), starts.end(), ms) - starts.begin()) - 1;
+}
+
+/*
+    Function: intensityAt
+    Purpose: Intensity the program asks for at a time. A ramp moves one whole level at a time,
+             every level from intensityFrom to intensityTo held for an equal share of its
+             segment, so intensityTo plays for the last share.
+    Inputs:
+        ms: long long, time into the session
+        fallback: integer, used outside the program and for segments without a ramp
+    Return: integer intensity
+ */
+int SessionTimeline::intensityAt(long long ms, int fallback) const {
+    int index = indexAt(ms);
+    if (index < 0) return fallback;
+    const TimelineSegment &s = segments[index];
+    if (s.intensityFrom == FOLLOW_INTENSITY) return fallback;
+
+    int span = std::abs(s.intensityTo - s.intensityFrom);
+    long long levels = std::min<long long>((span + 1) * (ms - s.startMs) / (s.endMs - s.startMs), span);
+    return s.intensityTo >= s.intensityFrom ? s.intensityFrom + (int)levels : s.intensityFrom - (int)levels;
+}
+
+/*
+    Function: nextChangeMs
+    Purpose: When the active segment or its ramped intensity next changes, so a caller can
+             sleep until then instead of polling
+    Inputs:
+        ms: long long, time into the session
+    Return: long long, a time after ms, or duration() if nothing changes before the end
+ */
+long long SessionTimeline::nextChangeMs(long long ms) const {
+    int index = indexAt(ms);
+    if (index < 0) return ms < 0 && total > 0 ? 0 : total;
+    const TimelineSegment &s = segments[index];
+    if (s.intensityFrom == FOLLOW_INTENSITY || s.intensityFrom == s.intensityTo) return s.endMs;
+
+    // level k starts at the first ms where (span + 1) * elapsed / length reaches k
+    long long span = std::abs(s.intensityTo - s.intensityFrom);
+    long long shares = span + 1;
+    long long length = s.endMs - s.startMs;
+    long long k = shares * (ms - s.startMs) / length + 1;
+    if (k > span) return s.endMs;
+    long long next = s.startMs + (k * length + shares - 1) / shares;
+    return next < s.endMs ? next : s.endMs;
+}
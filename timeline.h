@@ -0,0 +1,56 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <cstddef>
+#include <vector>
+
+// intensity of a step that follows whatever the device is set to
+const int FOLLOW_INTENSITY = -1;
+
+// one step of a session program before it is compiled
+struct ProgramStep {
+    int typeIndex;          // index into the device's session types
+    double frequencyHz;
+    long long durationMs;
+    int intensityFrom;      // ramp over the step, FOLLOW_INTENSITY for no ramp
+    int intensityTo;
+};
+
+// a compiled step placed on the session's time axis
+struct TimelineSegment {
+    long long startMs;
+    long long endMs;
+    int typeIndex;
+    double frequencyHz;
+    int intensityFrom;
+    int intensityTo;
+};
+
+/*
+    Class: SessionTimeline
+    Purpose: A session program flattened into back to back segments. The segment active at
+             any time, its ramped intensity and the next time either changes are found by
+             binary search over the segment start times.
+ */
+class SessionTimeline
+{
+public:
+    SessionTimeline();
+    explicit SessionTimeline(const std::vector<ProgramStep> &steps);
+
+    long long duration() const;
+    size_t size() const;
+    bool empty() const;
+    const TimelineSegment &segment(size_t index) const;
+
+    int indexAt(long long ms) const;                 // -1 outside the program
+    int intensityAt(long long ms, int fallback) const;
+    long long nextChangeMs(long long ms) const;      // next segment or ramp step boundary, duration() at the end
+
+private:
+    std::vector<long long> starts;  // segment start times, searched with upper_bound
+    std::vector<TimelineSegment> segments;
+    long long total;
+};
+
+#endif // TIMELINE_H
@@ -0,0 +1,648 @@
+#include "tools.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <thread>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include "analytics.h"
+#include "devicecore.h"
+#include "impedance.h"
+#include "sessionflow.h"
+#include "sharedstate.h"
+#include "simhost.h"
+#include "telemetry.h"
+
+// value following a --name option, or the fallback when it is missing
+static double optionValue(const QStringList &args, const QString &name, double fallback) {
+    int i = args.indexOf(name);
+    if (i < 0 || i + 1 >= args.size()) return fallback;
+    bool ok;
+    double value = args.at(i + 1).toDouble(&ok);
+    return ok ? value : fallback;
+}
+
+// text following a --name option, or the fallback when it is missing
+static QString optionText(const QStringList &args, const QString &name, const QString &fallback) {
+    int i = args.indexOf(name);
+    return i >= 0 && i + 1 < args.size() ? args.at(i + 1) : fallback;
+}
+
+bool isToolCommand(const char *arg) {
+    QString command(arg);
+    return command == "alloc-diff" || command == "contact-study" || command == "device-sim" || command == "flow-check"
+        || command == "history-report" || command == "session-swarm" || command == "shm-monitor"
+        || command == "telemetry-study";
+}
+
+int runTool(QStringList args) {
+    QString command = args.value(1);
+    if (command == "alloc-diff") return runAllocDiff(args);
+    if (command == "contact-study") return runContactStudy(args);
+    if (command == "device-sim") return runDeviceSim(args);
+    if (command == "flow-check") return runFlowCheck(args);
+    if (command == "history-report") return runHistoryReport(args);
+    if (command == "session-swarm") return runSessionSwarm(args);
+    if (command == "shm-monitor") return runShmMonitor(args);
+    if (command == "telemetry-study") return runTelemetryStudy(args);
+    return 1;
+}
+
+bool electrodeOptions(const QStringList &args, ElectrodeParams &left, ElectrodeParams &right, QString *error) {
+    for (int i = 1; i + 1 < args.size(); ++i) {
+        if (args.at(i) != "--electrode") continue;
+        QString option = args.at(i + 1);
+        QString side = option.section(':', 0, 0);
+        std::string spec = option.section(':', 1).toStdString();
+        bool ok = side == "left" || side == "right" || side == "both";
+        if (ok && side != "right") ok = parseElectrodeParams(spec, left);
+        if (ok && side != "left") ok = parseElectrodeParams(spec, right);
+        if (!ok) {
+            if (error) *error = option;
+            return false;
+        }
+    }
+    return true;
+}
+
+// per call allocations and bytes of each scope in an --alloc-report file, copies of each type
+struct AllocFigures {
+    std::map<std::string, std::pair<double, double>> scopes;
+    std::map<std::string, double> copies;
+};
+
+static bool readAllocReport(const QString &path, AllocFigures &figures) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+    bool copySection = false;
+    while (!file.atEnd()) {
+        QStringList fields = QString::fromUtf8(file.readLine()).trimmed().split('\t');
+        if (fields.value(0).startsWith('#')) {
+            copySection = fields.value(0) == "# copies";
+            continue;
+        }
+        if (copySection && fields.size() == 3 && fields[0] != "type") {
+            figures.copies[fields[0].toStdString()] = fields[1].toDouble();
+        } else if (!copySection && fields.size() == 9 && fields[0] != "scope") {
+            figures.scopes[fields[0].toStdString()] = std::make_pair(fields[7].toDouble(), fields[8].toDouble());
+        }
+    }
+    return true;
+}
+
+/*
+    Function: runAllocDiff
+    Purpose: Compare two --alloc-report files, from two builds running the same scenario, and
+             list the scopes whose allocations or bytes per call moved and the types copied a
+             different number of times.
+             Usage: alloc-diff BEFORE AFTER [--min-bytes B]
+    Inputs:
+        args: QStringList, application arguments
+    Return: integer exit code, 1 if a file could not be read
+*/
+int runAllocDiff(QStringList args) {
+    QTextStream out(stdout);
+    double minBytes = optionValue(args, "--min-bytes", 0);
+    AllocFigures before, after;
+    if (!readAllocReport(args.value(2), before) || !readAllocReport(args.value(3), after)) {
+        out << "usage: alloc-diff BEFORE AFTER [--min-bytes B], both written with --alloc-report\n";
+        return 1;
+    }
+
+    // scopes and types of either run, a missing one counts as zero
+    std::map<std::string, std::pair<double, double>> scopes = after.scopes;
+    for (const auto &entry : before.scopes) scopes.emplace(entry.first, std::make_pair(0.0, 0.0));
+    out << "scope\tallocs_per_call\tbytes_per_call\n";
+    for (const auto &entry : scopes) {
+        std::pair<double, double> was = before.scopes.count(entry.first) ? before.scopes[entry.first] : std::make_pair(0.0, 0.0);
+        std::pair<double, double> now = entry.second;
+        if (was == now || std::abs(now.second - was.second) < minBytes) continue;
+        out << QString::fromStdString(entry.first) << "\t" << was.first << " -> " << now.first << "\t" << was.second << " -> "
+            << now.second << "\n";
+    }
+
+    std::map<std::string, double> types = after.copies;
+    for (const auto &entry : before.copies) types.emplace(entry.first, 0.0);
+    out << "\ntype\tcopies\n";
+    for (const auto &entry : types) {
+        double was = before.copies.count(entry.first) ? before.copies[entry.first] : 0;
+        if (was != entry.second) out << QString::fromStdString(entry.first) << "\t" << was << " -> " << entry.second << "\n";
+    }
+    return 0;
+}
+
+/*
+    Function: runContactStudy
+    Purpose: Run the electrode impedance model over a fleet of devices kept in session and
+             report disconnect, pause and safe voltage rates.
+             Usage: contact-study [--devices N] [--hours H] [--step S] [--seed N] [--electrode side:spec]...
+    Inputs:
+        args: QStringList, application arguments
+    Return: integer exit code
+*/
+int runContactStudy(QStringList args) {
+    QTextStream out(stdout);
+    size_t devices = (size_t)optionValue(args, "--devices", 1000);
+    double hours = optionValue(args, "--hours", 1);
+    double step = optionValue(args, "--step", 0.25);
+    uint32_t seed = (uint32_t)optionValue(args, "--seed", 1);
+
+    ElectrodeParams left, right;
+    QString bad;
+    if (!electrodeOptions(args, left, right, &bad)) {
+        out << "bad --electrode " << bad << "\n";
+        return 1;
+    }
+    ImpedanceField field(devices, left, right, seed);
+    for (size_t d = 0; d < devices; ++d) field.setInSession(d, true);
+
+    QElapsedTimer timer;
+    timer.start();
+    long long steps = (long long)(hours * 3600 / step);
+    for (long long i = 0; i < steps; ++i) {
+        field.step(step);
+    }
+    qint64 elapsed = timer.elapsed();
+
+    const ContactStudy &study = field.getStudy();
+    double deviceHours = study.deviceSeconds / 3600;
+    size_t grades[3];
+    field.countGrades(grades);
+
+    out << "devices: " << devices << "  simulated hours: " << hours << "  step: " << step << " s\n";
+    out << "disconnects: " << study.disconnects << " (" << study.disconnects / deviceHours << " per device hour)\n";
+    out << "pauses: " << study.pauses << " (" << study.pauses / deviceHours << " per device hour)\n";
+    out << "safe voltage returns: " << study.safeVoltages << " (" << study.safeVoltages / deviceHours << " per device hour)\n";
+    out << "final grades  No: " << grades[0] << "  Okay: " << grades[1] << "  Excellent: " << grades[2] << "\n";
+    out << "wall time: " << elapsed << " ms\n";
+    return 0;
+}
+
+/*
+    Function: runHistoryReport
+    Purpose: Run the therapy history reports on a saved history, or on a synthetic one of
+             the given size, and print them with the time each took.
+             Usage: history-report [--file F | --entries N --users U --seed N] [--threads T] [--top K]
+    Inputs:
+        args: QStringList, application arguments
+    Return: integer exit code
+*/
+int runHistoryReport(QStringList args) {
+    QTextStream out(stdout);
+    unsigned threads = (unsigned)optionValue(args, "--threads", 0);
+    size_t top = (size_t)optionValue(args, "--top", 10);
+
+    TherapyHistory history;
+    QElapsedTimer timer;
+    timer.start();
+    int fileArg = args.indexOf("--file");
+    if (fileArg >= 0) {
+        if (!history.load(args.value(fileArg + 1).toStdString())) {
+            out << "could not read history " << args.value(fileArg + 1) << "\n";
+            return 1;
+        }
+    } else {
+        synthesizeHistory(history, (size_t)optionValue(args, "--entries", 10000000), (size_t)optionValue(args, "--users", 1000),
+                          (uint32_t)optionValue(args, "--seed", 1));
+    }
+    out << "entries: " << history.size() << "  users: " << history.userCount() << "  loaded in " << timer.elapsed() << " ms\n";
+
+    timer.restart();
+    std::vector<TypeIntensity> byType = intensityByType(history, threads);
+    qint64 typeMs = timer.restart();
+    std::vector<ProgramCount> replayed = mostReplayed(history, top, threads);
+    qint64 replayMs = timer.restart();
+    std::vector<UserTrend> trends = userTrends(history, threads);
+    qint64 trendMs = timer.elapsed();
+
+    out << "\nintensity by session type, levels 1.." << history.levels() << " (" << typeMs << " ms)\n";
+    for (const TypeIntensity &row : byType) {
+        out << QString::fromStdString(history.typeName(row.type)) << "\tcount " << row.count << "\tmean " << QString::number(row.meanIntensity, 'f', 2) << "\t";
+        for (size_t level = 0; level < row.histogram.size(); ++level) out << (level ? " " : "") << row.histogram[level];
+        out << "\n";
+    }
+
+    out << "\nmost replayed programs (" << replayMs << " ms)\n";
+    for (const ProgramCount &row : replayed) {
+        out << QString::fromStdString(history.groupName(row.group)) << " | " << QString::fromStdString(history.typeName(row.type))
+            << " | " << row.intensity << "\treplays " << row.replays << "\trecords " << row.records << "\n";
+    }
+
+    // the users with the most entries, their trend is the least noisy
+    std::partial_sort(trends.begin(), trends.begin() + std::min(top, trends.size()), trends.end(), [](const UserTrend &a, const UserTrend &b) {
+        return a.count > b.count;
+    });
+    trends.resize(std::min(top, trends.size()));
+    out << "\nuser trends (" << trendMs << " ms)\n";
+    for (const UserTrend &row : trends) {
+        out << QString::fromStdString(history.userName(row.user)) << "\tcount " << row.count << "\tmean " << QString::number(row.meanIntensity, 'f', 2)
+            << "\tper day " << QString::number(row.slopePerDay, 'f', 4) << "\n";
+    }
+    return 0;
+}
+
+/*
+    Function: simulateFleet
+    Purpose: The device-sim run for one hardware revision, every device built for it
+    Inputs:
+        out: QTextStream, where the report goes
+        count: number of devices
+        hours: double, simulated hours
+        seed: unsigned integer, seed of the first electrode model
+        electrodes: ElectrodeParams of the left and right electrodes
+        shared: SharedStateTable to publish into, or nullptr
+    Return: integer exit code
+*/
+template <class Hardware>
+static int simulateFleet(QTextStream &out, size_t count, double hours, uint32_t seed, const ElectrodeParams electrodes[2],
+                         SharedStateTable *shared) {
+    using Core = BasicDeviceCore<Hardware>;
+    const int levels = Core::Intensity::MAX - Core::Intensity::MIN + 1;
+
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<std::unique_ptr<SimHost>> hosts;
+    std::vector<std::unique_ptr<Core>> devices;
+    for (size_t i = 0; i < count; ++i) {
+        hosts.push_back(std::make_unique<SimHost>());
+        devices.push_back(std::make_unique<Core>(hosts.back().get()));
+        hosts.back()->attach(devices.back().get());
+        devices.back()->setImpedanceModel(electrodes[LeftElectrode], electrodes[RightElectrode], seed + (uint32_t)i);
+        if (shared) devices.back()->setSharedState(shared, shared->claim());
+        devices.back()->SetBattery(100);
+        devices.back()->PowerButtonPressed();  // never released, so it is held and powers on after 1s
+    }
+    qint64 setupMs = timer.elapsed();
+
+    size_t sessions = 0;
+    size_t softOffs = 0;
+    size_t powerUps = 0;
+    long long seconds = (long long)(hours * 3600);
+    for (long long second = 0; second < seconds; ++second) {
+        for (size_t i = 0; i < count; ++i) {
+            Core &device = *devices[i];
+            State before = device.getState();
+            hosts[i]->advance(1000);
+            State now = device.getState();
+            if (now == State::SoftOff && before != State::SoftOff) softOffs++;
+            if (now == State::ChoosingSession) {
+                device.StartSessionButtonClicked();
+                sessions++;
+            } else if (now == State::Off) {
+                device.SetBattery(100);
+                device.PowerButtonPressed();
+                powerUps++;
+            } else if (now == State::InSession && device.getIntensity() < Core::Intensity::MIN + (int)(i % levels)) {
+                device.IntensityArrowClicked(1);
+            }
+        }
+    }
+    qint64 elapsed = timer.elapsed();
+
+    size_t updates = 0;
+    size_t fired = 0;
+    size_t safeVoltages = 0;
+    for (const std::unique_ptr<SimHost> &host : hosts) {
+        updates += host->updates;
+        fired += host->timersFired;
+        safeVoltages += host->safeVoltageReturns;
+    }
+    double deviceSeconds = (double)count * seconds;
+    out << "devices: " << count << "  simulated hours: " << hours << "  setup: " << setupMs << " ms  run: " << elapsed - setupMs << " ms\n";
+    out << "sessions started: " << sessions << "  soft offs: " << softOffs << "  safe voltage returns: " << safeVoltages
+        << "  power ups: " << powerUps << "\n";
+    out << "timers fired: " << fired << "  updates: " << updates << "  device seconds per wall second: "
+        << (elapsed > setupMs ? deviceSeconds * 1000 / (elapsed - setupMs) : 0) << "\n";
+    out << "per device: " << sizeof(Core) << " byte core + " << sizeof(SimHost) << " byte host\n";
+    return 0;
+}
+
+/*
+    Function: runDeviceSim
+    Purpose: Run a fleet of whole devices on simulated clocks with no event loop, each with its
+             own electrode model, starting a session whenever one is idle and powering back on
+             with a fresh battery whenever one goes off, and report what they went through and
+             how much faster than real time it ran. --hardware picks the revision the devices
+             are built for. With --shm the devices also publish into shared memory for
+             shm-monitor to watch.
+             Usage: device-sim [--devices N] [--hours H] [--seed N] [--hardware standard|revb] [--shm NAME]
+                    [--electrode side:spec]...
+    Inputs:
+        args: QStringList, application arguments
+    Return: integer exit code
+*/
+int runDeviceSim(QStringList args) {
+    QTextStream out(stdout);
+    size_t count = (size_t)optionValue(args, "--devices", 1000);
+    double hours = optionValue(args, "--hours", 1);
+    uint32_t seed = (uint32_t)optionValue(args, "--seed", 1);
+    QString hardware = optionText(args, "--hardware", "standard");
+    if (hardware != "standard" && hardware != "revb") {
+        out << "unknown hardware " << hardware << ", use standard or revb\n";
+        return 1;
+    }
+
+    ElectrodeParams electrodes[2];
+    QString bad;
+    if (!electrodeOptions(args, electrodes[LeftElectrode], electrodes[RightElectrode], &bad)) {
+        out << "bad --electrode " << bad << "\n";
+        return 1;
+    }
+
+    std::unique_ptr<SharedStateTable> shared;
+    if (args.contains("--shm")) {
+        QString name = optionText(args, "--shm", "oasis-pro");
+        shared.reset(SharedStateTable::create(name.toStdString(), (uint32_t)count));
+        if (!shared) {
+            out << "could not create shared state " << name << "\n";
+            return 1;
+        }
+    }
+
+    out << "hardware: " << hardware << "\n";
+    if (hardware == "revb") return simulateFleet<RevisionBHardware>(out, count, hours, seed, electrodes, shared.get());
+    return simulateFleet<StandardHardware>(out, count, hours, seed, electrodes, shared.get());
+}
+
+/*
+    Function: runSessionSwarm
+    Purpose: Run many concurrent sessions of the device's selected program as coroutine flows
+             on this thread, flipping random electrodes each simulated second, and report how
+             they went and what each session cost.
+             Usage: session-swarm [--sessions N] [--flips F] [--seed N]
+    Inputs:
+        args: QStringList, application arguments
+    Return: integer exit code
+*/
+int runSessionSwarm(QStringList args) {
+    QTextStream out(stdout);
+    size_t sessions = (size_t)optionValue(args, "--sessions", 100000);
+    double flips = optionValue(args, "--flips", 0.02);  // share of sessions whose contact changes each second
+    uint32_t state = (uint32_t)optionValue(args, "--seed", 1);
+    if (state == 0) state = 1;
+    auto random = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+
+    SimHost host;
+    DeviceCore device(&host);
+    SessionTimeline program = device.compileSession(SIM_MS_PER_MINUTE);
+    LifecycleConfig config = device.lifecycleConfig();
+    int levels = config.maxIntensity - config.minIntensity + 1;
+
+    QElapsedTimer timer;
+    timer.start();
+    FlowScheduler scheduler(config, sessions);
+    for (size_t i = 0; i < sessions; ++i) {
+        uint32_t id = scheduler.add(true);
+        scheduler.start(id, runSessionFlow(scheduler, id, program, config.minIntensity + (int)(i % levels)));
+    }
+    size_t perSecond = (size_t)(sessions * flips);
+    int64_t now = 0;
+    while (scheduler.active() > 0 && sessions > 0) {
+        now += 1000;
+        scheduler.runUntil(now);
+        for (size_t k = 0; k < perSecond; ++k) {
+            // mostly in contact, so sessions get paused and then find their way back
+            scheduler.setConnected(random() % sessions, random() % 4 != 0);
+        }
+    }
+    qint64 elapsed = timer.elapsed();
+
+    const FlowStats &stats = scheduler.stats;
+    out << "sessions: " << sessions << "  program: " << program.duration() << " ms  simulated: " << now / 1000 << " s\n";
+    out << "completed: " << stats.completed << "  pauses: " << stats.pauses << "  safe voltage returns: " << stats.safeVoltages << "\n";
+    out << "resumes: " << stats.resumes << "  wall time: " << elapsed << " ms\n";
+    out << "per session: " << FlowTask::frameBytes << " byte frame + " << sizeof(FlowSession) << " byte state\n";
+    return 0;
+}
+
+/*
+    Function: checkFlows
+    Purpose: The flow-check runs for one hardware revision. Each run powers a core on, picks a
+             random session, starts it and a flow for the same program, then feeds both the
+             same random arrow clicks, power clicks and connection changes. Both drive the same
+             SessionLifecycle, so a difference means one of them delivered an event late, early
+             or not at all.
+    Inputs:
+        out: QTextStream, where the report goes
+        runs: number of sessions
+        seed: unsigned integer, seed of the random inputs
+    Return: integer exit code, 1 if any run differed
+*/
+template <class Hardware>
+static int checkFlows(QTextStream &out, int runs, uint32_t seed) {
+    uint32_t state = seed ? seed : 1;
+    auto random = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+
+    const int STEP_MS = 250;
+    const int LIMIT_MS = 600000;
+    int differed = 0;
+    long long compared = 0;
+    for (int run = 0; run < runs; ++run) {
+        SimHost host;
+        BasicDeviceCore<Hardware> device(&host);
+        host.attach(&device);
+        device.SetBattery(100);
+        device.SetConnectionStatus(2);
+        device.PowerButtonPressed();
+        host.advance(POWER_HOLD_MS);
+        for (int i = (int)(random() % 3); i > 0; --i) {
+            device.PowerButtonPressed();
+            device.PowerButtonReleased();
+        }
+        for (int i = (int)(random() % 4); i > 0; --i) device.IntensityArrowClicked(1);
+        if (random() % 4 == 0) device.setRamp(StartRamp, RampShape::Exponential, 3000);
+        if (random() % 4 == 0) device.setRamp(SafeVoltageRamp, RampShape::Stepwise, 8000);
+
+        FlowScheduler scheduler(device.lifecycleConfig(), 1);
+        SessionTimeline program = device.compileSession(SIM_MS_PER_MINUTE);
+        uint32_t id = scheduler.add(true);
+        device.StartSessionButtonClicked();
+        scheduler.start(id, runSessionFlow(scheduler, id, program, device.getIntensity()));
+
+        bool connected = true;
+        for (int ms = STEP_MS; ms <= LIMIT_MS; ms += STEP_MS) {
+            uint32_t roll = random() % 400;
+            if (roll < 20) {
+                connected = !connected;
+                device.SetConnectionStatus(connected ? 2 : 0);
+                scheduler.setConnected(id, connected);
+            } else if (roll < 40) {
+                bool up = roll < 30;
+                device.IntensityArrowClicked(up ? 1 : -1);
+                scheduler.post(id, up ? FlowInput::IntensityUp : FlowInput::IntensityDown);
+            } else if (roll == 40) {
+                device.PowerButtonPressed();
+                device.PowerButtonReleased();
+                scheduler.post(id, FlowInput::Power);
+            }
+            host.advance(STEP_MS);
+            scheduler.runUntil(ms);
+
+            const FlowSession &flow = scheduler.session(id);
+            LifecyclePhase phase = device.getLifecyclePhase();
+            int intensity = device.getIntensity();
+            compared++;
+            if (phase != flow.phase || intensity != flow.intensity) {
+                out << "run " << run << " at " << ms << " ms: core phase " << (int)phase << " intensity " << intensity
+                    << ", flow phase " << (int)flow.phase << " intensity " << (int)flow.intensity << "\n";
+                differed++;
+                break;
+            }
+            if (phase == LifecyclePhase::Done) break;
+        }
+    }
+    out << "runs: " << runs << "  compared: " << compared << " steps  differed: " << differed << "\n";
+    return differed ? 1 : 0;
+}
+
+/*
+    Function: runFlowCheck
+    Purpose: Check the coroutine session flow against the device core, both driving the same
+             session lifecycle, running them through the same random sessions and inputs and
+             comparing their phase and intensity every quarter of a simulated second.
+             Usage: flow-check [--runs N] [--seed N] [--hardware standard|revb]
+    Inputs:
+        args: QStringList, application arguments
+    Return: integer exit code, 1 if any run differed
+*/
+int runFlowCheck(QStringList args) {
+    QTextStream out(stdout);
+    int runs = (int)optionValue(args, "--runs", 1000);
+    uint32_t seed = (uint32_t)optionValue(args, "--seed", 1);
+    QString hardware = optionText(args, "--hardware", "standard");
+    if (hardware != "standard" && hardware != "revb") {
+        out << "unknown hardware " << hardware << ", use standard or revb\n";
+        return 1;
+    }
+    out << "hardware: " << hardware << "\n";
+    if (hardware == "revb") return checkFlows<RevisionBHardware>(out, runs, seed);
+    return checkFlows<StandardHardware>(out, runs, seed);
+}
+
+/*
+    Function: runShmMonitor
+    Purpose: Watch the devices another process publishes with --shm, polling every slot at the
+             given rate without touching that process, and print once a second how many are in
+             session or paused, their mean battery, how many changes were seen and what a slot
+             read cost.
+             Usage: shm-monitor [--name NAME] [--hz H] [--seconds S]
+    Inputs:
+        args: QStringList, application arguments
+    Return: integer exit code
+*/
+int runShmMonitor(QStringList args) {
+    QTextStream out(stdout);
+    QString name = optionText(args, "--name", "oasis-pro");
+    double hz = std::max(1.0, optionValue(args, "--hz", 1000));
+    double seconds = optionValue(args, "--seconds", 10);
+
+    std::unique_ptr<SharedStateTable> table(SharedStateTable::open(name.toStdString()));
+    if (!table) {
+        out << "no shared state " << name << ", start the app or device-sim with --shm\n";
+        return 1;
+    }
+    out << "watching " << name << ": " << table->devices() << " of " << table->capacity() << " slots from pid "
+        << table->header().writerPid << "\n";
+    out.flush();
+
+    std::vector<uint32_t> seen(table->capacity(), 0);
+    std::chrono::nanoseconds period((long long)(1e9 / hz));
+    QElapsedTimer timer;
+    timer.start();
+    qint64 reportAt = 1000;
+    long long polls = 0, changes = 0, reads = 0, readNs = 0;
+    auto next = std::chrono::steady_clock::now();
+    while (timer.elapsed() < seconds * 1000) {
+        uint32_t devices = table->devices();
+        int inSession = 0, paused = 0;
+        double battery = 0;
+        QElapsedTimer readTimer;
+        readTimer.start();
+        for (uint32_t slot = 0; slot < devices; ++slot) {
+            uint32_t version = table->version(slot);
+            if (version != seen[slot]) {
+                seen[slot] = version;
+                changes++;
+            }
+            SharedDeviceState state = table->read(slot);
+            if (state.state == (int)State::InSession) inSession++;
+            if (state.state == (int)State::Paused) paused++;
+            battery += state.batteryLevel;
+        }
+        readNs += readTimer.nsecsElapsed();
+        reads += devices;
+        polls++;
+
+        if (timer.elapsed() >= reportAt) {
+            out << reportAt / 1000 << " s  devices: " << devices << "  in session: " << inSession << "  paused: " << paused
+                << "  mean battery: " << QString::number(devices ? battery / devices : 0, 'f', 1) << "%  changes: " << changes
+                << "  polls: " << polls << "  ns per read: " << (reads ? readNs / reads : 0) << "\n";
+            out.flush();
+            reportAt += 1000;
+            polls = changes = reads = readNs = 0;
+        }
+        next += period;
+        std::this_thread::sleep_until(next);
+    }
+    return 0;
+}
+
+/*
+    Function: runTelemetryStudy
+    Purpose: Record a simulated fleet into a telemetry store a second at a time and report the
+             memory it takes, then time a range query and a downsampled day per device.
+             Usage: telemetry-study [--devices N] [--hours H] [--bucket S] [--seed N]
+    Inputs:
+        args: QStringList, application arguments
+    Return: integer exit code
+*/
+int runTelemetryStudy(QStringList args) {
+    QTextStream out(stdout);
+    size_t devices = (size_t)optionValue(args, "--devices", 10000);
+    double hours = optionValue(args, "--hours", 24);
+    int64_t bucketMs = (int64_t)(optionValue(args, "--bucket", 60) * 1000);
+    uint32_t seed = (uint32_t)optionValue(args, "--seed", 1);
+    int64_t durationMs = (int64_t)(hours * 3600 * 1000);
+    if (devices == 0 || durationMs <= 0) return 1;
+
+    TelemetryStore store(durationMs);
+    QElapsedTimer timer;
+    timer.start();
+    synthesizeTelemetry(store, devices, durationMs, seed);
+    qint64 recordMs = timer.elapsed();
+
+    size_t samples = store.samples();
+    size_t bytes = store.bytes();
+    double raw = (double)samples * sizeof(TelemetrySample);
+    out << "devices: " << devices << "  hours: " << hours << "  samples: " << samples << "  recorded in " << recordMs << " ms\n";
+    out << "store: " << QString::number(bytes / 1048576.0, 'f', 1) << " MiB in " << store.blocks() << " blocks, "
+        << QString::number(bytes * 8.0 / samples, 'f', 2) << " bits per sample, " << QString::number(raw / bytes, 'f', 1) << "x smaller than raw\n";
+
+    // the last hour of every device, then every device's whole run in buckets
+    timer.restart();
+    size_t hourSamples = 0;
+    for (uint32_t d = 0; d < devices; ++d) hourSamples += store.range(d, durationMs - 3600000, durationMs).size();
+    qint64 rangeMs = timer.restart();
+    size_t buckets = 0;
+    for (uint32_t d = 0; d < devices; ++d) buckets += store.downsample(d, 0, durationMs, bucketMs).size();
+    qint64 downsampleMs = timer.elapsed();
+    out << "last hour of each device: " << hourSamples << " samples in " << rangeMs << " ms\n";
+    out << "whole run of each device in " << bucketMs / 1000 << " s buckets: " << buckets << " buckets in " << downsampleMs << " ms\n";
+    return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef TOOLS_H
+#define TOOLS_H
+
+#include <QStringList>
+
+#include "impedance.h"
+
+// headless commands run from the command line instead of opening the device window
+bool isToolCommand(const char *);
+int runTool(QStringList);
+
+// every --electrode side:spec option, side left, right or both, spec as for parseElectrodeParams
+bool electrodeOptions(const QStringList &, ElectrodeParams &left, ElectrodeParams &right, QString *error);
+
+int runAllocDiff(QStringList);
+int runContactStudy(QStringList);
+int runDeviceSim(QStringList);
+int runFlowCheck(QStringList);
+int runHistoryReport(QStringList);
+int runSessionSwarm(QStringList);
+int runShmMonitor(QStringList);
+int runTelemetryStudy(QStringList);
+
+#endif // TOOLS_H
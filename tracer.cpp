@@ -0,0 +1,114 @@
+#include "tracer.h"
+
+#include <chrono>
+#include <cstdio>
+
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// small stable number per thread, the trace viewer shows one row per thread
+static uint32_t threadNumber() {
+    static std::atomic<uint32_t> threads(0);
+    thread_local uint32_t number = ++threads;
+    return number;
+}
+
+Tracer &Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::Tracer() : enabled(false), next(0), lost(0), originNs(0) {}
+
+/*
+    Function: start
+    Purpose: Allocate the event buffer and begin recording, earlier events are discarded
+    Inputs:
+        capacity: size_t, events kept, later ones are counted as dropped
+    Return: void
+ */
+void Tracer::start(size_t capacity) {
+    enabled.store(false);
+    events.assign(capacity, Event());
+    next.store(0);
+    lost.store(0);
+    originNs = nowNs();
+    enabled.store(true);
+}
+
+void Tracer::stop() {
+    enabled.store(false);
+}
+
+size_t Tracer::dropped() const {
+    return lost.load();
+}
+
+// claim a slot with one atomic increment so any thread can record, nothing once stopped
+void Tracer::record(const char *name, char phase, double value) {
+    if (!enabled.load(std::memory_order_relaxed)) return;
+    size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+    if (slot >= events.size()) {
+        lost.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Event &e = events[slot];
+    e.name = name;
+    e.phase = phase;
+    e.thread = threadNumber();
+    e.ns = (uint64_t)(nowNs() - originNs);
+    e.value = value;
+}
+
+void Tracer::begin(const char *name) {
+    record(name, 'B', 0);
+}
+
+void Tracer::end(const char *name) {
+    record(name, 'E', 0);
+}
+
+void Tracer::instant(const char *name) {
+    record(name, 'i', 0);
+}
+
+void Tracer::counter(const char *name, double value) {
+    record(name, 'C', value);
+}
+
+/*
+    Function: writeJson
+    Purpose: Write everything recorded so far as a Chrome trace-event JSON file.
+             Call after stop() once every thread that records has finished, a scope still
+             open elsewhere may be filling the slot it claimed.
+    Inputs:
+        path: string, output file
+    Return: bool, false if the file could not be written
+ */
+bool Tracer::writeJson(const std::string &path) const {
+    FILE *file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    size_t count = next.load();
+    if (count > events.size()) count = events.size();
+
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped\":%zu},\"traceEvents\":[\n", dropped());
+    for (size_t i = 0; i < count; ++i) {
+        const Event &e = events[i];
+        double us = e.ns / 1000.0;
+        const char *separator = i + 1 < count ? ",\n" : "\n";
+        if (e.phase == 'C') {
+            std::fprintf(file, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"value\":%g}}%s",
+                         e.name, us, e.thread, e.value, separator);
+        } else if (e.phase == 'i') {
+            std::fprintf(file, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}%s",
+                         e.name, us, e.thread, separator);
+        } else {
+            std::fprintf(file, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}%s",
+                         e.name, e.phase, us, e.thread, separator);
+        }
+    }
+    std::fprintf(file, "]}\n");
+    return std::fclose(file) == 0;
+}
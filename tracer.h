@@ -0,0 +1,89 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "allocstats.h"
+
+/*
+    Class: Tracer
+    Purpose: In-memory recorder of begin/end spans, instant events and counters, written
+             out in the Chrome trace-event JSON format (chrome://tracing, Perfetto).
+             Events go into a buffer allocated when tracing starts, names must be string
+             literals. While tracing is off every trace point costs one relaxed atomic load.
+ */
+class Tracer
+{
+public:
+    static Tracer &instance();
+
+    void start(size_t capacity = 1 << 20);
+    void stop();
+    bool writeJson(const std::string &path) const;
+    size_t dropped() const;
+
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    void begin(const char *name);
+    void end(const char *name);
+    void instant(const char *name);
+    void counter(const char *name, double value);
+
+private:
+    struct Event {
+        const char *name;
+        char phase;      // B, E, i or C
+        uint32_t thread;
+        uint64_t ns;     // since start
+        double value;    // counters only
+    };
+
+    Tracer();
+    void record(const char *name, char phase, double value);
+
+    std::atomic<bool> enabled;
+    std::atomic<size_t> next;
+    std::atomic<size_t> lost;
+    std::vector<Event> events;
+    int64_t originNs;
+};
+
+// span covering the rest of the enclosing scope
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name) : name(Tracer::instance().isEnabled() ? name : nullptr) {
+        if (this->name) Tracer::instance().begin(this->name);
+    }
+    ~TraceScope() {
+        if (name) Tracer::instance().end(name);
+    }
+
+private:
+    const char *name;
+};
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+
+// with alloc_stats every trace scope is also an allocation scope, with or without tracing
+#ifdef OASIS_ALLOC_STATS
+#define ALLOC_SCOPE(name) AllocScope TRACE_CONCAT(allocScope, __LINE__)(name);
+#else
+#define ALLOC_SCOPE(name)
+#endif
+
+#ifdef OASIS_NO_TRACE
+#define TRACE_SCOPE(name) ALLOC_SCOPE(name)
+#define TRACE_INSTANT(name)
+#define TRACE_COUNTER(name, value)
+#else
+#define TRACE_SCOPE(name) ALLOC_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_INSTANT(name) do { if (Tracer::instance().isEnabled()) Tracer::instance().instant(name); } while (0)
+#define TRACE_COUNTER(name, value) do { if (Tracer::instance().isEnabled()) Tracer::instance().counter(name, value); } while (0)
+#endif
+
+#endif // TRACER_H
@@ -0,0 +1,347 @@
+#include "waveform.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define WAVEFORM_SSE2
+#endif
+
+// frames generated per chunk when streaming through the ring
+static const size_t CHUNK_FRAMES = 4096;
+
+static size_t roundUpPow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+SampleRing::SampleRing(size_t capacity) : buffer(roundUpPow2(capacity)),
+                                          mask(roundUpPow2(capacity) - 1),
+                                          head(0),
+                                          tail(0),
+                                          closed(false) {}
+
+size_t SampleRing::push(const float *samples, size_t count) {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t t = tail.load(std::memory_order_acquire);
+    size_t free = buffer.size() - (h - t);
+    if (count > free) count = free;
+
+    // copy in at most two pieces, wrapping around the end of the buffer
+    size_t start = h & mask;
+    size_t first = count < buffer.size() - start ? count : buffer.size() - start;
+    std::memcpy(&buffer[start], samples, first * sizeof(float));
+    std::memcpy(&buffer[0], samples + first, (count - first) * sizeof(float));
+
+    head.store(h + count, std::memory_order_release);
+    return count;
+}
+
+size_t SampleRing::pop(float *samples, size_t count) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t h = head.load(std::memory_order_acquire);
+    size_t available = h - t;
+    if (count > available) count = available;
+
+    size_t start = t & mask;
+    size_t first = count < buffer.size() - start ? count : buffer.size() - start;
+    std::memcpy(samples, &buffer[start], first * sizeof(float));
+    std::memcpy(samples + first, &buffer[0], (count - first) * sizeof(float));
+
+    tail.store(t + count, std::memory_order_release);
+    return count;
+}
+
+size_t SampleRing::size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+}
+
+size_t SampleRing::capacity() const {
+    return buffer.size();
+}
+
+// producer is done, consumer drains what is left and stops
+void SampleRing::close() {
+    closed.store(true, std::memory_order_release);
+}
+
+bool SampleRing::isClosed() const {
+    return closed.load(std::memory_order_acquire);
+}
+
+WaveformSynth::WaveformSynth(int sampleRate) : sampleRate(sampleRate),
+                                               frequency(0),
+                                               amplitude(0),
+                                               phase(0),
+                                               phaseStep(0) {}
+
+/*
+    Function: configure
+    Purpose: Set the stimulation frequency and intensity used for the next samples
+    Inputs:
+        frequencyHz: double, frequency of the active session type
+        intensity: integer, device intensity 0-8 (0 is no output)
+    Return: void
+ */
+void WaveformSynth::configure(double frequencyHz, int intensity) {
+    this->frequency = frequencyHz;
+    this->amplitude = MICROAMPS_PER_INTENSITY * intensity;
+    updatePhaseStep();
+}
+
+void WaveformSynth::setSampleRate(int sampleRate) {
+    this->sampleRate = sampleRate;
+    updatePhaseStep();
+}
+
+int WaveformSynth::getSampleRate() const {
+    return sampleRate;
+}
+
+double WaveformSynth::getFrequency() const {
+    return frequency;
+}
+
+float WaveformSynth::getAmplitude() const {
+    return amplitude;
+}
+
+// restart the waveform at the beginning of a cycle
+void WaveformSynth::reset() {
+    this->phase = 0;
+}
+
+void WaveformSynth::updatePhaseStep() {
+    this->phaseStep = sampleRate > 0 ? frequency / sampleRate : 0;
+}
+
+/*
+    Function: synthesize
+    Purpose: Write the next frames of the biphasic square wave as interleaved L/R samples.
+             The phase is carried in double precision between calls so hours of signal
+             do not drift, each call computes its own sample phases in float.
+    Inputs:
+        out: float pointer, room for 2 * frames samples
+        frames: size_t, number of L/R frames to generate
+    Return: void
+ */
+void WaveformSynth::synthesize(float *out, size_t frames) {
+    const float base = (float)phase;
+    const float step = (float)phaseStep;
+    const float amp = amplitude;
+    size_t i = 0;
+
+#ifdef WAVEFORM_SSE2
+    const __m128 vBase = _mm_set1_ps(base);
+    const __m128 vStep = _mm_set1_ps(step);
+    const __m128 vHalf = _mm_set1_ps(0.5f);
+    const __m128 vPos = _mm_set1_ps(amp);
+    const __m128 vNeg = _mm_set1_ps(-amp);
+    const __m128i vLanes = _mm_set_epi32(3, 2, 1, 0);
+
+    for (; i + 4 <= frames; i += 4) {
+        // each lane from its own frame index, the same base + step * i as the scalar tail,
+        // so the output does not depend on the buffer length or where the tail starts
+        __m128 index = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32((int)i), vLanes));
+        __m128 vPhase = _mm_add_ps(vBase, _mm_mul_ps(vStep, index));
+        // fractional part of the phase, phases are never negative so truncation is floor
+        __m128 frac = _mm_sub_ps(vPhase, _mm_cvtepi32_ps(_mm_cvttps_epi32(vPhase)));
+        __m128 firstHalf = _mm_cmplt_ps(frac, vHalf);
+        __m128 left = _mm_or_ps(_mm_and_ps(firstHalf, vPos), _mm_andnot_ps(firstHalf, vNeg));
+        __m128 right = _mm_sub_ps(_mm_setzero_ps(), left);
+
+        _mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(left, right));
+        _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(left, right));
+    }
+#endif
+
+    for (; i < frames; ++i) {
+        float p = base + step * i;
+        float frac = p - (float)(int)p;
+        float left = frac < 0.5f ? amp : -amp;
+        out[2 * i] = left;
+        out[2 * i + 1] = -left;
+    }
+
+    // carry the phase forward exactly
+    double next = phase + phaseStep * frames;
+    this->phase = next - std::floor(next);
+}
+
+/*
+    Function: synthesize
+    Purpose: Write frames of a session program, reconfiguring at every segment and ramp
+             boundary. Frames outside the program are silent.
+    Inputs:
+        program: SessionTimeline, the compiled session in real milliseconds
+        startFrame: long long, frame of the program the first output frame is at
+        fallbackIntensity: integer, intensity of segments without a ramp
+        out: float pointer, room for 2 * frames samples
+        frames: size_t, number of L/R frames to generate
+    Return: void
+ */
+void WaveformSynth::synthesize(const SessionTimeline &program, long long startFrame, int fallbackIntensity, float *out, size_t frames) {
+    size_t done = 0;
+    while (done < frames) {
+        long long frame = startFrame + (long long)done;
+        long long ms = frame * 1000 / sampleRate;
+        int index = program.indexAt(ms);
+        double hz = index < 0 ? frequency : program.segment(index).frequencyHz;
+        int intensity = index < 0 ? 0 : program.intensityAt(ms, fallbackIntensity);
+        if (hz != frequency || MICROAMPS_PER_INTENSITY * intensity != amplitude) configure(hz, intensity);
+
+        // run up to the first frame at or past the next change
+        long long changeFrame = (program.nextChangeMs(ms) * sampleRate + 999) / 1000;
+        size_t n = frames - done;
+        if (index >= 0 && changeFrame > frame && (unsigned long long)(changeFrame - frame) < n) n = (size_t)(changeFrame - frame);
+        synthesize(out + 2 * done, n);
+        done += n;
+    }
+}
+
+/*
+    Function: synthesize
+    Purpose: Write frames at the current frequency with the amplitude following a ramp, every
+             sample scaled by the ramp's level at its own time rather than by whole levels
+    Inputs:
+        envelope: Ramp of the intensity, such as a soft off or a session start
+        startUs: long long, time into the ramp of the first output frame
+        out: float pointer, room for 2 * frames samples
+        frames: size_t, number of L/R frames to generate
+    Return: void
+ */
+void WaveformSynth::synthesize(const Ramp &envelope, long long startUs, float *out, size_t frames) {
+    this->amplitude = 1;
+    synthesize(out, frames);
+    for (size_t i = 0; i < frames; ++i) {
+        long long us = startUs + (long long)i * 1000000 / sampleRate;
+        float amp = MICROAMPS_PER_INTENSITY * (float)envelope.levelAt(us);
+        out[2 * i] *= amp;
+        out[2 * i + 1] *= amp;
+    }
+    this->amplitude = MICROAMPS_PER_INTENSITY * (float)envelope.levelAt(startUs + (long long)frames * 1000000 / sampleRate);
+}
+
+/*
+    Function: fill
+    Purpose: Synthesize frames straight into a ring, stopping early if the ring is full
+    Inputs:
+        ring: SampleRing, destination
+        frames: size_t, maximum number of frames to add
+    Return: size_t, number of frames written
+ */
+size_t WaveformSynth::fill(SampleRing &ring, size_t frames) {
+    float chunk[2 * CHUNK_FRAMES];
+    size_t written = 0;
+    while (written < frames) {
+        size_t room = (ring.capacity() - ring.size()) / 2;
+        size_t n = frames - written;
+        if (n > room) n = room;
+        if (n > CHUNK_FRAMES) n = CHUNK_FRAMES;
+        if (n == 0) break;
+
+        synthesize(chunk, n);
+        ring.push(chunk, 2 * n);
+        written += n;
+    }
+    return written;
+}
+
+static void putLE32(unsigned char *p, uint32_t v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = (v >> 24) & 0xff;
+}
+
+static void putLE16(unsigned char *p, uint16_t v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+}
+
+/*
+    Function: renderToFile
+    Purpose: Stream a whole session of signal to a 32 bit float stereo WAV file.
+             A worker thread synthesizes into a ring while this thread writes it out.
+    Inputs:
+        path: string, output file
+        durationMs: long long, length of signal to generate
+    Return: bool, false if the file could not be written
+ */
+bool WaveformSynth::renderToFile(const std::string &path, long long durationMs) {
+    return writeWav(path, durationMs, nullptr, 0);
+}
+
+// the whole program, segment by segment, see synthesize
+bool WaveformSynth::renderToFile(const std::string &path, const SessionTimeline &program, int fallbackIntensity) {
+    return writeWav(path, program.duration(), &program, fallbackIntensity);
+}
+
+bool WaveformSynth::writeWav(const std::string &path, long long durationMs, const SessionTimeline *program, int fallbackIntensity) {
+    FILE *file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    const uint64_t totalFrames = (uint64_t)durationMs * sampleRate / 1000;
+    const uint64_t dataBytes = totalFrames * 2 * sizeof(float);
+    // WAV sizes are 32 bit, longer renders are still written but the header saturates
+    const uint32_t dataSize = dataBytes > 0xFFFFFFF0u ? 0xFFFFFFF0u : (uint32_t)dataBytes;
+
+    unsigned char header[44];
+    std::memcpy(header, "RIFF", 4);
+    putLE32(header + 4, dataSize + 36);
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    putLE32(header + 16, 16);
+    putLE16(header + 20, 3); // IEEE float
+    putLE16(header + 22, 2);
+    putLE32(header + 24, sampleRate);
+    putLE32(header + 28, sampleRate * 2 * sizeof(float));
+    putLE16(header + 32, 2 * sizeof(float));
+    putLE16(header + 34, 32);
+    std::memcpy(header + 36, "data", 4);
+    putLE32(header + 40, dataSize);
+    bool ok = std::fwrite(header, sizeof(header), 1, file) == 1;
+
+    SampleRing ring(16 * 2 * CHUNK_FRAMES);
+    std::thread producer([this, &ring, totalFrames, program, fallbackIntensity]() {
+        uint64_t produced = 0;
+        while (produced < totalFrames) {
+            uint64_t left = totalFrames - produced;
+            size_t n = left < CHUNK_FRAMES ? (size_t)left : CHUNK_FRAMES;
+            if (!program) {
+                n = this->fill(ring, n);
+            } else if (ring.capacity() - ring.size() >= 2 * n) {
+                float chunk[2 * CHUNK_FRAMES];
+                this->synthesize(*program, (long long)produced, fallbackIntensity, chunk, n);
+                ring.push(chunk, 2 * n);
+            } else {
+                n = 0;
+            }
+            if (n == 0) std::this_thread::yield();
+            produced += n;
+        }
+        ring.close();
+    });
+
+    std::vector<float> out(4 * 2 * CHUNK_FRAMES);
+    while (true) {
+        // read the closed flag before popping so the last push is never missed
+        bool done = ring.isClosed();
+        size_t n = ring.pop(out.data(), out.size());
+        if (n > 0) {
+            ok = ok && std::fwrite(out.data(), sizeof(float), n, file) == n;
+        } else if (done) {
+            break;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    ok = std::fclose(file) == 0 && ok;
+    return ok;
+}
@@ -0,0 +1,77 @@
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "ramp.h"
+#include "timeline.h"
+
+// current delivered per intensity step, intensity 1-8 gives 75-600 uA
+const float MICROAMPS_PER_INTENSITY = 75.0f;
+const int DEFAULT_SAMPLE_RATE = 20000;
+
+/*
+    Class: SampleRing
+    Purpose: Lock-free single producer / single consumer ring of float samples.
+             Capacity is rounded up to a power of two so indices can be masked.
+ */
+class SampleRing
+{
+public:
+    explicit SampleRing(size_t capacity);
+
+    size_t push(const float *samples, size_t count); // returns how many were written
+    size_t pop(float *samples, size_t count);        // returns how many were read
+    size_t size() const;
+    size_t capacity() const;
+    void close();
+    bool isClosed() const;
+
+private:
+    std::vector<float> buffer;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head; // next write, owned by producer
+    alignas(64) std::atomic<size_t> tail; // next read, owned by consumer
+    std::atomic<bool> closed;
+};
+
+/*
+    Class: WaveformSynth
+    Purpose: Synthesizes the biphasic square CES output current for the L/R channels.
+             Samples are interleaved (L, R) in microamps, the right channel is the
+             inverse of the left so the current flows between the two electrodes.
+ */
+class WaveformSynth
+{
+public:
+    explicit WaveformSynth(int sampleRate = DEFAULT_SAMPLE_RATE);
+
+    void configure(double frequencyHz, int intensity);
+    void setSampleRate(int sampleRate);
+    int getSampleRate() const;
+    double getFrequency() const;
+    float getAmplitude() const;
+    void reset();
+
+    void synthesize(float *out, size_t frames);
+    void synthesize(const SessionTimeline &program, long long startFrame, int fallbackIntensity, float *out, size_t frames);
+    void synthesize(const Ramp &envelope, long long startUs, float *out, size_t frames);
+    size_t fill(SampleRing &ring, size_t frames);
+    bool renderToFile(const std::string &path, long long durationMs);
+    bool renderToFile(const std::string &path, const SessionTimeline &program, int fallbackIntensity);
+
+private:
+    int sampleRate;
+    double frequency;
+    float amplitude;
+    double phase;     // [0, 1) position in the current cycle
+    double phaseStep; // cycles per sample
+
+    void updatePhaseStep();
+    bool writeWav(const std::string &path, long long durationMs, const SessionTimeline *program, int fallbackIntensity);
+};
+
+#endif // WAVEFORM_H